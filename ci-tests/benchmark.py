@@ -17,6 +17,7 @@ def makeSettings(mesh, surface_name, volume_name, nbThreads, final_time):
             "file_basename": "benchmark",
             "evol_time_step": 1e-12,
             "final_time": final_time,
+            "evol_columns": ["t", "iter"],
             "mag_config_every": False
         },
         "mesh": {
@@ -56,6 +57,45 @@ def task2test(str_executable, settings):
     val = subprocess.run([str_executable, "--seed", "2", "-"], input=json.dumps(settings), text=True)
     return val
 
+def nbSteps(evolFileName = "benchmark.evol"):
+    """ returns the number of time steps of the last run, read from the iter column of the .evol file """
+    with open(evolFileName) as f:
+        lines = [line for line in f if line.strip() and not line.startswith('#')]
+    return int(lines[-1].split()[1])
+
+def timePerStep(str_executable, settings):
+    """ wall time of a run divided by its number of time steps """
+    t = timeit.timeit(lambda: task2test(str_executable,settings), number=1)
+    return t/max(1, nbSteps())
+
+def compare(listExecutables, outputFileName, elt_sizes, listNbThreads, final_time):
+    """
+    same runs as bench for two feellgood executables, the time per step of each executable and their
+    ratio are written for every mesh size and nb threads
+    """
+    meshFileName = "cylinder.msh"
+    surface_name = "surface"
+    volume_name = "volume"
+    height = 32
+    radius = 3.0 * height
+
+    with open(outputFileName, 'w') as f:
+        str_date = datetime.now().strftime("%d/%m/%Y %H:%M:%S")
+        for str_executable in listExecutables:
+            f.write("# " + str_executable + ": " + version2test(str_executable))
+        f.write("# " + str_date + '\n')
+        f.write("# elt_size\tnbThreads\ttime/step (s) A\ttime/step (s) B\tB/A\n")
+        for elt_size in elt_sizes:
+            mesh = Cylinder(radius, height, elt_size, surface_name, volume_name)
+            mesh.make(meshFileName)
+            for nbThreads in listNbThreads:
+                settings = makeSettings(meshFileName, surface_name, volume_name, nbThreads, final_time)
+                tA, tB = [timePerStep(str_exec, settings) for str_exec in listExecutables]
+                f.write(str(elt_size) + '\t' + str(nbThreads) + '\t' + str(tA) + '\t' + str(tB)
+                        + '\t' + str(tB/tA) + '\n')
+                print("elt_size =", elt_size, "nbThreads =", nbThreads, "time/step ratio B/A =", tB/tA)
+        f.close()
+
 def bench(str_executable, outputFileName, elt_sizes, listNbThreads, final_time):
     """
     loop over mesh size and nb threads for benchmarking feellgood executable,
@@ -101,9 +141,11 @@ def get_params(default_elt_sizes, default_listNbThreads, default_final_time):
                         default=default_final_time)
     parser.add_argument('--version',action='version',version= __version__,help='show the version number')
     parser.add_argument('-f','--fast',help='fast benchmarking',action="store_true")
+    parser.add_argument('-c','--compare',metavar=('EXEC_A','EXEC_B'),nargs=2,
+                        help='compare the time per step of two feellgood executables')
     return parser.parse_args()
 
-__version__ = '1.0.2'
+__version__ = '1.1.0'
 if __name__ == '__main__':
     default_final_time = 2e-11
     default_elt_sizes = [4.0, 3.5, 3.0, 2.5]
@@ -120,9 +162,14 @@ if __name__ == '__main__':
         print("fast benchmark with",args.nbThreads,"threads")
     else:
         print("full benchmark version "+ __version__,"using gmsh", gmshVersion)
+    if args.compare:
+        args.compare = [os.path.abspath(str_exec) for str_exec in args.compare]
     os.chdir(sys.path[0])
 
     try:
+        if args.compare:
+            compare(args.compare, 'compare.txt', args.sizes, args.nbThreads, args.final_time)
+            sys.exit()
         str_exec = "../feellgood"
         str_version = version2test(str_exec)
         outputFileName = 'benchmark' + str_version[-8:-1] + '.txt'
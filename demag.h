@@ -0,0 +1,289 @@
+#ifndef demag_h
+#define demag_h
+
+/** \file demag.h
+\brief interface of the computations of the potential of the magnetic charges, and direct summation
+<br> The charges are the source densities at the Gauss points of the tetrahedrons and of the
+facettes, the potentials are computed at the nodes. The fast multipole method is in fmm_demag.h, the
+direct summation of all the pairs (target, source) is a reference for it, and is faster on small
+meshes. The hierarchical matrix of demag_hmatrix.h is assembled once for repeated computations on the
+same mesh.
+*/
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+
+#include "chronometer.h"
+
+namespace Demag
+    {
+/** \enum method
+available methods for the computation of the potential of the charges
+*/
+enum method
+    {
+    FMM = 0,    /**< fast multipole method (scalfmm) */
+    DIRECT = 1, /**< direct summation over all the pairs (target, source) */
+    HMATRIX = 2 /**< hierarchical matrix, see demag_hmatrix.h */
+    };
+
+/** returns the name of the method, as written in the settings */
+inline std::string name(const method m)
+    {
+    switch (m)
+        {
+        case FMM: return "fmm";
+        case DIRECT: return "direct";
+        case HMATRIX: return "hmatrix";
+        }
+    return "unknown";
+    }
+
+/** returns the method from its name, returns false if the name is unknown */
+inline bool fromName(std::string const &s /**< [in] */, method &m /**< [out] */)
+    {
+    for (method x : {FMM, DIRECT, HMATRIX})
+        {
+        if (s == name(x))
+            {
+            m = x;
+            return true;
+            }
+        }
+    return false;
+    }
+
+/** \enum fmmPrecision
+floating point precision of the fast multipole method
+*/
+enum fmmPrecision
+    {
+    DOUBLE_PRECISION = 0, /**< all computations in double precision */
+    SINGLE_PRECISION = 1, /**< all computations in single precision */
+    MIXED_PRECISION = 2   /**< far field in single precision, near field in double precision */
+    };
+
+/** returns the name of the precision, as written in the settings */
+inline std::string name(const fmmPrecision p)
+    {
+    switch (p)
+        {
+        case DOUBLE_PRECISION: return "double";
+        case SINGLE_PRECISION: return "single";
+        case MIXED_PRECISION: return "mixed";
+        }
+    return "unknown";
+    }
+
+/** returns the precision from its name, returns false if the name is unknown */
+inline bool fromName(std::string const &s /**< [in] */, fmmPrecision &p /**< [out] */)
+    {
+    for (fmmPrecision x : {DOUBLE_PRECISION, SINGLE_PRECISION, MIXED_PRECISION})
+        {
+        if (s == name(x))
+            {
+            p = x;
+            return true;
+            }
+        }
+    return false;
+    }
+
+/** \struct durations
+time spent in the steps of the computation of the demag field, in seconds
+*/
+struct durations
+    {
+    double charges = 0; /**< computation of the source densities and of the corrections */
+    double gather = 0;  /**< copy of the source densities to the leaves */
+    double execute = 0; /**< fast multipole algorithm or direct summation */
+    double scatter = 0; /**< copy of the potentials from the leaves, normalization */
+
+    /** adds the durations of d */
+    durations &operator+=(durations const &d)
+        {
+        charges += d.charges;
+        gather += d.gather;
+        execute += d.execute;
+        scatter += d.scatter;
+        return *this;
+        }
+    };
+
+/** \class farField
+computes the potentials of the targets from the densities of the sources, both given at
+construction. The potentials are not normalized, they are summed over the sources of srcDen[j]/r.
+*/
+class farField
+    {
+public:
+    virtual ~farField() {}
+
+    /** computes the potential pot of all the targets, the durations of the steps are added to t */
+    virtual void potential(std::vector<double> const &srcDen, std::vector<double> &pot, durations &t) = 0;
+
+    /** computes the potential pot of all the targets due to the neighbouring sources only, this is
+     * the whole potential if the method has no separate near field */
+    virtual void nearPotential(std::vector<double> const &srcDen, std::vector<double> &pot, durations &t)
+        { potential(srcDen, pot, t); }
+    };
+
+/** \class directSum
+sums the contributions of all the sources to each target. The targets are processed by chunks in
+parallel, each chunk sweeps the sources by blocks small enough to stay in cache, the sum over a
+block is vectorized by eigen. The targets are nodes and the sources are Gauss points inside the
+elements, they never coincide.
+*/
+class directSum : public farField
+    {
+public:
+    /** constructor, stores the positions of the targets and of the sources */
+    directSum(std::vector<Eigen::Vector3d> const &targets /**< [in] */,
+              std::vector<Eigen::Vector3d> const &sources /**< [in] */)
+        : tgt(targets), x(sources.size()), y(sources.size()), z(sources.size()), q(sources.size())
+        {
+        for (unsigned j = 0; j < sources.size(); j++)
+            {
+            x(j) = sources[j].x();
+            y(j) = sources[j].y();
+            z(j) = sources[j].z();
+            }
+        chunks.resize((tgt.size() + targetChunk - 1) / targetChunk);
+        std::iota(chunks.begin(), chunks.end(), 0);
+        }
+
+    /** computes the potentials by direct summation */
+    void potential(std::vector<double> const &srcDen, std::vector<double> &pot, durations &t) override
+        {
+        chronometer counter;
+        q = Eigen::Map<const Eigen::ArrayXd>(srcDen.data(), srcDen.size());
+        t.gather += counter.fp_elapsed();
+
+        const int NOD = tgt.size();
+        const int M = q.size();
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+                      [this, &pot, NOD, M](const int c)
+                          {
+                          const int i0 = c * targetChunk;
+                          const int nbTargets = std::min(targetChunk, NOD - i0);
+                          Eigen::Array<double, targetChunk, 1> sum = Eigen::Array<double, targetChunk, 1>::Zero();
+                          for (int j0 = 0; j0 < M; j0 += sourceBlock)
+                              {
+                              const int nb = std::min(sourceBlock, M - j0);
+                              for (int i = 0; i < nbTargets; i++)
+                                  {
+                                  Eigen::Vector3d const &p = tgt[i0 + i];
+                                  sum(i) += (q.segment(j0, nb)
+                                             * ((x.segment(j0, nb) - p.x()).square()
+                                                + (y.segment(j0, nb) - p.y()).square()
+                                                + (z.segment(j0, nb) - p.z()).square())
+                                                       .rsqrt())
+                                                    .sum();
+                                  }
+                              }
+                          for (int i = 0; i < nbTargets; i++)
+                              { pot[i0 + i] = sum(i); }
+                          });
+        t.execute += counter.fp_elapsed();
+        }
+
+private:
+    static constexpr int targetChunk = 64;  /**< number of targets processed by a task */
+    static constexpr int sourceBlock = 1024; /**< number of sources of a block, 32 kB of positions and densities */
+
+    std::vector<Eigen::Vector3d> tgt; /**< positions of the targets */
+    Eigen::ArrayXd x;                 /**< x coordinates of the sources */
+    Eigen::ArrayXd y;                 /**< y coordinates of the sources */
+    Eigen::ArrayXd z;                 /**< z coordinates of the sources */
+    Eigen::ArrayXd q;                 /**< densities of the sources */
+    std::vector<int> chunks;          /**< indices of the chunks of targets */
+    };
+
+/** \class incremental
+computes the potentials of source densities close to the ones of a reference computation. By
+linearity, the potential is the one of the reference plus the potential of the change of the
+densities, this is exact. It costs a full evaluation of the potential of the change plus a sum, a bit
+more than a direct computation: it saves time only when the far field of the change is neglected,
+which is done, optionally, when its norm relative to the densities of the reference is below a
+threshold. A full computation is done, and becomes the new reference, after maxSteps incremental ones.
+*/
+class incremental
+    {
+public:
+    /** \enum mode
+    kind of the last computation */
+    enum mode
+        {
+        FULL = 0,   /**< potential of the densities, the reference is updated */
+        CHANGE = 1, /**< reference plus the potential of the change */
+        NEAR = 2    /**< reference plus the near field of the change */
+        };
+
+    /** maxSteps is the maximum number of incremental computations after a full one, 0 disables
+     * them. If skipFarField is true, the far field of the change is neglected while the relative
+     * norm of the change is at most threshold. */
+    void configure(const int maxSteps /**< [in] */, const bool skipFarField = false /**< [in] */,
+                   const double threshold = 0 /**< [in] */)
+        {
+        nbMaxSteps = maxSteps;
+        skipFar = skipFarField;
+        farThreshold = threshold;
+        age = -1;
+        }
+
+    /** computes the potential pot of srcDen with solver, returns the kind of computation done */
+    mode solve(farField &solver /**< [in] */, std::vector<double> const &srcDen /**< [in] */,
+               std::vector<double> &pot /**< [out] */, durations &t /**< [in,out] */)
+        {
+        if (age < 0 || age >= nbMaxSteps)
+            {
+            solver.potential(srcDen, pot, t);
+            if (nbMaxSteps > 0)
+                {
+                refSrcDen = srcDen;
+                refPot = pot;
+                dSrcDen.resize(srcDen.size());
+                age = 0;
+                }
+            return FULL;
+            }
+
+        chronometer counter;
+        std::transform(std::execution::par, srcDen.begin(), srcDen.end(), refSrcDen.begin(), dSrcDen.begin(),
+                       std::minus{});
+        bool near = false;
+        if (skipFar)
+            {
+            const double dq = Eigen::Map<const Eigen::VectorXd>(dSrcDen.data(), dSrcDen.size()).norm();
+            const double q = Eigen::Map<const Eigen::VectorXd>(refSrcDen.data(), refSrcDen.size()).norm();
+            near = (dq <= farThreshold * q);
+            }
+        t.charges += counter.fp_elapsed();
+
+        if (near)
+            { solver.nearPotential(dSrcDen, pot, t); }
+        else
+            { solver.potential(dSrcDen, pot, t); }
+        std::transform(std::execution::par, pot.begin(), pot.end(), refPot.begin(), pot.begin(), std::plus{});
+        age++;
+        return near ? NEAR : CHANGE;
+        }
+
+private:
+    int nbMaxSteps = 0;         /**< maximum number of incremental computations after a full one */
+    bool skipFar = false;       /**< if true the far field of small changes is neglected */
+    double farThreshold = 0;    /**< maximum relative norm of a change whose far field is neglected */
+    int age = -1;               /**< number of incremental computations since the reference, -1 if none */
+    std::vector<double> refSrcDen; /**< source densities of the reference */
+    std::vector<double> refPot;    /**< potentials of the reference */
+    std::vector<double> dSrcDen;   /**< change of the source densities since the reference */
+    };
+
+    }  // namespace Demag
+#endif
@@ -0,0 +1,498 @@
+#ifndef demag_hmatrix_h
+#define demag_hmatrix_h
+
+/** \file demag_hmatrix.h
+\brief hierarchical matrix of the interactions between the Gauss points and the nodes
+<br> The nodes and the Gauss points do not move, so that the linear map from the source densities to
+the potentials of the nodes is fixed. It is assembled once as a hierarchical matrix: the blocks of
+well separated clusters of targets and sources are compressed to a low rank by adaptive cross
+approximation, the other ones are dense. The matrix may be cached in a file named after a hash of
+the positions and of the parameters, so that the simulations on the same mesh only pay for the
+matrix vector products.
+*/
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "demag.h"
+
+namespace Demag
+    {
+/** \class hMatrix
+hierarchical matrix of 1/r, from the sources to the targets. The targets and the sources are
+permuted so that each cluster is a range of indices.
+*/
+class hMatrix : public farField
+    {
+public:
+    /** constructor, reads the matrix from the cache directory cacheDir if it holds one for the same
+     * positions and tolerance, else assembles it with relative accuracy tol on the admissible blocks
+     * and writes it to the cache. An empty cacheDir means no cache. */
+    hMatrix(std::vector<Eigen::Vector3d> const &targets /**< [in] */,
+            std::vector<Eigen::Vector3d> const &sources /**< [in] */, const double tol /**< [in] */,
+            std::string const &cacheDir /**< [in] */)
+        : NOD(targets.size()), M(sources.size())
+        {
+        const uint64_t h = hash(targets, sources, tol);
+        std::vector<cluster> tTree, sTree;
+        std::vector<std::pair<int, int>> pairs;
+        std::vector<bool> admissible;
+        partition(targets, sources, tTree, sTree, pairs, admissible);
+
+        std::string fileName;
+        if (!cacheDir.empty())
+            {
+            std::ostringstream ss;
+            ss << cacheDir << "/demag-" << std::hex << h << ".hmat";
+            fileName = ss.str();
+            fromCache = read(fileName, h, tTree, sTree, pairs, admissible);
+            }
+        if (!fromCache)
+            {
+            assemble(targets, sources, tol, tTree, sTree, pairs, admissible);
+            if (!fileName.empty() && !write(fileName, h))
+                { std::cerr << "Warning: could not write the H-matrix to " << fileName << std::endl; }
+            }
+        buildLeafBlocks();
+        z.resize(blocks.size());
+        qp.resize(M);
+        yp.resize(NOD);
+        }
+
+    /** computes the potentials by a matrix vector product */
+    void potential(std::vector<double> const &srcDen, std::vector<double> &pot, durations &t) override
+        { product(srcDen, pot, t, false); }
+
+    /** computes the potentials by the product of the dense blocks only */
+    void nearPotential(std::vector<double> const &srcDen, std::vector<double> &pot, durations &t) override
+        { product(srcDen, pot, t, true); }
+
+    /** ratio of the number of stored coefficients to the size of the full matrix */
+    double compression(void) const
+        {
+        double nb = 0;
+        for (block const &b : blocks)
+            { nb += b.U.size() + b.V.size(); }
+        return nb / ((double)NOD * M);
+        }
+
+    /** number of blocks */
+    inline int getNbBlocks(void) const { return blocks.size(); }
+
+    /** true if the matrix was read from the cache */
+    inline bool isFromCache(void) const { return fromCache; }
+
+private:
+    /** \struct cluster
+    a range of permuted points and its bounding box */
+    struct cluster
+        {
+        int start;               /**< first permuted index */
+        int nb;                  /**< number of points */
+        Eigen::AlignedBox3d box; /**< bounding box */
+        int child[2];            /**< indices of the sub clusters, -1 for a leaf */
+        };
+
+    /** \struct block
+    interactions of a range of targets and a range of sources, U V^T if rank >= 0, dense U else */
+    struct block
+        {
+        int tgtStart;      /**< first permuted target */
+        int tgtNb;         /**< number of targets */
+        int srcStart;      /**< first permuted source */
+        int srcNb;         /**< number of sources */
+        int rank;          /**< number of columns of U and V, -1 for a dense block */
+        Eigen::MatrixXd U; /**< left factor, or dense block */
+        Eigen::MatrixXd V; /**< right factor, empty for a dense block */
+        };
+
+    /** \struct leaf
+    a leaf of the targets, and the blocks holding it, with the position of its first row in the block */
+    struct leaf
+        {
+        int start;                                /**< first permuted target */
+        int nb;                                   /**< number of targets */
+        std::vector<std::pair<int, int>> blocks; /**< (index of the block, row offset) */
+        };
+
+    static constexpr int leafSize = 64; /**< maximum number of points of a leaf cluster */
+    static constexpr double eta = 2.0; /**< admissibility: min(diameters) <= eta * distance */
+    static constexpr int version = 1;   /**< version of the cache file format */
+
+    const int NOD; /**< number of targets */
+    const int M;   /**< number of sources */
+
+    bool fromCache = false; /**< true if the matrix was read from the cache */
+
+    std::vector<int> tgtPerm;  /**< original index of the permuted targets */
+    std::vector<int> srcPerm;  /**< original index of the permuted sources */
+    std::vector<block> blocks; /**< blocks of the matrix */
+    std::vector<leaf> leaves;  /**< leaves of the targets, ordered */
+
+    std::vector<Eigen::VectorXd> z; /**< V^T q of the low rank blocks */
+    Eigen::VectorXd qp;             /**< permuted source densities */
+    Eigen::VectorXd yp;             /**< permuted potentials */
+
+    /** matrix vector product, restricted to the dense blocks if nearOnly is true */
+    void product(std::vector<double> const &srcDen, std::vector<double> &pot, durations &t, const bool nearOnly)
+        {
+        chronometer counter;
+        for (int j = 0; j < M; j++)
+            { qp(j) = srcDen[srcPerm[j]]; }
+        t.gather += counter.fp_elapsed();
+
+        std::for_each(std::execution::par, blocks.begin(), blocks.end(),
+                      [this, nearOnly](block const &b)
+                          {
+                          if (b.rank >= 0 && !nearOnly)
+                              { z[&b - blocks.data()] = b.V.transpose() * qp.segment(b.srcStart, b.srcNb); }
+                          });
+        std::for_each(std::execution::par, leaves.begin(), leaves.end(),
+                      [this, nearOnly](leaf const &l)
+                          {
+                          auto y = yp.segment(l.start, l.nb);
+                          y.setZero();
+                          for (auto const &[k, offset] : l.blocks)
+                              {
+                              block const &b = blocks[k];
+                              if (b.rank >= 0)
+                                  {
+                                  if (!nearOnly) y += b.U.middleRows(offset, l.nb) * z[k];
+                                  }
+                              else
+                                  { y += b.U.middleRows(offset, l.nb) * qp.segment(b.srcStart, b.srcNb); }
+                              }
+                          });
+        t.execute += counter.fp_elapsed();
+
+        for (int i = 0; i < NOD; i++)
+            { pot[tgtPerm[i]] = yp(i); }
+        t.scatter += counter.fp_elapsed();
+        }
+
+    /** FNV-1a hash of the positions and of the tolerance */
+    static uint64_t hash(std::vector<Eigen::Vector3d> const &targets,
+                         std::vector<Eigen::Vector3d> const &sources, const double tol)
+        {
+        uint64_t h = 14695981039346656037ULL;
+        auto add = [&h](const void *data, size_t size)
+            {
+            const unsigned char *p = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; i++)
+                { h = (h ^ p[i]) * 1099511628211ULL; }
+            };
+        add(targets.data(), targets.size() * sizeof(Eigen::Vector3d));
+        add(sources.data(), sources.size() * sizeof(Eigen::Vector3d));
+        add(&tol, sizeof(tol));
+        add(&eta, sizeof(eta));
+        add(&leafSize, sizeof(leafSize));
+        return h;
+        }
+
+    /** builds the cluster tree of the points pts, splitting the largest dimension of the bounding
+     * box at the median, perm is the permutation. Returns the index of the root in tree. */
+    static int buildClusters(std::vector<Eigen::Vector3d> const &pts, std::vector<int> &perm,
+                             const int start, const int nb, std::vector<cluster> &tree)
+        {
+        cluster c;
+        c.start = start;
+        c.nb = nb;
+        c.box.setEmpty();
+        for (int i = start; i < start + nb; i++)
+            { c.box.extend(pts[perm[i]]); }
+        c.child[0] = c.child[1] = -1;
+        const int k = tree.size();
+        tree.push_back(c);
+        if (nb > leafSize)
+            {
+            int d;
+            c.box.sizes().maxCoeff(&d);
+            const int half = nb / 2;
+            std::nth_element(perm.begin() + start, perm.begin() + start + half, perm.begin() + start + nb,
+                             [&pts, d](const int a, const int b) { return pts[a](d) < pts[b](d); });
+            const int c0 = buildClusters(pts, perm, start, half, tree);
+            const int c1 = buildClusters(pts, perm, start + half, nb - half, tree);
+            tree[k].child[0] = c0;
+            tree[k].child[1] = c1;
+            }
+        return k;
+        }
+
+    /** lists the blocks of the product of the cluster trees */
+    void buildBlocks(std::vector<cluster> const &tTree, std::vector<cluster> const &sTree, const int t,
+                     const int s, std::vector<std::pair<int, int>> &pairs, std::vector<bool> &admissible)
+        {
+        cluster const &ct = tTree[t];
+        cluster const &cs = sTree[s];
+        const double diam = std::min(ct.box.diagonal().norm(), cs.box.diagonal().norm());
+        const bool adm = (diam <= eta * ct.box.exteriorDistance(cs.box));
+        const bool tLeaf = (ct.child[0] < 0);
+        const bool sLeaf = (cs.child[0] < 0);
+        if (adm || (tLeaf && sLeaf))
+            {
+            pairs.emplace_back(t, s);
+            admissible.push_back(adm);
+            }
+        else if (sLeaf || (!tLeaf && ct.nb >= cs.nb))
+            {
+            for (int c : ct.child)
+                { buildBlocks(tTree, sTree, c, s, pairs, admissible); }
+            }
+        else
+            {
+            for (int c : cs.child)
+                { buildBlocks(tTree, sTree, t, c, pairs, admissible); }
+            }
+        }
+
+    /** adaptive cross approximation with partial pivoting of the block b, to the relative accuracy
+     * tol. The block is dense if the low rank factors are not smaller. */
+    static void aca(block &b, std::vector<Eigen::Vector3d> const &tgt, std::vector<Eigen::Vector3d> const &src,
+                    const double tol)
+        {
+        const int m = b.tgtNb;
+        const int n = b.srcNb;
+        const int maxRank = (m * n) / (m + n);
+        auto entry = [&tgt, &src, &b](const int i, const int j)
+            { return 1.0 / (tgt[b.tgtStart + i] - src[b.srcStart + j]).norm(); };
+
+        std::vector<Eigen::VectorXd> u, v;
+        std::vector<bool> usedRow(m, false);
+        double norm2 = 0;
+        int i = 0;
+        while ((int)u.size() < maxRank)
+            {
+            usedRow[i] = true;
+            Eigen::VectorXd row(n);
+            for (int j = 0; j < n; j++)
+                { row(j) = entry(i, j); }
+            for (unsigned l = 0; l < u.size(); l++)
+                { row -= u[l](i) * v[l]; }
+            int jp;
+            const double pivot = row.cwiseAbs().maxCoeff(&jp);
+            if (pivot > 0)
+                {
+                Eigen::VectorXd col(m);
+                for (int k = 0; k < m; k++)
+                    { col(k) = entry(k, jp); }
+                for (unsigned l = 0; l < u.size(); l++)
+                    { col -= v[l](jp) * u[l]; }
+                row /= row(jp);
+                for (unsigned l = 0; l < u.size(); l++)
+                    { norm2 += 2 * u[l].dot(col) * v[l].dot(row); }
+                const double step2 = col.squaredNorm() * row.squaredNorm();
+                norm2 += step2;
+                u.push_back(col);
+                v.push_back(row);
+                if (step2 <= tol * tol * norm2) break;
+                }
+            // next pivot row: largest entry of the last column among the unused rows
+            int next = -1;
+            double best = -1;
+            for (int k = 0; k < m; k++)
+                {
+                const double val = (pivot > 0) ? fabs(u.back()(k)) : 0;
+                if (!usedRow[k] && val > best)
+                    {
+                    best = val;
+                    next = k;
+                    }
+                }
+            if (next < 0) break;
+            i = next;
+            }
+
+        if ((int)u.size() < maxRank)
+            {
+            b.rank = u.size();
+            b.U.resize(m, b.rank);
+            b.V.resize(n, b.rank);
+            for (int l = 0; l < b.rank; l++)
+                {
+                b.U.col(l) = u[l];
+                b.V.col(l) = v[l];
+                }
+            }
+        else
+            { dense(b, tgt, src); }
+        }
+
+    /** computes the dense block b */
+    static void dense(block &b, std::vector<Eigen::Vector3d> const &tgt, std::vector<Eigen::Vector3d> const &src)
+        {
+        b.rank = -1;
+        b.U.resize(b.tgtNb, b.srcNb);
+        b.V.resize(0, 0);
+        for (int i = 0; i < b.tgtNb; i++)
+            for (int j = 0; j < b.srcNb; j++)
+                { b.U(i, j) = 1.0 / (tgt[b.tgtStart + i] - src[b.srcStart + j]).norm(); }
+        }
+
+    /** builds the cluster trees, the permutations tgtPerm and srcPerm, and the list of the pairs of
+     * clusters of the blocks */
+    void partition(std::vector<Eigen::Vector3d> const &targets, std::vector<Eigen::Vector3d> const &sources,
+                   std::vector<cluster> &tTree, std::vector<cluster> &sTree,
+                   std::vector<std::pair<int, int>> &pairs, std::vector<bool> &admissible)
+        {
+        tgtPerm.resize(NOD);
+        std::iota(tgtPerm.begin(), tgtPerm.end(), 0);
+        srcPerm.resize(M);
+        std::iota(srcPerm.begin(), srcPerm.end(), 0);
+        buildClusters(targets, tgtPerm, 0, NOD, tTree);
+        buildClusters(sources, srcPerm, 0, M, sTree);
+        buildBlocks(tTree, sTree, 0, 0, pairs, admissible);
+        }
+
+    /** computes all the blocks of the partition in parallel */
+    void assemble(std::vector<Eigen::Vector3d> const &targets, std::vector<Eigen::Vector3d> const &sources,
+                  const double tol, std::vector<cluster> const &tTree, std::vector<cluster> const &sTree,
+                  std::vector<std::pair<int, int>> const &pairs, std::vector<bool> const &admissible)
+        {
+        std::vector<Eigen::Vector3d> tgt(NOD), src(M);
+        for (int i = 0; i < NOD; i++)
+            { tgt[i] = targets[tgtPerm[i]]; }
+        for (int j = 0; j < M; j++)
+            { src[j] = sources[srcPerm[j]]; }
+
+        blocks.resize(pairs.size());
+        std::for_each(std::execution::par, blocks.begin(), blocks.end(),
+                      [&](block &b)
+                          {
+                          const int k = &b - blocks.data();
+                          b.tgtStart = tTree[pairs[k].first].start;
+                          b.tgtNb = tTree[pairs[k].first].nb;
+                          b.srcStart = sTree[pairs[k].second].start;
+                          b.srcNb = sTree[pairs[k].second].nb;
+                          if (admissible[k])
+                              { aca(b, tgt, src, tol); }
+                          else
+                              { dense(b, tgt, src); }
+                          });
+        }
+
+    /** lists for each leaf of the targets the blocks holding it. The leaves are the ranges of
+     * targets bounded by the starts and ends of all the blocks. */
+    void buildLeafBlocks(void)
+        {
+        std::vector<int> bounds = {0, NOD};
+        for (block const &b : blocks)
+            {
+            bounds.push_back(b.tgtStart);
+            bounds.push_back(b.tgtStart + b.tgtNb);
+            }
+        std::sort(bounds.begin(), bounds.end());
+        bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+        leaves.clear();
+        for (unsigned k = 0; k + 1 < bounds.size(); k++)
+            { leaves.push_back({bounds[k], bounds[k + 1] - bounds[k], {}}); }
+        for (unsigned k = 0; k < blocks.size(); k++)
+            {
+            block const &b = blocks[k];
+            auto first = std::lower_bound(bounds.begin(), bounds.end(), b.tgtStart);
+            for (int l = first - bounds.begin(); leaves[l].start < b.tgtStart + b.tgtNb; l++)
+                {
+                leaves[l].blocks.emplace_back(k, leaves[l].start - b.tgtStart);
+                if (l + 1 == (int)leaves.size()) break;
+                }
+            }
+        }
+
+    /** writes a vector of ints or a matrix to a binary stream */
+    template<typename T>
+    static void put(std::ofstream &f, T const *data, const size_t nb)
+        { f.write(reinterpret_cast<const char *>(data), nb * sizeof(T)); }
+
+    /** reads a vector of ints or a matrix from a binary stream */
+    template<typename T>
+    static void get(std::ifstream &f, T *data, const size_t nb)
+        { f.read(reinterpret_cast<char *>(data), nb * sizeof(T)); }
+
+    /** writes the matrix to the file fileName, returns true on success */
+    bool write(std::string const &fileName, const uint64_t h) const
+        {
+        std::ofstream f(fileName, std::ios::binary);
+        if (!f) return false;
+        const int header[4] = {version, NOD, M, (int)blocks.size()};
+        put(f, &h, 1);
+        put(f, header, 4);
+        put(f, tgtPerm.data(), NOD);
+        put(f, srcPerm.data(), M);
+        for (block const &b : blocks)
+            {
+            const int dims[5] = {b.tgtStart, b.tgtNb, b.srcStart, b.srcNb, b.rank};
+            put(f, dims, 5);
+            put(f, b.U.data(), b.U.size());
+            put(f, b.V.data(), b.V.size());
+            }
+        return f.good();
+        }
+
+    /** reads the matrix from the file fileName, returns false if there is no such file, if it
+     * does not match the hash h, or if its permutations and blocks do not match the partition of
+     * the cluster trees tTree and sTree, see partition() */
+    bool read(std::string const &fileName, const uint64_t h, std::vector<cluster> const &tTree,
+              std::vector<cluster> const &sTree, std::vector<std::pair<int, int>> const &pairs,
+              std::vector<bool> const &admissible)
+        {
+        std::ifstream f(fileName, std::ios::binary);
+        if (!f) return false;
+        uint64_t fileHash;
+        int header[4];
+        get(f, &fileHash, 1);
+        get(f, header, 4);
+        if (!f || fileHash != h || header[0] != version || header[1] != NOD || header[2] != M
+            || header[3] != (int)pairs.size())
+            return false;
+        std::vector<int> perm(NOD);
+        get(f, perm.data(), NOD);
+        if (!f || perm != tgtPerm) return false;
+        perm.resize(M);
+        get(f, perm.data(), M);
+        if (!f || perm != srcPerm) return false;
+
+        blocks.resize(pairs.size());
+        for (unsigned k = 0; k < blocks.size() && f; k++)
+            {
+            block &b = blocks[k];
+            int dims[5];
+            get(f, dims, 5);
+            b.tgtStart = dims[0];
+            b.tgtNb = dims[1];
+            b.srcStart = dims[2];
+            b.srcNb = dims[3];
+            b.rank = dims[4];
+            cluster const &ct = tTree[pairs[k].first];
+            cluster const &cs = sTree[pairs[k].second];
+            const int maxRank = (ct.nb * cs.nb) / (ct.nb + cs.nb);
+            if (!f || b.tgtStart != ct.start || b.tgtNb != ct.nb || b.srcStart != cs.start || b.srcNb != cs.nb
+                || b.rank < -1 || b.rank >= maxRank || (b.rank >= 0 && !admissible[k]))
+                {
+                blocks.clear();
+                return false;
+                }
+            if (b.rank >= 0)
+                {
+                b.U.resize(b.tgtNb, b.rank);
+                b.V.resize(b.srcNb, b.rank);
+                }
+            else
+                {
+                b.U.resize(b.tgtNb, b.srcNb);
+                b.V.resize(0, 0);
+                }
+            get(f, b.U.data(), b.U.size());
+            get(f, b.V.data(), b.V.size());
+            }
+        if (!f)
+            {
+            blocks.clear();
+            return false;
+            }
+        return true;
+        }
+    };
+
+    }  // namespace Demag
+#endif
@@ -5,6 +5,7 @@
   when STT computation is involved.
  */
 
+#include <execution>
 #include <iostream>
 #include <map>
 
@@ -44,7 +45,7 @@ void integrales(Tetra::Tet const &tet, double sigma, double AE[Tetra::N][Tetra::
     {
     for (int npi = 0; npi < Tetra::NPI; npi++)
         {
-        double w = tet.weight[npi];
+        double w = tet.weight(npi);
 
         for (int ie = 0; ie < Tetra::N; ie++)
             {
@@ -117,18 +118,19 @@ public:
                     std::cout << "file " << fileName << " status : " << iznogood << std::endl;
                     }
                 }
-            std::for_each(msh.tet.begin(), msh.tet.end(),
+            stt.sigma = p_stt.sigma;
+            stt.ksi = ksi;
+            stt.pf = pf;
+            stt.D0 = D0;
+            stt.lJ = p_stt.lJ;
+            stt.gradV.resize(msh.tet.size());
+            stt.Hm.resize(msh.tet.size());
+            std::for_each(std::execution::par, msh.tet.begin(), msh.tet.end(),
                           [this](Tetra::Tet const &tet)
                           {
-                              std::array<Eigen::Vector3d, Tetra::NPI> _gradV;
-                              calc_gradV(tet, _gradV);
-                              gradV.push_back(_gradV);
-
-                              std::array<Eigen::Vector3d, Tetra::NPI> _Hm;
-                              calc_Hm(tet, _gradV, _Hm);
-                              Hm.push_back(_Hm);
+                              stt.gradV[tet.idx] = calc_gradV(tet);
+                              calc_Hm(tet, stt.gradV[tet.idx], stt.Hm[tet.idx]);
                           });
-            prepareExtras();
             }
         else
             {
@@ -137,77 +139,30 @@ public:
             }
         }
 
-    /** computes the gradient(V) for tetra tet */
-    void calc_gradV(Tetra::Tet const &tet, std::array<Eigen::Vector3d, Tetra::NPI> &_gradV) const
+    /** returns the gradient(V) for tetra tet, it is constant over the tetrahedron */
+    Eigen::Vector3d calc_gradV(Tetra::Tet const &tet) const
         {
-        for (int npi = 0; npi < Tetra::NPI; npi++)
-            {
-            double vx(0), vy(0), vz(0);
-            for (int i = 0; i < Tetra::N; i++)
-                {
-                const double V_tet = V[tet.ind[i]];
-                vx += V_tet * tet.dadx(i,npi);
-                vy += V_tet * tet.dady(i,npi);
-                vz += V_tet * tet.dadz(i,npi);
-                }
-            _gradV[npi] = Eigen::Vector3d(vx, vy, vz);
-            }
+        Eigen::Matrix<double,Tetra::N,1> V_nod;
+        for (int i = 0; i < Tetra::N; i++)
+            { V_nod(i) = V[tet.ind[i]]; }
+        return tet.da().transpose() * V_nod;
         }
 
     /** computes Hm contributions for each npi for tetrahedron tet */
-    void calc_Hm(Tetra::Tet const &tet, std::array<Eigen::Vector3d, Tetra::NPI> const &_gradV,
-                 std::array<Eigen::Vector3d, Tetra::NPI> &_Hm) const
+    void calc_Hm(Tetra::Tet const &tet, Eigen::Vector3d const &_gradV,
+                 Eigen::Matrix<double,Nodes::DIM,Tetra::NPI> &_Hm) const
         {
         Eigen::Matrix<double,Nodes::DIM,Tetra::NPI> p_g;
         tet.getPtGauss(p_g);
 
         for (int npi = 0; npi < Tetra::NPI; npi++)
-            { _Hm[npi] = -p_stt.sigma * _gradV[npi].cross(p_g.col(npi)); }
+            { _Hm.col(npi) = -p_stt.sigma * _gradV.cross(p_g.col(npi)); }
         }
 
-private:
-    /** affect extraField function and extraCoeffs_BE function for all the tetrahedrons */
-    void prepareExtras(void)
-        {
-        std::for_each(
-                msh.tet.begin(), msh.tet.end(),
-                [this](Tetra::Tet &tet)
-                {
-                    const int _idx = tet.idx;
-                    tet.extraField = [this, _idx](Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::NPI>> H)
-                    {
-                    for(int npi = 0; npi<Tetra::NPI; npi++) { H.col(npi) += Hm[_idx][npi]; }
-                    };
-
-                    tet.extraCoeffs_BE = [this, &tet](double Js, Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::NPI>> U,
-                                                      Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::NPI>> dUdx,
-                                                      Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::NPI>> dUdy,
-                                                      Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::NPI>> dUdz,
-                                                      Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::N>> BE)
-                    {
-                    const double prefactor = D0 / Nodes::sq(p_stt.lJ) / (gamma0 * nu0 * Js); //nu0*Js shall be replaced by tet.Ms
-                    for (int npi = 0; npi < Tetra::NPI; npi++)
-                        {
-                        Eigen::Vector3d const &_gV = gradV[tet.idx][npi];
-                        Eigen::Vector3d j_grad_u =
-                                -p_stt.sigma
-                                * Eigen::Vector3d(_gV.dot( Eigen::Vector3d(dUdx(Nodes::IDX_X,npi), dUdy(Nodes::IDX_X,npi), dUdz(Nodes::IDX_X,npi))),
-                                                  _gV.dot( Eigen::Vector3d(dUdx(Nodes::IDX_Y,npi), dUdy(Nodes::IDX_Y,npi), dUdz(Nodes::IDX_Y,npi))),
-                                                  _gV.dot( Eigen::Vector3d(dUdx(Nodes::IDX_Z,npi), dUdy(Nodes::IDX_Z,npi), dUdz(Nodes::IDX_Z,npi))));
-
-                        Eigen::Vector3d m = pf * (ksi * j_grad_u + U.col(npi).cross(j_grad_u));
-                        Eigen::Vector3d interim[Tetra::N];
-                        for (int i = 0; i < Tetra::N; i++)
-                            {
-                            const double ai_w = tet.weight[npi] * Tetra::a[i][npi];
-                            interim[i] = ai_w*(Hm[tet.idx][npi] + prefactor*m);
-                            }
-                        for (int i = 0; i < Tetra::N; i++) { BE.col(i) += interim[i]; }
-                        } // end loop on npi
-                    }; //end lambda
-                });//end for_each 
-        }
+    /** returns the contributions of the spin transfer torque to the integrales of the tetrahedrons */
+    inline Tetra::sttTerms const &getSTT(void) const { return stt; }
 
+private:
     /** ksi is in Thiaville notations beta_DW */
     double ksi;
 
@@ -219,7 +174,7 @@ private:
 
     /** mesh object to store nodes, fac, tet, and others geometrical values related to the mesh (
      * const ref ) */
-    Mesh::mesh msh;
+    Mesh::mesh const &msh;
 
     /** spin transfer torque parameters */
     STT p_stt;
@@ -240,12 +195,8 @@ private:
      * of nodes */
     std::vector<double> V;
 
-    /** table of the gradients of the potential, gradV.size() is the number of tetra */
-    std::vector<std::array<Eigen::Vector3d, Tetra::NPI>> gradV;
-
-    /** table of the Hm vectors (contribution of the STT to the tet::integrales) ; Hm.size() is the
-     * number of tetra */
-    std::vector<std::array< Eigen::Vector3d, Tetra::NPI>> Hm;
+    /** tables of the gradients of the potential and of the Hm vectors, indexed by Tet::idx */
+    Tetra::sttTerms stt;
 
     /** basic informations on boundary conditions */
     inline void infos(void)
@@ -2,16 +2,33 @@
 #define element_h
 
 #include <execution>
+#include <functional>
 
 #include <eigen3/Eigen/Sparse>
 #include <eigen3/Eigen/Dense>
 
 #include "node.h"
 
+/** \struct Energies
+energy terms of an element or of the whole mesh, the addition is used by the reductions of
+Fem::energy
+*/
+struct Energies
+    {
+    double exch = 0.0;   /**< exchange energy */
+    double aniso = 0.0;  /**< anisotropy energy */
+    double demag = 0.0;  /**< demagnetizing energy */
+    double zeeman = 0.0; /**< zeeman energy */
+
+    /** termwise sum */
+    inline Energies operator+(Energies const &e) const
+        { return Energies{exch + e.exch, aniso + e.aniso, demag + e.demag, zeeman + e.zeeman}; }
+    };
+
 /** \class element
 \brief Template abstract class, mother class for tetraedrons and facettes.
 
-template parameters are N number of sommits and NPI number of interpolation points. It contains a list of indices to the N nodes of the element, a reference to the full nodes vector, and index refering to the associated material parameters. All indices are zero based, derived class constructor should call zerobasing() if needed. It contains also the vector and matrix weight, Kp, Lp, P related to finite element computations. weight values are not initialized, they have to be set by derived class constructor.
+template parameters are N number of sommits and NPI number of interpolation points. It contains a list of indices to the N nodes of the element, a reference to the nodes storage of the mesh, and index refering to the associated material parameters. All indices are zero based, derived class constructor should call zerobasing() if needed. It contains also the matrices Kp, Lp, P related to finite element computations. The weights of the Gauss points are provided by the derived classes.
 Member function getPtGauss() returns Gauss points.
 orientate() is a pure virtual function, it should manipulate indices to orientate positively the element.
 Magnetization at saturation Ms is also stored in class element instead of prm class associated to derived class tetra and facette.
@@ -22,7 +39,7 @@ class element
     {
     /** constructor */
     public:
-    element(const std::vector<Nodes::Node> &_p_node /**< vector of nodes */,
+    element(const Nodes::Store &_p_node /**< nodes storage */,
             const int _idx /**< index to params */,
             std::initializer_list<int> & _i /**< indices to the nodes */
             ) : idxPrm(_idx), Ms(0), refNode(_p_node)
@@ -46,9 +63,6 @@ class element
     /** magnetization at saturation of the element */
     double Ms;
     
-    /** weights hat function of the element */
-    Eigen::Matrix<double,NPI,1> weight;
-
     /** matrix for integrales */
     Eigen::Matrix<double,2*N,2*N> Kp;
 
@@ -69,12 +83,12 @@ class element
         {
         for (int i = 0; i < N; i++)
             {
-            const Eigen::Vector3d &ep = getNode(i).ep;
+            const Eigen::Vector3d &ep = getNode<Nodes::VEC_EP>(i);
             P(i,i) = ep.x();
             P(i,N + i) = ep.y();
             P(i,2 * N + i) = ep.z();
 
-            const Eigen::Vector3d &eq = getNode(i).eq;
+            const Eigen::Vector3d &eq = getNode<Nodes::VEC_EQ>(i);
             P(N + i,i) = eq.x();
             P(N + i,N + i) = eq.y();
             P(N + i,2 * N + i) = eq.z();
@@ -123,12 +137,51 @@ class element
         std::cout << ind[N-1] << ")\n";
         };
     
+    /** returns the vector field F at the N nodes of the element, column i for node ind[i] */
+    template<Nodes::vectorField F>
+    inline Eigen::Matrix<double,Nodes::DIM,N> gather(void) const
+        {
+        Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
+        for (int i = 0; i < N; i++) vec_nod.col(i) = getNode<F>(i);
+        return vec_nod;
+        }
+
+    /** returns the scalar field F at the N nodes of the element */
+    template<Nodes::scalarField F>
+    inline Eigen::Matrix<double,N,1> gather(void) const
+        {
+        Eigen::Matrix<double,N,1> scalar_nod;
+        for (int i = 0; i < N; i++) scalar_nod(i) = refNode.get<F>(ind[i]);
+        return scalar_nod;
+        }
+
     /** computes Gauss point of the element, return in result */
     virtual void getPtGauss(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> result) const = 0;
 
     protected:
-        /** returns reference to node at ind[i] from mesh node vector */
-        inline const Nodes::Node & getNode(const int i) const { return refNode[ind[i]]; }
+        /** returns reference to the vector field F of node ind[i] from the mesh nodes storage */
+        template<Nodes::vectorField F>
+        inline const Eigen::Vector3d &getNode(const int i) const { return refNode.get<F>(ind[i]); }
+
+        /** same as gather<F>() for a vector field given by a getter at runtime, the getter is called
+         * on a copy of each node */
+        inline Eigen::Matrix<double,Nodes::DIM,N>
+        gather(std::function<Eigen::Vector3d(Nodes::Node const &)> const &getter) const
+            {
+            Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
+            for (int i = 0; i < N; i++) vec_nod.col(i) = getter(refNode.getNode(ind[i]));
+            return vec_nod;
+            }
+
+        /** same as gather<F>() for a scalar field given by a getter at runtime, the getter is called
+         * on a copy of each node */
+        inline Eigen::Matrix<double,N,1>
+        gather(std::function<double(Nodes::Node const &)> const &getter) const
+            {
+            Eigen::Matrix<double,N,1> scalar_nod;
+            for (int i = 0; i < N; i++) scalar_nod(i) = getter(refNode.getNode(ind[i]));
+            return scalar_nod;
+            }
 
         /** returns true if mesh node vector is not empty */
         inline bool existNodes(void)
@@ -139,8 +192,8 @@ class element
             { std::for_each(ind.begin(),ind.end(),[](int & _i){ _i--; } ); }
 
     private:
-        /** vector of nodes */
-        const std::vector<Nodes::Node> & refNode;
+        /** nodes storage */
+        const Nodes::Store & refNode;
 
         /** a method to orientate the element */
         virtual void orientate() = 0;
@@ -1,44 +1,99 @@
+#include <numeric>
+
 #include "fem.h"
 
-void Fem::energy(double const t, Settings &settings)
+namespace
     {
-    zeroEnergy();
-    Eigen::Vector3d Hext = settings.getField(t);
+/** energies of a tetrahedron */
+Energies tetEnergy(Tetra::Tet const &te, Tetra::prm const &param, Eigen::Vector3d const &Hext)
+    {
+    Energies E;
+    Eigen::Matrix<double,Nodes::DIM,Tetra::NPI> u,dudx,dudy,dudz;
+    Eigen::Matrix<double,Tetra::NPI,1> phi;
 
-    std::for_each(msh.tet.begin(), msh.tet.end(),
-                  [this, &Hext, &settings](Tetra::Tet const &te)
-                  {
-                      Tetra::prm const &param = settings.paramTetra[te.idxPrm];
-                      Eigen::Matrix<double,Nodes::DIM,Tetra::NPI> u,dudx,dudy,dudz;
-                      Eigen::Matrix<double,Tetra::NPI,1> phi;
+    te.interpolation<Nodes::VEC_U>(u, dudx, dudy, dudz);
+    te.interpolation<Nodes::SCAL_PHI>(phi);
 
-                      te.interpolation(Nodes::get_u, u, dudx, dudy, dudz);
-                      te.interpolation(Nodes::get_phi, phi);
+    E.exch = te.exchangeEnergy(param, dudx, dudy, dudz);
+    E.demag = te.demagEnergy(dudx, dudy, dudz, phi);
 
-                      E_exch += te.exchangeEnergy(param, dudx, dudy, dudz);
-                      E_demag += te.demagEnergy(dudx, dudy, dudz, phi);
+    if ((param.K != 0.0) || (param.K3 != 0.0))
+        { E.aniso = te.anisotropyEnergy(param, u); }
 
-                      if ((param.K != 0.0) || (param.K3 != 0.0))
-                          { E_aniso += te.anisotropyEnergy(param, u); }
+    E.zeeman = te.zeemanEnergy(param, Hext, u);
+    return E;
+    }
+
+/** energies of a facette */
+Energies facEnergy(Facette::Fac const &fa, Facette::prm const &param)
+    {
+    Energies E;
+    Eigen::Matrix<double,Facette::NPI,1> phi;
+    Eigen::Matrix<double,Nodes::DIM,Facette::NPI> u;
 
-                      E_zeeman += te.zeemanEnergy(param, Hext, u);
-                  });
+    fa.interpolation<Nodes::VEC_U>(u);
+    fa.interpolation<Nodes::SCAL_PHI>(phi);
 
-    std::for_each(msh.fac.begin(), msh.fac.end(),
-                  [this, &settings](Facette::Fac const &fa)
-                  {
-                      Facette::prm const &param = settings.paramFacette[fa.idxPrm];
-                      Eigen::Matrix<double,Facette::NPI,1> phi;
-                      Eigen::Matrix<double,Nodes::DIM,Facette::NPI> u;
+    if (param.Ks != 0.0)
+        { E.aniso = fa.anisotropyEnergy(param, u); }
 
-                      fa.interpolation(Nodes::get_u, u);
-                      fa.interpolation(Nodes::get_phi, phi);
+    E.demag = fa.demagEnergy(u, phi);
+    return E;
+    }
+
+/** parallel sum of f over the elements. If deterministic is true, the sum is sequential in the
+ * order of the elements, so that the result does not depend on the number of threads */
+template<class T, class F>
+Energies sum(std::vector<T> const &elem, F f, const bool deterministic)
+    {
+    if (deterministic)
+        {
+        std::vector<Energies> e(elem.size());
+        std::transform(std::execution::par, elem.begin(), elem.end(), e.begin(), f);
+        return std::accumulate(e.begin(), e.end(), Energies());
+        }
+    return std::transform_reduce(std::execution::par, elem.begin(), elem.end(), Energies(),
+                                 std::plus<Energies>(), f);
+    }
+    }  // namespace
+
+void Fem::energy(double const t, Settings &settings)
+    {
+    Eigen::Vector3d Hext = settings.getField(t);
+
+    Energies E = sum(msh.tet,
+                     [&Hext, &settings](Tetra::Tet const &te)
+                     { return tetEnergy(te, settings.paramTetra[te.idxPrm], Hext); },
+                     settings.deterministicEnergy);
+    setEnergies(E + facettesEnergy(settings), settings);
+    }
+
+void Fem::fusedEnergy(Settings &settings)
+    {
+    Energies E;
+    if (settings.deterministicEnergy)
+        { E = std::accumulate(tetEnergies.begin(), tetEnergies.end(), E); }
+    else
+        { E = std::reduce(std::execution::par, tetEnergies.begin(), tetEnergies.end(), E); }
+    setEnergies(E + facettesEnergy(settings), settings);
+    }
+
+Energies Fem::facettesEnergy(Settings const &settings) const
+    {
+    return sum(msh.fac,
+               [&settings](Facette::Fac const &fa)
+               { return facEnergy(fa, settings.paramFacette[fa.idxPrm]); },
+               settings.deterministicEnergy);
+    }
+
+void Fem::setEnergies(Energies const &E, Settings const &settings)
+    {
+    E_exch = E.exch;
+    E_aniso = E.aniso;
+    E_demag = E.demag;
+    E_zeeman = E.zeeman;
+    energyUpToDate = true;
 
-                      if (param.Ks != 0.0)
-                          { E_aniso += fa.anisotropyEnergy(param, u); }
-                      
-                      E_demag += fa.demagEnergy(u, phi);
-                  });
     calc_Etot();
     if (settings.verbose && (Etot > Etot0))
         { std::cout << "WARNING: energy increased from " << Etot0 << " to " << Etot << "\n"; }
@@ -8,7 +8,7 @@ void Fac::integrales(Facette::prm const &params)
     double Kbis = 2.0*params.Ks / Ms;
     
     Eigen::Matrix<double,DIM,NPI> u;
-    interpolation(Nodes::get_u0, u);
+    interpolation<Nodes::VEC_U0>(u);
 
     Eigen::Matrix<double,DIM,N> BE;
     BE.setZero();
@@ -43,12 +43,23 @@ double Fac::anisotropyEnergy(Facette::prm const &param,
     return -param.Ks*weight.dot(dens);
     }
 
-Eigen::Matrix<double,NPI,1> Fac::charges(std::function<Eigen::Vector3d(Nodes::Node)> getter, std::vector<double> &corr) const
+Eigen::Matrix<double,NPI,1> Fac::charges(std::function<Eigen::Vector3d(Nodes::Node const &)> getter, std::vector<double> &corr) const
     {
-    Eigen::Matrix<double,DIM,N> vec_nod;
-    for(int i=0;i<N;i++)
-        vec_nod.col(i) << getter(getNode(i));
+    return charges(gather(getter), corr);
+    }
 
+Eigen::Matrix<double,NPI,1> Fac::charges(Eigen::Matrix<double,DIM,N> const &vec_nod, std::vector<double> &corr) const
+    {
+    Eigen::Matrix<double,N,1> nodCorr;
+    Eigen::Matrix<double,NPI,1> result = charges(vec_nod, nodCorr);
+    for (int i = 0; i < N; i++)
+        { corr[ind[i]] += nodCorr(i); }
+    return result;
+    }
+
+Eigen::Matrix<double,NPI,1> Fac::charges(Eigen::Matrix<double,DIM,N> const &vec_nod,
+                                         Eigen::Ref<Eigen::Matrix<double,N,1>> nodCorr) const
+    {
     Eigen::Matrix<double,DIM,NPI> _u = vec_nod * eigen_a;
 
     Eigen::Matrix<double,NPI,1> result = Ms*weight.cwiseProduct( _u.transpose()*n );
@@ -57,16 +68,16 @@ Eigen::Matrix<double,NPI,1> Fac::charges(std::function<Eigen::Vector3d(Nodes::No
     // calc corr node by node
     for (int i = 0; i < N; i++)
         {
-        const int i_ = ind[i];
-        const Eigen::Vector3d &p_i_ = getNode(i).p;
+        const Eigen::Vector3d &p_i_ = getNode<Nodes::VEC_P>(i);
+        nodCorr(i) = 0;
         for (int j = 0; j < NPI; j++)
             {
             double d_ij= (p_i_ - gauss.col(j)).norm();
-            corr[i_] -= result(j)/d_ij;//Ms * pScal(u[j], n) * weight(j) / d_ij;
+            nodCorr(i) -= result(j)/d_ij;//Ms * pScal(u[j], n) * weight(j) / d_ij;
             }
-        corr[i_] += potential(getter, i);
+        nodCorr(i) += potential(vec_nod, i);
         }
-    
+
     return result;
     }
 
@@ -76,17 +87,18 @@ double Fac::demagEnergy(Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> u, Eigen::Ref<
     return 0.5*mu0*Ms*dens.dot(weight);
     }
 
-double Fac::potential(std::function<Eigen::Vector3d(Nodes::Node)> getter, int i) const
+double Fac::potential(std::function<Eigen::Vector3d(Nodes::Node const &)> getter, int i) const
+    {
+    return potential(gather(getter), i);
+    }
+
+double Fac::potential(Eigen::Matrix<double,DIM,N> const &vec_nod, int i) const
     {
     int ii = (i + 1) % 3;
     int iii = (i + 2) % 3;
 
-    Nodes::Node const &node1 = getNode(i);
-    Nodes::Node const &node2 = getNode(ii);
-    Nodes::Node const &node3 = getNode(iii);
-
-    Eigen::Vector3d p1p2 = node2.p - node1.p;
-    Eigen::Vector3d p1p3 = node3.p - node1.p;
+    Eigen::Vector3d p1p2 = getNode<Nodes::VEC_P>(ii) - getNode<Nodes::VEC_P>(i);
+    Eigen::Vector3d p1p3 = getNode<Nodes::VEC_P>(iii) - getNode<Nodes::VEC_P>(i);
 
     std::function<double(double)> f = [](double x) { return sqrt(1.0 + x * x); };
 
@@ -106,9 +118,9 @@ double Fac::potential(std::function<Eigen::Vector3d(Nodes::Node)> getter, int i)
     double log_1 = log((c * t + h + f(c) * r) / (b * (c + f(c))));
     double xi = b * log_1 / f(c);
 
-    double s1 = getter(node1).dot(n);
-    double s2 = getter(node2).dot(n);
-    double s3 = getter(node3).dot(n);
+    double s1 = vec_nod.col(i).dot(n);
+    double s2 = vec_nod.col(ii).dot(n);
+    double s3 = vec_nod.col(iii).dot(n);
 
     double pot = xi * s1
                  + ((xi * (h + c * t) - b * (r - b)) * s2 + b * (r - b - c * xi) * s3) * b
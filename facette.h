@@ -69,7 +69,7 @@ class Fac : public element<N,NPI>
     {
 public:
     /** constructor used by readMesh */
-    inline Fac(const std::vector<Nodes::Node> &_p_node /**< [in] vector of nodes */,
+    inline Fac(const Nodes::Store &_p_node /**< [in] nodes storage */,
                const int _NOD /**< [in] nb nodes */,
                const int _idx /**< [in] region index in region vector */,
                std::initializer_list<int> _i /**< [in] node index */)
@@ -97,28 +97,43 @@ public:
     /** normal vector (unit vector) */
     Eigen::Vector3d n;
 
+    /** weights hat function of the element */
+    Eigen::Matrix<double,NPI,1> weight;
+
+    /** interpolation function on the vector field F of the nodes, selected at compile time.
+    result = vec_nod * a
+    */
+    template<Nodes::vectorField F>
+    void interpolation(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> result /**< [out] */) const
+        {
+        result = gather<F>() * eigen_a;
+        }
+
+    /** interpolation function on the scalar field F of the nodes, selected at compile time.
+     mind the transposition: result = transpose(scalar_nod) * a
+    */
+    template<Nodes::scalarField F>
+    void interpolation(Eigen::Ref<Eigen::Matrix<double,NPI,1>> result /**< [out] */) const
+        {
+        result = gather<F>().transpose() * eigen_a;
+        }
+
     /** interpolation function on the output of the getter.
-    result = vec_nod * a 
+    result = vec_nod * a. Prefer interpolation<F>() in hot loops
     */
-    void interpolation(std::function<Eigen::Vector3d(Nodes::Node)> getter /**< [in] */,
+    void interpolation(std::function<Eigen::Vector3d(Nodes::Node const &)> getter /**< [in] */,
                        Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> result /**< [out] */) const
         {
-        Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
-        for (int i = 0; i < N; i++) vec_nod.col(i) = getter(getNode(i));
-        
-        result = vec_nod * eigen_a;
+        result = gather(getter) * eigen_a;
         }
 
     /** interpolation function on the output of the getter,
-     mind the transposition: result = transpose(scalar_nod) * a
+     mind the transposition: result = transpose(scalar_nod) * a. Prefer interpolation<F>() in hot loops
     */
-    void interpolation(std::function<double(Nodes::Node)> getter /**< [in] */,
+    void interpolation(std::function<double(Nodes::Node const &)> getter /**< [in] */,
                        Eigen::Ref<Eigen::Matrix<double,NPI,1>> result /**< [out] */) const
         {
-        Eigen::Matrix<double,N,1> scalar_nod;
-        for (int i = 0; i < N; i++) scalar_nod(i) = getter(getNode(i));
-        
-        result = scalar_nod.transpose() * eigen_a;
+        result = gather(getter).transpose() * eigen_a;
         }
 
     /** computes the integral contribution of the triangular face, the only contribution comes from Neel surface anisotropy */
@@ -128,16 +143,43 @@ public:
     double anisotropyEnergy(Facette::prm const &param /**< [in] */,
                             Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> const u /**< [in] */) const;
 
-    /** return surface charges and computes some corrections */
-    Eigen::Matrix<double,NPI,1> charges(std::function<Eigen::Vector3d(Nodes::Node)> getter /**< [in] */,
+    /** return surface charges of the vector field F and computes some corrections */
+    template<Nodes::vectorField F>
+    Eigen::Matrix<double,NPI,1> charges(std::vector<double> &corr /**< [in|out]*/ ) const
+        {
+        return charges(gather<F>(), corr);
+        }
+
+    /** return surface charges of the vector field F, the corrections of the facette are returned
+     * in nodCorr, nodCorr(i) is the correction for node ind[i] */
+    template<Nodes::vectorField F>
+    Eigen::Matrix<double,NPI,1> charges(Eigen::Ref<Eigen::Matrix<double,N,1>> nodCorr /**< [out]*/ ) const
+        {
+        return charges(gather<F>(), nodCorr);
+        }
+
+    /** return surface charges and computes some corrections, the vector field is given by a getter */
+    Eigen::Matrix<double,NPI,1> charges(std::function<Eigen::Vector3d(Nodes::Node const &)> getter /**< [in] */,
+                                      std::vector<double> &corr /**< [in|out]*/ ) const;
+
+    /** return surface charges and computes some corrections, from the values of the vector field at the nodes */
+    Eigen::Matrix<double,NPI,1> charges(Eigen::Matrix<double,Nodes::DIM,N> const &vec_nod /**< [in] */,
                                       std::vector<double> &corr /**< [in|out]*/ ) const;
 
+    /** return surface charges from the values of the vector field at the nodes, the corrections of the
+     * facette are returned in nodCorr */
+    Eigen::Matrix<double,NPI,1> charges(Eigen::Matrix<double,Nodes::DIM,N> const &vec_nod /**< [in] */,
+                                      Eigen::Ref<Eigen::Matrix<double,N,1>> nodCorr /**< [out]*/ ) const;
+
     /** demagnetizing energy of the facette */
     double demagEnergy(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> u /**< [in] */,
                        Eigen::Ref<Eigen::Matrix<double,NPI,1>> phi /**< [in] */) const;
 
     /** computes correction on potential*/
-    double potential(std::function<Eigen::Vector3d(Nodes::Node)> getter, int i) const;
+    double potential(std::function<Eigen::Vector3d(Nodes::Node const &)> getter, int i) const;
+
+    /** computes correction on potential, from the values of the vector field at the nodes */
+    double potential(Eigen::Matrix<double,Nodes::DIM,N> const &vec_nod, int i) const;
 
     /** lexicographic order on indices */
     inline bool operator<(const Fac &f) const
@@ -162,7 +204,7 @@ public:
         Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
         for (int i = 0; i < N; i++)
             {
-            vec_nod.col(i) << getNode(i).p;
+            vec_nod.col(i) << getNode<Nodes::VEC_P>(i);
             }
         result = vec_nod * eigen_a;
         }
@@ -176,8 +218,8 @@ private:
     /** return normal to the triangular face, not normalized */
     inline Eigen::Vector3d normal_vect() const
         {
-        Eigen::Vector3d p0p1 = getNode(1).p - getNode(0).p;
-        Eigen::Vector3d p0p2 = getNode(2).p - getNode(0).p;
+        Eigen::Vector3d p0p1 = getNode<Nodes::VEC_P>(1) - getNode<Nodes::VEC_P>(0);
+        Eigen::Vector3d p0p2 = getNode<Nodes::VEC_P>(2) - getNode<Nodes::VEC_P>(0);
 
         return p0p1.cross(p0p2);
         }
@@ -1,6 +1,6 @@
 #include <iostream>
 #include <string>
-#include <unistd.h>  // for sysconf(), gethostname()
+#include <unistd.h>  // for gethostname()
 
 #include "tags.h"
 #include "feellgoodSettings.h"
@@ -105,6 +105,10 @@ bool isOrthogonal(Eigen::Ref<Eigen::Vector3d> a, Eigen::Ref<Eigen::Vector3d> b,
     return val;
     }
 
+// Names of the accuracies of the demagnetizing field solver, and the matching orders of the
+// multipole expansions.
+static const std::pair<std::string, int> fmmAccuracies[] = {{"low", 5}, {"medium", 9}, {"high", 13}};
+
 /***********************************************************************
  * Public API.
  */
@@ -114,6 +118,8 @@ Settings::Settings()
     precision = 7;  // precision is 7 digits : smaller digits of node::potential phi are varying due
                     // to residual errors
     verbose = 0;
+    calibrateFmm = 0;
+    compareOrderings = 0;
     withTsv = true;
     read(YAML::Load(get_default_yaml()));  // load defaults
     }
@@ -133,9 +139,16 @@ void Settings::infos()
         std::cout << "    - " << *it << "\n";
         }
     std::cout << "  mag_config_every: " << save_period << "\n";
+    std::cout << "  mag_config_format: " << (binarySol ? "binary" : "text") << "\n";
+    std::cout << "  mag_config_single_precision: " << str(solSinglePrecision) << "\n";
+    std::cout << "  deterministic_energy: " << str(deterministicEnergy) << "\n";
+    std::cout << "  fused_energy: " << str(fusedEnergy) << "\n";
     std::cout << "mesh:\n";
     std::cout << "  filename: " << pbName << "\n";
     std::cout << "  length_unit: " << _scale << "\n";
+    std::cout << "  cache: " << str(meshCache) << "\n";
+    std::cout << "  node_ordering: " << Ordering::name(nodeOrdering) << "\n";
+    std::cout << "  sort_tetrahedrons: " << str(sortTetrahedrons) << "\n";
     std::cout << "  volume_regions:\n";
     for (auto it = paramTetra.begin(); it != paramTetra.end(); ++it)
         {
@@ -217,12 +230,38 @@ void Settings::infos()
             }
         }
 
+    std::cout << "threads:\n";
+    std::cout << "  total: " << threadsConfig.total << "\n";
+    std::cout << "  pinning: " << Threads::name(threadsConfig.pin) << "\n";
+    std::cout << "  first_touch: " << str(threadsConfig.firstTouch) << "\n";
     std::cout << "demagnetizing_field_solver:\n";
     std::cout << "  nb_threads: " << scalfmmNbTh << "\n";
+    std::cout << "  method: " << Demag::name(demagMethod) << "\n";
+    std::cout << "  hmatrix_tolerance: " << hmatTolerance << "\n";
+    std::cout << "  hmatrix_cache: " << hmatCacheDir << "\n";
+    for (auto const &acc : fmmAccuracies)
+        {
+        if (acc.second == fmmOrder) std::cout << "  accuracy: " << acc.first << "\n";
+        }
+    std::cout << "  tree_height: " << fmmTreeHeight << "\n";
+    std::cout << "  precision: " << Demag::name(fmmPrecision) << "\n";
+    std::cout << "  incremental:\n";
+    std::cout << "    enable: " << str(incrementalDemag) << "\n";
+    std::cout << "    max(steps): " << incrementalMaxSteps << "\n";
+    std::cout << "    skip_far_field: " << str(incrementalSkipFarField) << "\n";
+    std::cout << "    threshold: " << incrementalThreshold << "\n";
+    std::cout << "  pipeline: " << str(demagPipeline) << "\n";
     std::cout << "finite_element_solver:\n";
     std::cout << "  nb_threads: " << solverNbTh << "\n";
     std::cout << "  max(iter): " << MAXITER << "\n";
     std::cout << "  tolerance: " << TOL << "\n";
+    std::cout << "  matrix_free: " << str(matrixFree) << "\n";
+    std::cout << "  element_batch_size: " << elementBatchSize << "\n";
+    std::cout << "  preconditioner: " << Precond::name(precondType) << "\n";
+    std::cout << "  preconditioner_reuse:\n";
+    std::cout << "    max(steps): " << precondReuseSteps << "\n";
+    std::cout << "    max(dt_change): " << precondReuseDt << "\n";
+    std::cout << "    max(iter): " << precondRefreshIter << "\n";
     std::cout << "time_integration:\n";
     std::cout << "  max(du): " << DUMAX << "\n";
     std::cout << "  min(dt): " << dt_min << "\n";
@@ -294,6 +333,16 @@ void Settings::read(YAML::Node yaml)
                 save_period = 0;
                 }
             }
+        if (outputs["mag_config_format"])
+            {
+            std::string format = outputs["mag_config_format"].as<std::string>();
+            if (format != "binary" && format != "text")
+                error("outputs.mag_config_format should be binary or text.");
+            binarySol = (format == "binary");
+            }
+        assign(solSinglePrecision, outputs["mag_config_single_precision"]);
+        assign(deterministicEnergy, outputs["deterministic_energy"]);
+        assign(fusedEnergy, outputs["fused_energy"]);
         YAML::Node columns = outputs["evol_columns"];
         if (columns)
             {
@@ -311,6 +360,14 @@ void Settings::read(YAML::Node yaml)
         assign(pbName, mesh["filename"]);
         if (assign(_scale, mesh["length_unit"]) && _scale <= 0)
             error("mesh.length_unit should be positive.");
+        assign(meshCache, mesh["cache"]);
+        if (mesh["node_ordering"])
+            {
+            std::string ordering = mesh["node_ordering"].as<std::string>();
+            if (!Ordering::fromName(ordering, nodeOrdering))
+                error("mesh.node_ordering should be longest_axis, rcm, hilbert or morton.");
+            }
+        assign(sortTetrahedrons, mesh["sort_tetrahedrons"]);
         YAML::Node volumes = mesh["volume_regions"];
         if (volumes)
             {
@@ -463,24 +520,104 @@ void Settings::read(YAML::Node yaml)
             }
         }  // spin_transfer_torque
 
-    // The number of available processors (actually, hardware threads) is the default for the number
-    // of threads to spin.
-    int available_cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    YAML::Node threads = yaml["threads"];
+    if (threads)
+        {
+        assign(threadsConfig.total, threads["total"]);
+        if (threadsConfig.total < 0) error("threads.total should be positive or zero.");
+        if (threads["pinning"])
+            {
+            std::string pinning = threads["pinning"].as<std::string>();
+            if (!Threads::fromName(pinning, threadsConfig.pin))
+                error("threads.pinning should be none, compact or spread.");
+            }
+        assign(threadsConfig.firstTouch, threads["first_touch"]);
+        }  // threads
 
     YAML::Node solver = yaml["demagnetizing_field_solver"];
     if (solver)
         {
-        assign(scalfmmNbTh, solver["nb_threads"]);
-        if (scalfmmNbTh <= 0) scalfmmNbTh = available_cpu_count;
+        assign(threadsConfig.demag, solver["nb_threads"]);
+        if (solver["method"])
+            {
+            std::string method = solver["method"].as<std::string>();
+            if (!Demag::fromName(method, demagMethod))
+                error("demagnetizing_field_solver.method should be fmm, direct or hmatrix.");
+            }
+        assign(hmatTolerance, solver["hmatrix_tolerance"]);
+        if (hmatTolerance <= 0 || hmatTolerance >= 1)
+            error("demagnetizing_field_solver.hmatrix_tolerance should be in ]0, 1[.");
+        if (assign(hmatCacheDir, solver["hmatrix_cache"]) && hmatCacheDir.length() > 1
+            && hmatCacheDir.back() == '/')
+            {
+            hmatCacheDir.pop_back();
+            }
+        if (solver["accuracy"])
+            {
+            std::string accuracy = solver["accuracy"].as<std::string>();
+            auto acc = std::find_if(std::begin(fmmAccuracies), std::end(fmmAccuracies),
+                                    [&accuracy](auto const &a) { return a.first == accuracy; });
+            if (acc == std::end(fmmAccuracies))
+                error("demagnetizing_field_solver.accuracy should be low, medium or high.");
+            fmmOrder = acc->second;
+            }
+        assign(fmmTreeHeight, solver["tree_height"]);
+        if (fmmTreeHeight != 0 && (fmmTreeHeight < 3 || fmmTreeHeight > 12))
+            error("demagnetizing_field_solver.tree_height should be 0 or between 3 and 12.");
+        if (solver["precision"])
+            {
+            std::string precision = solver["precision"].as<std::string>();
+            if (!Demag::fromName(precision, fmmPrecision))
+                error("demagnetizing_field_solver.precision should be double, single or mixed.");
+            }
+        YAML::Node incremental = solver["incremental"];
+        if (incremental)
+            {
+            assign(incrementalDemag, incremental["enable"]);
+            assign(incrementalMaxSteps, incremental["max(steps)"]);
+            if (incrementalMaxSteps < 1)
+                error("demagnetizing_field_solver.incremental.max(steps) should be at least 1.");
+            assign(incrementalSkipFarField, incremental["skip_far_field"]);
+            assign(incrementalThreshold, incremental["threshold"]);
+            if (incrementalThreshold < 0)
+                error("demagnetizing_field_solver.incremental.threshold should be positive or zero.");
+            }
+        assign(demagPipeline, solver["pipeline"]);
         }  // demagnetizing_field_solver
 
     solver = yaml["finite_element_solver"];
     if (solver)
         {
-        assign(solverNbTh, solver["nb_threads"]);
-        if (solverNbTh <= 0) solverNbTh = available_cpu_count;
+        assign(threadsConfig.solver, solver["nb_threads"]);
         assign(MAXITER, solver["max(iter)"]);
         assign(TOL,solver["tolerance"]);
+        assign(matrixFree, solver["matrix_free"]);
+        assign(elementBatchSize, solver["element_batch_size"]);
+        if (elementBatchSize != 1 && elementBatchSize != 4 && elementBatchSize != 8)
+            error("finite_element_solver.element_batch_size should be 1, 4 or 8.");
+        if (solver["preconditioner"])
+            {
+            std::string precond = solver["preconditioner"].as<std::string>();
+            if (!Precond::fromName(precond, precondType))
+                error("finite_element_solver.preconditioner should be none, jacobi, block_jacobi,"
+                      " ilu0 or ilut.");
+            }
+        YAML::Node reuse = solver["preconditioner_reuse"];
+        if (reuse)
+            {
+            assign(precondReuseSteps, reuse["max(steps)"]);
+            if (precondReuseSteps < 1)
+                error("finite_element_solver.preconditioner_reuse.max(steps) should be at least 1.");
+            assign(precondReuseDt, reuse["max(dt_change)"]);
+            if (precondReuseDt <= 0)
+                error("finite_element_solver.preconditioner_reuse.max(dt_change) should be positive.");
+            assign(precondRefreshIter, reuse["max(iter)"]);
+            if (precondRefreshIter < 1)
+                error("finite_element_solver.preconditioner_reuse.max(iter) should be at least 1.");
+            }
+        if (matrixFree && !Precond::isMatrixFree(precondType))
+            error("finite_element_solver: matrix_free requires preconditioner none, jacobi or"
+                  " block_jacobi.");
         }  // finite_element_solver
 
     YAML::Node time_integration = yaml["time_integration"];
@@ -491,6 +628,12 @@ void Settings::read(YAML::Node yaml)
         assign(dt_max, time_integration["max(dt)"]);
         }  // time_integration
 
+    // The number of processors available to the process (actually, hardware threads) is the default
+    // for the number of threads to spin.
+    const int nbCpus = Threads::topology::detect().nbCpus();
+    scalfmmNbTh = threadsConfig.nbDemag(nbCpus);
+    solverNbTh = threadsConfig.nbSolver(nbCpus);
+
     // outputs.file_basename defaults to base name of mesh.filename.
     if (simName.empty() && !pbName.empty())
         {
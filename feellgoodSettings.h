@@ -14,10 +14,14 @@ output file format wanted by the user. This is done mainly with the class Settin
 
 #include <yaml-cpp/yaml.h>
 
+#include "demag.h"
 #include "expression_parser.h"
 #include "facette.h"
+#include "ordering.h"
+#include "preconditioner.h"
 #include "spinTransferTorque.h"
 #include "tetra.h"
+#include "threads.h"
 #include "time_integration.h"
 
 /** \class Settings
@@ -91,6 +95,19 @@ public:
     /** magnetic configuration saved every save_period time steps */
     int save_period;
 
+    /** if true, the magnetic configurations are saved as binary snapshots, see snapshot.h,
+     * otherwise as text .sol files */
+    bool binarySol;
+
+    /** if true, the binary snapshots store single precision numbers */
+    bool solSinglePrecision;
+
+    /** if true, energies are summed in a fixed order, independent of the number of threads */
+    bool deterministicEnergy;
+
+    /** if true, energies of the tetrahedrons are computed by the integration of the next step */
+    bool fusedEnergy;
+
     /** to recenter magnetization distribution or not */
     bool recenter;
 
@@ -100,12 +117,57 @@ public:
     /** threshold value to recenter or not versus avg(M_recentering_direction) */
     double threshold;
 
-    /** nb of threads for the finite element solver */
+    /** threading settings, as written by the user */
+    Threads::config threadsConfig;
+
+    /** nb of threads for the finite element solver, from threadsConfig */
     int solverNbTh;
 
-    /** nb of threads for the computation of the demag field with scalfmm */
+    /** nb of threads for the computation of the demag field with scalfmm, from threadsConfig */
     int scalfmmNbTh;
 
+    /** method of computation of the demag field */
+    Demag::method demagMethod;
+
+    /** relative accuracy of the low rank blocks of the hierarchical matrix of the demag field */
+    double hmatTolerance;
+
+    /** directory of the cache of the hierarchical matrices, empty for no cache */
+    std::string hmatCacheDir;
+
+    /** order of the multipole expansions of scalfmm, set by demagnetizing_field_solver.accuracy */
+    int fmmOrder;
+
+    /** height of the octree of scalfmm, 0 means chosen automatically */
+    int fmmTreeHeight;
+
+    /** floating point precision of scalfmm */
+    Demag::fmmPrecision fmmPrecision;
+
+    /** if true the demag field is computed incrementally after a full computation */
+    bool incrementalDemag;
+
+    /** maximum number of incremental demag computations after a full one */
+    int incrementalMaxSteps;
+
+    /** if true the far field of the change of the magnetic charges is neglected in the incremental
+     * demag computations, while the change is small */
+    bool incrementalSkipFarField;
+
+    /** maximum relative change of the magnetic charges whose far field is neglected */
+    double incrementalThreshold;
+
+    /** if true the computations of the potentials of u and v overlap, see scal_fmm::fmm::calc_demag */
+    bool demagPipeline;
+
+    /** if non zero, several configurations of scalfmm are timed and checked instead of the
+     * simulation */
+    int calibrateFmm;
+
+    /** if non zero, the node orderings are compared on a few time steps instead of the
+     * simulation */
+    int compareOrderings;
+
     /** spin transfert torque parameters */
     STT p_stt;
 
@@ -139,6 +201,15 @@ public:
     /** input file name for continuing a calculation (sol.in) */
     std::string restoreFileName;
 
+    /** if true the preprocessed mesh is read from and written to a cache, see Mesh::mesh */
+    bool meshCache;
+
+    /** ordering of the nodes in memory */
+    Ordering::type nodeOrdering;
+
+    /** if true the tetrahedrons are sorted by their first node in the node ordering */
+    bool sortTetrahedrons;
+
     /** maximum value for du step */
     double DUMAX;  // 0.1 for magnetostatic simulations; 0.02 for the dynamics
 
@@ -148,6 +219,24 @@ public:
     /** maximum number of iteration for biconjugate gradient algorithm */
     int MAXITER;
 
+    /** if true the matrix of the finite element problem is not assembled */
+    bool matrixFree;
+
+    /** number of tetrahedrons per batch for the computation of the elementary matrices, 1 means no batches */
+    int elementBatchSize;
+
+    /** preconditioner of bicgstab */
+    Precond::type precondType;
+
+    /** maximum number of time steps a preconditioner is reused for */
+    int precondReuseSteps;
+
+    /** maximum relative change of dt to reuse a preconditioner */
+    double precondReuseDt;
+
+    /** number of iterations of bicgstab above which the preconditioner is refreshed */
+    int precondRefreshIter;
+
     /** this vector contains the material parameters for all regions for all the tetrahedrons */
     std::vector<Tetra::prm> paramTetra;
 
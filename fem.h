@@ -46,6 +46,9 @@ public:
         E_zeeman0 = E_zeeman = 0.0;
         Etot0 = INFINITY;  // avoid "WARNING: energy increased" on first time step
         Etot = 0.0;
+        energyUpToDate = false;
+        if (mySets.fusedEnergy)
+            { tetEnergies.resize(msh.tet.size()); }
 
         recenter_mem = false;
         if (mySets.recenter)
@@ -140,12 +143,24 @@ public:
     /** mesh object to store nodes, fac, tet, and others geometrical values related to the mesh */
     Mesh::mesh msh;
 
-    /** computes all the energies */
+    /** energies of the tetrahedrons, computed by Tet::integrales when settings.fusedEnergy is true */
+    std::vector<Energies> tetEnergies;
+
+    /** false when the magnetization has changed since the last computation of the energies */
+    bool energyUpToDate;
+
+    /** computes all the energies, in parallel. If settings.deterministicEnergy is true the
+     * elements contributions are summed in a fixed order, so that the result does not depend on the
+     * number of threads */
     void energy(double const t /**< [in] time in second, used to compute zeeman contribution if
                                   applied field is time dependant */
                 ,
                 Settings &settings /**< [in] */);
 
+    /** computes all the energies from the energies of the tetrahedrons in tetEnergies, filled by
+     * LinAlgebra::prepareElements. Only the facettes are visited. */
+    void fusedEnergy(Settings &settings /**< [in] */);
+
     /**
     time evolution : one step in time
     */
@@ -159,6 +174,15 @@ public:
         Etot0 = Etot;
         }
 
+    /** writer of the binary magnetization configurations, in the background */
+    mutable Snapshot::writer snapshots;
+
+    /** saves the magnetization configuration to baseName with the extension of the format of the
+     * settings. A binary snapshot is written in the background if async is true. Returns the name
+     * of the file. */
+    std::string saveConfig(Settings const &settings /**< [in] */, std::string const &baseName /**< [in] */,
+                           const double t /**< [in] */, const bool async /**< [in] */) const;
+
     /** saving function for a solution */
     void saver(Settings &settings /**< [in] */, timing const &t_prm /**< [in] */,
                std::ofstream &fout /**< [out] */, const int nt /**< [in] */) const;
@@ -186,15 +210,11 @@ private:
     /** find direction of motion of DW */
     void direction(enum Nodes::index idx_dir /**< [in] */);
 
-    /** zeroing of all energies */
-    inline void zeroEnergy(void)
-        {
-        E_exch = 0.0;
-        E_aniso = 0.0;
-        E_demag = 0.0;
-        E_zeeman = 0.0;
-        Etot = 0.0;
-        }
+    /** returns the energies of the facettes */
+    Energies facettesEnergy(Settings const &settings /**< [in] */) const;
+
+    /** sets the energies, the total energy, and checks that it does not increase */
+    void setEnergies(Energies const &E /**< [in] */, Settings const &settings /**< [in] */);
 
     /** computes the sum of all energies */
     inline void calc_Etot(void) { Etot = E_exch + E_aniso + E_demag + E_zeeman; }
@@ -14,12 +14,24 @@ the fast multipole algorithm, and to compute the demag field.
 #include "Containers/FOctree.hpp"
 #include "Containers/FVector.hpp"
 
+#include "Core/FCoreCommon.hpp"
 #include "Core/FFmmAlgorithmThreadTsm.hpp"
 
 #include "Kernels/P2P/FP2PParticleContainerIndexed.hpp"
 #include "Kernels/Rotation/FRotationCell.hpp"
 #include "Kernels/Rotation/FRotationKernel.hpp"
 
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <memory>
+#include <numeric>
+
+#include <tbb/task_group.h>
+
+#include "chronometer.h"
+#include "demag.h"
+#include "demag_hmatrix.h"
 #include "mesh.h"
 
 /** \namespace scal_fmm
@@ -28,183 +40,649 @@ to grab altogether the templates and functions using scalfmm for the computation
 
 namespace scal_fmm
     {
+const double boxWidth = 2.01; /**< bounding box max dimension, the box is centered on the origin */
+
+const int minHeight = 3;  /**< smallest height of the tree chosen automatically */
+const int maxHeight = 12; /**< largest height of the tree chosen automatically */
+
+/** orders of the multipole expansions available, from the least to the most accurate */
+constexpr int orders[] = {5, 9, 13};
+
+/** average number of particles per leaf aimed at by the automatic choice of the height of the tree
+ * for the expansion order P: the direct interactions of two neighbouring leaves cost the square of
+ * their number of particles, while a multipole to local translation with rotations costs P^3. */
+inline double leafLoad(const int P) { return 1.5 * P * sqrt(P); }
+
+/** number of sub levels of the octree of height nbLevels: the root sub octree is dense, it is kept
+ * below 8^6 cells */
+inline int subLevels(const int nbLevels) { return std::clamp(nbLevels - 2, 1, 6); }
+
+/** returns the number of leaves holding at least one of the points pts, for all the heights of the
+ * tree from 0 to maxHeight. The points are sorted by their Morton index at the deepest level, each
+ * coarser level is a shift of the index. */
+inline std::vector<int> occupiedLeaves(std::vector<Eigen::Vector3d> const &pts)
+    {
+    const int nbCells = 1 << (maxHeight - 1);
+    std::vector<uint64_t> key(pts.size());
+    std::transform(std::execution::par, pts.begin(), pts.end(), key.begin(),
+                   [nbCells](Eigen::Vector3d const &p)
+                       {
+                       uint64_t k = 0;
+                       for (int d = 0; d < Nodes::DIM; d++)
+                           {
+                           int i = (int)floor((p(d) + 0.5 * boxWidth) * nbCells / boxWidth);
+                           i = std::clamp(i, 0, nbCells - 1);
+                           for (int b = 0; b < maxHeight - 1; b++)
+                               { k |= (uint64_t)((i >> b) & 1) << (Nodes::DIM * b + d); }
+                           }
+                       return k;
+                       });
+    std::sort(std::execution::par, key.begin(), key.end());
+
+    std::vector<int> nbLeaves(maxHeight + 1, 1);
+    for (int h = 2; h <= maxHeight; h++)
+        {
+        const int shift = Nodes::DIM * (maxHeight - h);
+        nbLeaves[h] = 0;
+        for (unsigned i = 0; i < key.size(); i++)
+            {
+            if (i == 0 || (key[i] >> shift) != (key[i - 1] >> shift)) nbLeaves[h]++;
+            }
+        }
+    return nbLeaves;
+    }
+
+/** returns the smallest height of the tree, between minHeight and maxHeight, such that the occupied
+ * leaves hold on average no more than leafLoad(P) particles */
+inline int autoHeight(std::vector<int> const &nbLeaves, const int nbParticles, const int P)
+    {
+    int h = minHeight;
+    while (h < maxHeight && nbParticles > leafLoad(P) * nbLeaves[h])
+        { h++; }
+    return h;
+    }
+
+/** \class rotationTree
+octree and rotation kernel of scalfmm, for multipole expansions of order P, computing in FReal
+precision. The algorithm and the maps from the leaves to the sources and targets are built once,
+each computation is a gather of the source densities into the leaves, the fast multipole algorithm
+restricted to the operations given at construction, and a scatter of the potentials.
+*/
+template<typename FReal, int P>
+class rotationTree : public Demag::farField
+    {
+public:
+    /** convenient typedef for the definition of container for scalfmm */
+    typedef FP2PParticleContainerIndexed<FReal> ContainerClass;
+
+    /** convenient typedef for the definition of leaf for scalfmm  */
+    typedef FTypedLeaf<FReal, ContainerClass> LeafClass;
 
-const int P = 9; /**< constant parameter for some scalfmm templates */
+    /** convenient typedef for the definition of cell type in scalfmm  */
+    typedef FTypedRotationCell<FReal, P> CellClass;
 
-typedef double FReal; /**< parameter of scalfmm templates, all computations are made in double precision */
+    /** convenient typedef for the definition of the octree for scalfmm */
+    typedef FOctree<FReal, CellClass, ContainerClass, LeafClass> OctreeClass;
 
-typedef FTypedRotationCell<FReal, P>
-        CellClass; /**< convenient typedef for the definition of cell type in scalfmm  */
+    /** convenient typedef for the kernel for scalfmm */
+    typedef FRotationKernel<FReal, CellClass, ContainerClass, P> KernelClass;
 
-typedef FP2PParticleContainerIndexed<FReal>
-        ContainerClass; /**< convenient typedef for the definition of container for scalfmm */
+    /** convenient typedef for handling altogether the differents scalfmm object templates used in
+     * feellgood */
+    typedef FFmmAlgorithmThreadTsm<OctreeClass, CellClass, ContainerClass, KernelClass, LeafClass>
+            FmmClass;
 
-typedef FTypedLeaf<FReal, ContainerClass>
-        LeafClass; /**< convenient typedef for the definition of leaf for scalfmm  */
+    /** constructor, inserts the targets and the sources in a tree of height nbLevels, and builds
+     * the maps of the leaves. operations is a combination of the FFmmOperations of scalfmm. */
+    rotationTree(std::vector<Eigen::Vector3d> const &targets /**< [in] */,
+                 std::vector<Eigen::Vector3d> const &sources /**< [in] */, const int nbLevels /**< [in] */,
+                 const int _operations = FFmmNearAndFarFields /**< [in] */)
+        : operations(_operations), tree(nbLevels, subLevels(nbLevels), boxWidth, FPoint<FReal>(0., 0., 0.)),
+          kernels(nbLevels, boxWidth, FPoint<FReal>(0., 0., 0.)), algo(&tree, &kernels)
+        {
+        const FSize NOD = targets.size();
+        FSize idxPart = 0;
+        for (Eigen::Vector3d const &p : targets)
+            {
+            tree.insert(FPoint<FReal>(p.x(), p.y(), p.z()), FParticleType::FParticleTypeTarget, idxPart++);
+            }
+        for (Eigen::Vector3d const &p : sources)
+            {
+            tree.insert(FPoint<FReal>(p.x(), p.y(), p.z()), FParticleType::FParticleTypeSource, idxPart++,
+                        FReal(0));
+            }
+
+        srcIdx.reserve(sources.size());
+        tgtIdx.reserve(targets.size());
+        tree.forEachLeaf(
+                [this, NOD](LeafClass *leaf)
+                {
+                    ContainerClass *src = leaf->getSrc();
+                    srcLeaves.push_back({src->getPhysicalValues(), (int)srcIdx.size(), (int)src->getNbParticles()});
+                    for (FSize i = 0; i < src->getNbParticles(); i++)
+                        { srcIdx.push_back(src->getIndexes()[i] - NOD); }
+
+                    ContainerClass *tgt = leaf->getTargets();
+                    tgtLeaves.push_back({tgt->getPotentials(), (int)tgtIdx.size(), (int)tgt->getNbParticles()});
+                    for (FSize i = 0; i < tgt->getNbParticles(); i++)
+                        { tgtIdx.push_back(tgt->getIndexes()[i]); }
+                });
+        tree.forEachCell([this](CellClass *cell) { cells.push_back(cell); });
+        }
 
-typedef FOctree<FReal, CellClass, ContainerClass, LeafClass>
-        OctreeClass; /**< convenient typedef for the definition of the octree for scalfmm */
+    /** runs the fast multipole algorithm */
+    void potential(std::vector<double> const &srcDen, std::vector<double> &pot, Demag::durations &t) override
+        { run(srcDen, pot, t, operations); }
 
-typedef FRotationKernel<FReal, CellClass, ContainerClass, P>
-        KernelClass; /**< convenient typedef for the kernel for scalfmm */
+    /** runs the direct interactions of the neighbouring leaves only */
+    void nearPotential(std::vector<double> const &srcDen, std::vector<double> &pot, Demag::durations &t) override
+        { run(srcDen, pot, t, operations & FFmmNearField); }
 
-typedef FFmmAlgorithmThreadTsm<OctreeClass, CellClass, ContainerClass, KernelClass, LeafClass>
-        FmmClass; /**< convenient typedef for handling altogether the differents scalfmm object
-                     templates used in feellgood  */
+private:
+    /** runs the operations ops of the fast multipole algorithm */
+    void run(std::vector<double> const &srcDen, std::vector<double> &pot, Demag::durations &t, const int ops)
+        {
+        chronometer counter;
+        // physicalValues[idxPart] = Q, reset potentials and cells
+        std::for_each(std::execution::par, srcLeaves.begin(), srcLeaves.end(),
+                      [this, &srcDen](leafMap const &m)
+                          {
+                          for (int i = 0; i < m.nb; i++)
+                              { m.values[i] = srcDen[srcIdx[m.start + i]]; }
+                          });
+        std::for_each(std::execution::par, tgtLeaves.begin(), tgtLeaves.end(),
+                      [](leafMap const &m) { std::fill_n(m.values, m.nb, 0); });
+        std::for_each(std::execution::par, cells.begin(), cells.end(),
+                      [](CellClass *cell) { cell->resetToInitialState(); });
+        t.gather += counter.fp_elapsed();
 
-const int NbLevels = 8;                    /**< number of levels in the tree */
-const int SizeSubLevels = 6;               /**< size of the sub levels  */
-const double boxWidth = 2.01;              /**< bounding box max dimension */
-const FPoint<FReal> boxCenter(0., 0., 0.); /**< center of the bounding box */
+        if (ops != 0) algo.execute(ops);
+        t.execute += counter.fp_elapsed();
+
+        std::for_each(std::execution::par, tgtLeaves.begin(), tgtLeaves.end(),
+                      [this, &pot](leafMap const &m)
+                          {
+                          for (int i = 0; i < m.nb; i++)
+                              { pot[tgtIdx[m.start + i]] = m.values[i]; }
+                          });
+        t.scatter += counter.fp_elapsed();
+        }
+
+    /** \struct leafMap
+    the particles of a leaf, their values are values[0 .. nb-1], their indices are stored from start
+    in srcIdx or tgtIdx */
+    struct leafMap
+        {
+        FReal *values; /**< physical values of the sources or potentials of the targets */
+        int start;     /**< position of the first index */
+        int nb;        /**< number of particles */
+        };
+
+    const int operations; /**< operations of the fast multipole algorithm */
+    OctreeClass tree;     /**< tree initialized by constructor */
+    KernelClass kernels;  /**< kernel initialized by constructor */
+    FmmClass algo;        /**< algorithm initialized by constructor, reused by all computations */
+
+    std::vector<leafMap> srcLeaves; /**< sources of the leaves */
+    std::vector<leafMap> tgtLeaves; /**< targets of the leaves */
+    std::vector<int> srcIdx;        /**< index in srcDen of the sources, leaf after leaf */
+    std::vector<int> tgtIdx;        /**< index of the nodes of the targets, leaf after leaf */
+    std::vector<CellClass *> cells; /**< all the cells of the tree */
+    };
+
+/** \class mixedTree
+fast multipole algorithm of order P with the far field in single precision: the near field is
+computed by a tree in double precision, the far field by a tree in single precision. Only the
+particles of the double precision tree matter, its cells are of the lowest order.
+*/
+template<int P>
+class mixedTree : public Demag::farField
+    {
+public:
+    /** constructor, builds both trees */
+    mixedTree(std::vector<Eigen::Vector3d> const &targets /**< [in] */,
+              std::vector<Eigen::Vector3d> const &sources /**< [in] */, const int nbLevels /**< [in] */)
+        : near(targets, sources, nbLevels, FFmmNearField), far(targets, sources, nbLevels, FFmmFarField),
+          farPot(targets.size())
+        {}
+
+    /** sums the near field and the far field */
+    void potential(std::vector<double> const &srcDen, std::vector<double> &pot, Demag::durations &t) override
+        {
+        near.potential(srcDen, pot, t);
+        far.potential(srcDen, farPot, t);
+        chronometer counter;
+        std::transform(std::execution::par, pot.begin(), pot.end(), farPot.begin(), pot.begin(), std::plus{});
+        t.scatter += counter.fp_elapsed();
+        }
+
+    /** the near field only */
+    void nearPotential(std::vector<double> const &srcDen, std::vector<double> &pot, Demag::durations &t) override
+        { near.potential(srcDen, pot, t); }
+
+private:
+    rotationTree<double, orders[0]> near; /**< near field in double precision */
+    rotationTree<float, P> far;           /**< far field in single precision */
+    std::vector<double> farPot;           /**< potentials of the far field */
+    };
 
 /** \class fmm
 to initialize a tree and a kernel for the computation of the demagnetizing field, and launch the
-computation easily with calc_demag public member
+computation easily with calc_demag public member. The height of the tree and the order of the
+multipole expansions are chosen at construction. The tree may be replaced by the direct summation of
+demag.h or by the hierarchical matrix of demag_hmatrix.h.
 */
 class fmm
     {
 public:
-    /** constructor, initialize memory for tree, kernel, sources corrections, initialize all sources
+    /** constructor, initialize memory for tree, kernel, sources corrections, initialize all sources.
+     * The expansions are of order P, one of orders[]. If nbLevels is zero, the height of the tree is
+     * chosen from the distribution of the particles. P and nbLevels are only used by the fast
+     * multipole method, the tolerance hmatTol and the cache directory hmatCache only by the
+     * hierarchical matrix.
      */
-    inline fmm(Mesh::mesh &msh /**< [in] */, const int ScalfmmNbThreads /**< [in] */)
-        : NOD(msh.getNbNodes()),
-          tree(NbLevels, SizeSubLevels, boxWidth, boxCenter), kernels(NbLevels, boxWidth, boxCenter)
+    inline fmm(Mesh::mesh &msh /**< [in] */, const int ScalfmmNbThreads /**< [in] */,
+               const Demag::method m = Demag::FMM /**< [in] */, const int P = 9 /**< [in] */,
+               const int nbLevels = 0 /**< [in] */,
+               const Demag::fmmPrecision prec = Demag::DOUBLE_PRECISION /**< [in] */,
+               const double hmatTol = 1e-4 /**< [in] */, std::string const &hmatCache = "" /**< [in] */)
+        : NOD(msh.getNbNodes()), method(m), order(P), precision(prec)
         {
         omp_set_num_threads(ScalfmmNbThreads);
         norm = 1. / (2. * msh.diam);
 
-        FSize idxPart = 0;
-        for (idxPart = 0; idxPart < NOD; ++idxPart)
+        std::vector<Eigen::Vector3d> targets(NOD);
+        for (int i = 0; i < NOD; i++)
             {
-            Eigen::Vector3d pTarget = norm*(msh.getNode_p(idxPart) - msh.c);
-            tree.insert(FPoint<FReal>(pTarget.x(), pTarget.y(), pTarget.z()),
-                        FParticleType::FParticleTypeTarget, idxPart);
+            targets[i] = norm * (msh.getNode_p(i) - msh.c);
             }
 
-        insertCharges<Tetra::Tet, Tetra::NPI>(msh.tet, idxPart, msh.c);
-        insertCharges<Facette::Fac, Facette::NPI>(msh.fac, idxPart, msh.c);
+        std::vector<Eigen::Vector3d> sources;
+        sources.reserve(msh.getNbFacs() * Facette::NPI + msh.getNbTets() * Tetra::NPI);
+        insertCharges<Tetra::Tet, Tetra::NPI>(msh.tet, sources, msh.c);
+        insertCharges<Facette::Fac, Facette::NPI>(msh.fac, sources, msh.c);
 
-        srcDen.resize( msh.getNbFacs()*Facette::NPI + msh.getNbTets()*Tetra::NPI );
-        corr.resize(NOD);
+        if (method == Demag::DIRECT)
+            {
+            height = 0;
+            particlesPerLeaf = 0;
+            solver = std::make_unique<Demag::directSum>(targets, sources);
+            }
+        else if (method == Demag::HMATRIX)
+            {
+            height = 0;
+            particlesPerLeaf = 0;
+            auto hmat = std::make_unique<Demag::hMatrix>(targets, sources, hmatTol, hmatCache);
+            compression = hmat->compression();
+            hmatFromCache = hmat->isFromCache();
+            solver = std::move(hmat);
+            }
+        else
+            {
+            std::vector<Eigen::Vector3d> all(targets);
+            all.insert(all.end(), sources.begin(), sources.end());
+            const std::vector<int> nbLeaves = occupiedLeaves(all);
+            height = (nbLevels > 0) ? nbLevels : autoHeight(nbLeaves, all.size(), order);
+            particlesPerLeaf = (double)all.size() / nbLeaves[height];
+            solver = makeTree(targets, sources);
+            }
+
+        for (field &f : fields)
+            {
+            f.srcDen.resize(sources.size());
+            f.corr.resize(NOD);
+            f.pot.resize(NOD);
+            f.facCorr.resize(msh.getNbFacs());
+            }
+        buildNodeToFacettes(msh.fac);
+        }
+
+    /** constructor, with the method and its parameters taken from the settings */
+    inline fmm(Mesh::mesh &msh /**< [in] */, Settings const &s /**< [in] */)
+        : fmm(msh, s.scalfmmNbTh, s.demagMethod, s.fmmOrder, s.fmmTreeHeight, s.fmmPrecision, s.hmatTolerance,
+              s.hmatCacheDir)
+        {
+        if (s.incrementalDemag)
+            setIncremental(s.incrementalMaxSteps, s.incrementalSkipFarField, s.incrementalThreshold);
+        setPipeline(s.demagPipeline);
         }
 
     /**
-    launch the calculation of the demag field with second order corrections
+    launch the calculation of the demag field with second order corrections. If withPhi is not
+    empty, it is called once phi is computed, it must not modify v nor phi_v. In pipeline mode the
+    charges of v are computed during the computation of the potential of u, and withPhi and the
+    normalization of phi are done during the computation of the potential of v.
     */
-    void calc_demag(Mesh::mesh &msh /**< [in] */)
+    void calc_demag(Mesh::mesh &msh /**< [in] */, std::function<void()> const &withPhi = nullptr /**< [in] */)
+        {
+        field &fu = fields[0];
+        field &fv = fields[1];
+        fu.times = Demag::durations();
+        fv.times = Demag::durations();
+        if (pipeline)
+            {
+            tbb::task_group tasks;
+            calc_charges<Nodes::VEC_U>(msh, fu);
+            tasks.run([this, &msh, &fv]() { calc_charges<Nodes::VEC_V>(msh, fv); });
+            solve(fu);
+            tasks.wait();
+            tasks.run([this, &msh, &fu, &withPhi]()
+                          {
+                          scatter<Nodes::SCAL_PHI>(msh, fu);
+                          if (withPhi) withPhi();
+                          });
+            solve(fv);
+            tasks.wait();
+            scatter<Nodes::SCAL_PHIV>(msh, fv);
+            }
+        else
+            {
+            calc_charges<Nodes::VEC_U>(msh, fu);
+            solve(fu);
+            scatter<Nodes::SCAL_PHI>(msh, fu);
+            if (withPhi) withPhi();
+            calc_charges<Nodes::VEC_V>(msh, fv);
+            solve(fv);
+            scatter<Nodes::SCAL_PHIV>(msh, fv);
+            }
+        times = fu.times;
+        times += fv.times;
+        nbIncremental = int(fu.incremental) + int(fv.incremental);
+        }
+
+    /** computes the scalar potential phi of the vector field U at all the nodes */
+    template<Nodes::vectorField U>
+    void potential(Mesh::mesh &msh /**< [in] */, std::vector<double> &phi /**< [out] */)
+        {
+        field &f = fields[0];
+        f.times = Demag::durations();
+        calc_charges<U>(msh, f);
+        solver->potential(f.srcDen, f.pot, f.times);
+        times = f.times;
+        phi.resize(NOD);
+        std::transform(std::execution::par, f.pot.begin(), f.pot.end(), f.corr.begin(), phi.begin(),
+                       [this](const double p, const double c) { return (p * norm + c) / (4 * M_PI); });
+        }
+
+    /** enables the incremental computation: for at most maxSteps computations after a full one,
+     * the potential is the one of the full computation plus the potential of the change of the
+     * source densities, see Demag::incremental. If skipFarField is true, only the near field of the
+     * change is computed while its relative norm is at most threshold. maxSteps = 0 disables it. */
+    void setIncremental(const int maxSteps /**< [in] */, const bool skipFarField = false /**< [in] */,
+                        const double threshold = 0 /**< [in] */)
         {
-        demag(Nodes::get_u, Nodes::set_phi, msh);
-        demag(Nodes::get_v, Nodes::set_phiv, msh);
+        for (field &f : fields)
+            { f.inc.configure(maxSteps, skipFarField, threshold); }
         }
 
-    /** sources */
-    std::vector<double> srcDen;
-    
-    /** corrections associated to the nodes, contributions only due to the facettes */
-    std::vector<double> corr;
+    /** enables the computation of the potential of u concurrently with the charges of v, and of the
+     * potential of v concurrently with the end of the computation of phi, see calc_demag */
+    void setPipeline(const bool enable /**< [in] */) { pipeline = enable; }
+
+    /** number of incremental computations in the last call to calc_demag, out of two */
+    inline int getNbIncremental(void) const { return nbIncremental; }
+
+    /** durations of the steps of the last call to calc_demag, summed over u and v, the steps
+     * done concurrently in pipeline mode are counted twice */
+    inline Demag::durations const &getDurations(void) const { return times; }
+
+    /** method of computation of the potentials */
+    inline Demag::method getMethod(void) const { return method; }
+
+    /** height of the tree */
+    inline int getHeight(void) const { return height; }
+
+    /** order of the multipole expansions */
+    inline int getOrder(void) const { return order; }
+
+    /** average number of particles in the occupied leaves */
+    inline double getParticlesPerLeaf(void) const { return particlesPerLeaf; }
+
+    /** one line description of the method and of its parameters */
+    std::string description(void) const
+        {
+        std::ostringstream ss;
+        if (method == Demag::DIRECT)
+            { ss << "direct summation"; }
+        else if (method == Demag::HMATRIX)
+            {
+            ss << "hierarchical matrix " << (hmatFromCache ? "read from cache" : "assembled") << ", "
+               << 100 * compression << "% of the dense matrix";
+            }
+        else
+            {
+            ss << "tree height " << height << ", order " << order << ", " << particlesPerLeaf
+               << " particles per leaf, " << Demag::name(precision) << " precision";
+            }
+        return ss.str();
+        }
 
 private:
     const int NOD; /**< number of nodes */
 
-    OctreeClass tree;    /**< tree initialized by constructor */
-    KernelClass kernels; /**< kernel initialized by constructor */
+    const Demag::method method; /**< method of computation of the potentials */
+
+    const int order; /**< order of the multipole expansions */
+
+    const Demag::fmmPrecision precision; /**< floating point precision of the fast multipole method */
+
+    int height; /**< height of the tree */
+
+    double particlesPerLeaf; /**< average number of particles in the occupied leaves */
+
+    double compression = 0; /**< size of the hierarchical matrix relative to the dense matrix */
+
+    bool hmatFromCache = false; /**< true if the hierarchical matrix was read from the cache */
+
+    std::unique_ptr<Demag::farField> solver; /**< tree and kernel, or direct summation, initialized by constructor */
 
     double norm; /**< normalization coefficient */
 
+    Demag::durations times; /**< durations of the steps of the computations since the last calc_demag */
+
+    /** \struct field
+    buffers of the computation of the potential of u or v, separate so that the steps of both
+    computations may overlap */
+    struct field
+        {
+        std::vector<double> srcDen;  /**< source densities */
+        std::vector<double> corr;    /**< corrections associated to the nodes, due to the facettes only */
+        std::vector<double> pot;     /**< potentials of the nodes, before normalization and corrections */
+
+        /** corrections of each facette to the potential of its nodes, reduced on the nodes into corr */
+        std::vector<Eigen::Matrix<double, Facette::N, 1>> facCorr;
+
+        Demag::incremental inc;   /**< last full computation, for the incremental computations */
+        bool incremental = false; /**< true if the last computation was incremental */
+        Demag::durations times;  /**< durations of the steps of the last computation */
+        };
+
+    field fields[2]; /**< buffers of the computations of the potentials of u and v */
+
+    bool pipeline = false; /**< if true the computations of the potentials of u and v overlap */
+
+    int nbIncremental = 0; /**< number of incremental computations in the last calc_demag */
+
+    /** facettes of node i are referenced by facOfNode[facOfNodeStart[i] .. facOfNodeStart[i+1]-1],
+     * each entry is the index of the facette times Facette::N plus the local index of the node */
+    std::vector<int> facOfNodeStart;
+
+    /** see facOfNodeStart */
+    std::vector<int> facOfNode;
+
+    /** returns the octree and the rotation kernel for the expansions of order P, in the precision
+     * of the settings */
+    template<int P>
+    std::unique_ptr<Demag::farField> makeTree(std::vector<Eigen::Vector3d> const &targets,
+                                              std::vector<Eigen::Vector3d> const &sources) const
+        {
+        switch (precision)
+            {
+            case Demag::SINGLE_PRECISION: return std::make_unique<rotationTree<float, P>>(targets, sources, height);
+            case Demag::MIXED_PRECISION: return std::make_unique<mixedTree<P>>(targets, sources, height);
+            default: return std::make_unique<rotationTree<double, P>>(targets, sources, height);
+            }
+        }
+
+    /** returns the octree and the rotation kernel for the expansions of order P */
+    std::unique_ptr<Demag::farField> makeTree(std::vector<Eigen::Vector3d> const &targets,
+                                              std::vector<Eigen::Vector3d> const &sources) const
+        {
+        switch (order)
+            {
+            case orders[0]: return makeTree<orders[0]>(targets, sources);
+            case orders[1]: return makeTree<orders[1]>(targets, sources);
+            case orders[2]: return makeTree<orders[2]>(targets, sources);
+            }
+        std::cerr << "fmm: no multipole expansion of order " << order << std::endl;
+        exit(1);
+        }
+
+    /** builds the list of facettes of each node (compressed storage), to reduce facCorr into corr
+     * without race condition */
+    void buildNodeToFacettes(std::vector<Facette::Fac> const &fac)
+        {
+        facOfNodeStart.assign(NOD + 1, 0);
+        for (Facette::Fac const &f : fac)
+            for (int i = 0; i < Facette::N; i++)
+                { facOfNodeStart[f.ind[i] + 1]++; }
+        std::partial_sum(facOfNodeStart.begin(), facOfNodeStart.end(), facOfNodeStart.begin());
+
+        facOfNode.resize(facOfNodeStart[NOD]);
+        std::vector<int> pos(facOfNodeStart.begin(), facOfNodeStart.end() - 1);
+        for (int k = 0; k < (int)fac.size(); k++)
+            for (int i = 0; i < Facette::N; i++)
+                { facOfNode[pos[fac[k].ind[i]]++] = k * Facette::N + i; }
+        }
+
     /**
-    function template to insert volume or surface charges in tree for demag computation. class T is
-    Tet or Fac, it must have getPtGauss() method, second template parameter is NPI of the namespace
-    containing class T
+    function template to append the normalized positions of the volume or surface charges to
+    sources. class T is Tet or Fac, it must have getPtGauss() method, second template parameter is
+    NPI of the namespace containing class T
     */
     template<class T, const int NPI>
-    void insertCharges(std::vector<T> const &container, FSize &idx, Eigen::Ref<Eigen::Vector3d> const c)
+    void insertCharges(std::vector<T> const &container, std::vector<Eigen::Vector3d> &sources,
+                       Eigen::Ref<Eigen::Vector3d> const c)
         {
         std::for_each(container.begin(), container.end(),
-                      [this, c, &idx](T const &elem)
+                      [this, c, &sources](T const &elem)
                       {
                           Eigen::Matrix<double,Nodes::DIM,NPI> gauss;
                           elem.getPtGauss(gauss);
 
-                          for (int j = 0; j < NPI; j++, idx++)
-                              {
-                              double x = norm*(gauss(0,j) - c.x());
-                              double y = norm*(gauss(1,j) - c.y());
-                              double z = norm*(gauss(2,j) - c.z());
-                              tree.insert(FPoint<FReal>(x,y,z), FParticleType::FParticleTypeSource, idx, 0.0);
-                              }
+                          for (int j = 0; j < NPI; j++)
+                              { sources.push_back(norm*(gauss.col(j) - c)); }
                       });  // end for_each
         }
 
-    /** computes all charges from tetraedrons and facettes for the demag field to feed a tree in the fast multipole algo (scalfmm)
+    /** computes all charges from tetraedrons and facettes for the demag field to feed a tree in the fast multipole algo (scalfmm).
+    The sources of the element k are stored at a fixed offset in f.srcDen, so the elements are processed in parallel. The
+    corrections of the facettes are reduced node by node, in a fixed order.
      */
-    void calc_charges(std::function<const Eigen::Vector3d(Nodes::Node)> getter, Mesh::mesh &msh)
+    template<Nodes::vectorField U>
+    void calc_charges(Mesh::mesh &msh, field &f)
         {
-        int nsrc(0);
-        std::for_each(msh.tet.begin(), msh.tet.end(),
-                      [this, getter, &nsrc](Tetra::Tet const &tet)
+        chronometer counter;
+        Tetra::Tet const *const firstTet = msh.tet.data();
+        std::for_each(std::execution::par, msh.tet.begin(), msh.tet.end(),
+                      [&f, firstTet](Tetra::Tet const &tet)
+                          {
+                          const int k = &tet - firstTet;
+                          Eigen::Map<Eigen::Matrix<double,Tetra::NPI,1>>(f.srcDen.data() + k*Tetra::NPI) = tet.charges<U>();
+                          });
+
+        const int facOffset = msh.getNbTets()*Tetra::NPI;
+        Facette::Fac const *const firstFac = msh.fac.data();
+        std::for_each(std::execution::par, msh.fac.begin(), msh.fac.end(),
+                      [&f, firstFac, facOffset](Facette::Fac const &fac)
                           {
-                          Eigen::Matrix<double,Tetra::NPI,1> result = tet.charges(getter); 
-                          for(int i=0;i<Tetra::NPI;i++) { srcDen[nsrc+i] = result(i); }
-                          nsrc += Tetra::NPI;
+                          const int k = &fac - firstFac;
+                          Eigen::Map<Eigen::Matrix<double,Facette::NPI,1>>(f.srcDen.data() + facOffset + k*Facette::NPI)
+                                  = fac.charges<U>(f.facCorr[k]);
                           });
 
-        std::for_each(msh.fac.begin(), msh.fac.end(),
-                      [this, getter, &nsrc](Facette::Fac const &fac)
+        std::for_each(std::execution::par, f.corr.begin(), f.corr.end(),
+                      [this, &f](double &c)
                           {
-                          Eigen::Matrix<double,Facette::NPI,1> result =  fac.charges(getter, corr);
-                          for(int i=0;i<Facette::NPI;i++) { srcDen[nsrc+i] = result(i); }
-                          nsrc += Facette::NPI;
+                          const int i = &c - f.corr.data();
+                          c = 0;
+                          for (int j = facOfNodeStart[i]; j < facOfNodeStart[i + 1]; j++)
+                              { c += f.facCorr[facOfNode[j] / Facette::N](facOfNode[j] % Facette::N); }
                           });
+        f.times.charges += counter.fp_elapsed();
         }
 
     /**
-    computes the demag field, with (getter  = u,setter = phi) or (getter = v,setter = phi_v)
+    computes the potentials f.pot from the source densities f.srcDen, incrementally if enabled
     */
-    void demag(std::function<const Eigen::Vector3d(Nodes::Node)> getter,
-               std::function<void(Nodes::Node &, const double)> setter, Mesh::mesh &msh)
+    void solve(field &f)
         {
-        FmmClass algo(&tree, &kernels);
-
-        std::fill(srcDen.begin(),srcDen.end(),0);
-        std::fill(corr.begin(),corr.end(),0);
-        calc_charges(getter, msh);
-
-        // reset potentials and forces - physicalValues[idxPart] = Q
-        tree.forEachLeaf(
-                [this](LeafClass *leaf)
-                {
-                    const int nbParticlesInLeaf = leaf->getSrc()->getNbParticles();
-                    const FVector<long long> &indexes = leaf->getSrc()->getIndexes();
-                    FReal *const physicalValues = leaf->getSrc()->getPhysicalValues();
-                    for (int idxPart = 0; idxPart < nbParticlesInLeaf; ++idxPart)
-                        {
-                        physicalValues[idxPart] = srcDen[indexes[idxPart] - NOD];
-                        }
-
-                    std::fill_n(leaf->getTargets()->getPotentials(),
-                                leaf->getTargets()->getNbParticles(), 0);
-                });
+        f.incremental = (f.inc.solve(*solver, f.srcDen, f.pot, f.times) != Demag::incremental::FULL);
+        }
 
-        tree.forEachCell([](CellClass *cell) { cell->resetToInitialState(); });
+    /**
+    stores the normalized and corrected potentials of f in the nodes, with PHI = phi or phi_v
+    */
+    template<Nodes::scalarField PHI>
+    void scatter(Mesh::mesh &msh, field &f)
+        {
+        chronometer counter;
+        std::for_each(std::execution::par, f.pot.begin(), f.pot.end(),
+                      [this, &msh, &f](const double &p)
+                          {
+                          const int i = &p - f.pot.data();
+                          msh.set<PHI>(i, (p * norm + f.corr[i]) / (4 * M_PI));
+                          });
+        f.times.scatter += counter.fp_elapsed();
+        }
+    };  // end class fmm
 
-        algo.execute();
+/** times the computation of the potential of u and compares it to the direct summation, for all the
+ * orders and the heights of the tree around the automatic choice, in double precision, and in single
+ * and mixed precision at the automatic height. The results are printed as a table. */
+inline void calibrate(Mesh::mesh &msh /**< [in] */, const int ScalfmmNbThreads /**< [in] */)
+    {
+    std::vector<double> phiRef;
+    chronometer counter(2);
+        {
+        fmm ref(msh, ScalfmmNbThreads, Demag::DIRECT);
+        ref.potential<Nodes::VEC_U>(msh, phiRef);
+        }
+    std::cout << "direct summation: " << counter.millis() << std::endl;
+    const double normRef = Eigen::Map<const Eigen::VectorXd>(phiRef.data(), phiRef.size()).norm();
 
-        tree.forEachLeaf(
-                [this, &msh, setter](LeafClass *leaf)
-                {
-                    const FReal *const potentials = leaf->getTargets()->getPotentials();
-                    const int nbParticlesInLeaf = leaf->getTargets()->getNbParticles();
-                    const FVector<long long> &indexes = leaf->getTargets()->getIndexes();
-
-                    for (int idxPart = 0; idxPart < nbParticlesInLeaf; ++idxPart)
-                        {
-                        const int indexPartOrig = indexes[idxPart];
-                        msh.set(indexPartOrig, setter,
-                                (potentials[idxPart] * norm + corr[indexPartOrig]) / (4 * M_PI));
-                        }
-                });
+    auto run = [&msh, ScalfmmNbThreads, &phiRef, normRef](const int P, const int h, const bool automatic,
+                                                           const Demag::fmmPrecision prec)
+        {
+        std::vector<double> phi;
+        chronometer counter;
+        fmm myFMM(msh, ScalfmmNbThreads, Demag::FMM, P, h, prec);
+        const double tSetup = counter.fp_elapsed();
+        myFMM.potential<Nodes::VEC_U>(msh, phi);
+        const double tFmm = counter.fp_elapsed();
+        const double err = (Eigen::Map<const Eigen::VectorXd>(phi.data(), phi.size())
+                            - Eigen::Map<const Eigen::VectorXd>(phiRef.data(), phiRef.size()))
+                                   .norm();
+        std::cout << P << '\t' << h << (automatic ? "*" : "") << '\t' << Demag::name(prec) << '\t'
+                  << myFMM.getParticlesPerLeaf() << '\t' << 1e3 * tSetup << '\t' << 1e3 * tFmm << '\t'
+                  << err / normRef << std::endl;
+        };
+
+    std::cout << "order\theight\tprecision\tparticles/leaf\tsetup (ms)\tfmm (ms)\trelative error\n";
+    for (const int P : orders)
+        {
+        int h0 = 0;
+            {
+            fmm myFMM(msh, ScalfmmNbThreads, Demag::FMM, P);
+            h0 = myFMM.getHeight();
+            }
+        for (int h = std::max(minHeight, h0 - 1); h <= std::min(maxHeight, h0 + 1); h++)
+            { run(P, h, h == h0, Demag::DOUBLE_PRECISION); }
+        run(P, h0, true, Demag::SINGLE_PRECISION);
+        run(P, h0, true, Demag::MIXED_PRECISION);
         }
-    };  // end class fmm
+    std::cout << "(*: height chosen automatically)\n";
+    }
 
     }  // namespace scal_fmm
 #endif
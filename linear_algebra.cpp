@@ -11,12 +11,24 @@ void LinAlgebra::base_projection()
     }
 
 void LinAlgebra::prepareElements(Eigen::Vector3d const &Hext /**< [in] applied field */,
-                                 timing const &t_prm /**< [in] */)
+                                 timing const &t_prm /**< [in] */,
+                                 Energies *tetE /**< [out] */)
     {
     base_projection();
-    std::for_each(std::execution::par, refMsh->tet.begin(), refMsh->tet.end(),
-                  [this, &Hext, &t_prm](Tetra::Tet &tet)
-                  { tet.integrales(prmTetra[tet.idxPrm], t_prm, Hext, idx_dir, DW_vz); });
+    if (batchSize == 4)
+        { integrales(batches4, Hext, t_prm, tetE); }
+    else if (batchSize == 8)
+        { integrales(batches8, Hext, t_prm, tetE); }
+    else
+        {
+        std::for_each(std::execution::par, refMsh->tet.begin(), refMsh->tet.end(),
+                      [this, &Hext, &t_prm, tetE](Tetra::Tet &tet)
+                      {
+                      Energies *E = (tetE == nullptr) ? nullptr : tetE + (&tet - refMsh->tet.data());
+                      tet.integrales(prmTetra[tet.idxPrm], t_prm, Hext, idx_dir, DW_vz, E,
+                                     withSTT ? &stt : nullptr);
+                      });
+        }
 
     std::for_each(std::execution::par, refMsh->fac.begin(), refMsh->fac.end(),
                   [this](Facette::Fac &fac)
@@ -5,6 +5,7 @@
 \brief secondary header, it grabs altogether the linear algebra by the solver to apply fem method
 <br> It encapsulates the calls to eigen BiCGSTAB solver, the assemblage and projection of the matrix for all elements
 <br> projection and matrix assembly is multithreaded for tetrahedron, monothread for facette
+<br> the sparsity pattern of the matrix is computed once by the constructor, see matrix_assembly.h
 */
 #include <random>
 #include <execution>
@@ -13,14 +14,20 @@
 
 #include "facette.h"
 #include "feellgoodSettings.h"
+#include "matrix_assembly.h"
+#include "matrix_free.h"
 #include "mesh.h"
 #include "node.h"
+#include "preconditioner.h"
 #include "tetra.h"
+#include "tetra_batch.h"
 
 /** \class LinAlgebra
 convenient class to grab altogether some part of the calculations involved using eigen BiCGSTAB solver at each
-timestep. The solver is handled by solver method, and is using Eigen::SparseMatrix, Row major matrix. This matrix
-is prepared in 'batch mode', using a vector of triplets (also called COO write sparse matrix).
+timestep. The solver is handled by solver method, and is using Eigen::SparseMatrix, Row major matrix. The sparsity
+pattern of this matrix is fixed by the mesh, it is built once, then the coefficients are scattered in place at each
+timestep by a MatrixAssembler. In matrix free mode, the matrix is never built, bicgstab applies the inner matrices of
+the tetrahedrons through a MatrixFreeOperator.
 */
 class LinAlgebra
     {
@@ -28,34 +35,78 @@ public:
     /** constructor */
     inline LinAlgebra(Settings &s /**< [in] */, Mesh::mesh &my_msh /**< [in] */)
         : NOD(my_msh.getNbNodes()), MAXITER(s.MAXITER), TOL(s.TOL), verbose(s.verbose),
-          prmTetra(s.paramTetra), prmFacette(s.paramFacette), refMsh(&my_msh)
+          precondReuseSteps(s.precondReuseSteps), precondReuseDt(s.precondReuseDt),
+          precondRefreshIter(s.precondRefreshIter), matrixFree(s.matrixFree),
+          batchSize(s.elementBatchSize),
+          prmTetra(s.paramTetra), prmFacette(s.paramFacette), refMsh(&my_msh),
+          assembler(NOD, my_msh.tet), mfOp(NOD, my_msh.tet, assembler.getColors())
         {
         Eigen::setNbThreads(s.solverNbTh);
         base_projection();
-        K.resize(2*NOD,2*NOD);
-        K.reserve(2*NOD); // initial mem alloc to the size of the diagonal
         X_guess.resize(2*NOD);
         L_TH.resize(2*NOD);
-        _solver.setTolerance(s.TOL);
-        _solver.setMaxIterations(s.MAXITER);
+        if (batchSize == 4)
+            { batches4 = Tetra::makeBatches<4>(my_msh.tet); }
+        else if (batchSize == 8)
+            { batches8 = Tetra::makeBatches<8>(my_msh.tet); }
+        if (matrixFree)
+            {
+            if (verbose)
+                {
+                std::cout << "matrix free operator: " << assembler.getNbColors()
+                          << " colors of tetrahedrons\n";
+                }
+            _mfSolver.setTolerance(s.TOL);
+            _mfSolver.setMaxIterations(s.MAXITER);
+            _mfSolver.preconditioner().select(s.precondType);
+            _mfSolver.analyzePattern(mfOp);
+            }
+        else
+            {
+            assembler.buildPattern(my_msh.tet, K);
+            if (verbose)
+                {
+                std::cout << "sparse matrix pattern: " << assembler.getNbNonZeros()
+                          << " non zero coefficients, " << assembler.getNbColors()
+                          << " colors of tetrahedrons\n";
+                }
+            _solver.setTolerance(s.TOL);
+            _solver.setMaxIterations(s.MAXITER);
+            _solver.preconditioner().select(s.precondType);
+            _solver.analyzePattern(K);// pattern of K is fixed, numerical values in K are not used
+            }
         if (!s.recenter)
             { idx_dir = Nodes::IDX_UNDEF; }
         else
             { idx_dir = s.recentering_direction; }
         }
 
-    /** computes inner data structures of tetraedrons and triangular facettes (K matrices and L vectors) */
-    void prepareElements(Eigen::Vector3d const &Hext /**< [in] applied field */, timing const &t_prm /**< [in] */);
+    /** computes inner data structures of tetraedrons and triangular facettes (K matrices and L vectors). If tetE is
+     * not null, the energies of the tetrahedrons for the magnetization of the previous time step are computed on the
+     * fly in tetE, which should hold as many elements as msh.tet */
+    void prepareElements(Eigen::Vector3d const &Hext /**< [in] applied field */, timing const &t_prm /**< [in] */,
+                         Energies *tetE = nullptr /**< [out] */);
 
     /**  solver, uses bicgstab, sparse matrix and vector are filled with multiThreading */
     int solver(timing const &t_prm /**< [in] */);
 
+    /** setter for the spin transfer torque contributions, computed by electrostatSolver */
+    inline void set_stt(Tetra::sttTerms const &s /**< [in] */) { stt = s; withSTT = true; }
+
     /** setter for DW_dz */
     inline void set_DW_vz(double vz /**< [in] */) { DW_vz = vz; }
 
     /** getter for v_max */
     inline double get_v_max(void) { return v_max; }
 
+    /** number of non zero coefficients of the matrix, zero in matrix free mode */
+    inline long getNbNonZeros(void) const { return assembler.getNbNonZeros(); }
+
+    /** number of non zero coefficients of the factors of the preconditioner, zero if it is not a
+     * factorization */
+    inline long getPrecondNonZeros(void) const
+        { return matrixFree ? 0 : _solver.preconditioner().nonZeros(); }
+
 private:
     /** recentering index direction if any */
     Nodes::index idx_dir;
@@ -72,6 +123,30 @@ private:
     /** verbosity */
     const int verbose;
 
+    /** maximum number of time steps a preconditioner is reused for */
+    const int precondReuseSteps;
+
+    /** maximum relative change of dt to reuse a preconditioner */
+    const double precondReuseDt;
+
+    /** number of iterations of the previous solve above which the preconditioner is refreshed */
+    const int precondRefreshIter;
+
+    /** if true K is not assembled, bicgstab uses the matrix free operator mfOp */
+    const bool matrixFree;
+
+    /** number of tetrahedrons per batch in prepareElements, 1 if the tetrahedrons are processed one by one */
+    const int batchSize;
+
+    /** number of solves done with the current preconditioner, -1 if there is none */
+    int precondAge = -1;
+
+    /** time step of the current preconditioner */
+    double precondDt;
+
+    /** number of iterations of the previous solve */
+    int lastNbIter = 0;
+
     /** material parameters of the tetrahedrons */
     const std::vector<Tetra::prm> &prmTetra;
 
@@ -81,6 +156,24 @@ private:
     /** direct access to the mesh */
     Mesh::mesh *refMsh;
 
+    /** sparsity pattern and parallel scatter of the tetrahedrons contributions to K and L_TH */
+    MatrixAssembler assembler;
+
+    /** batches of tetrahedrons, used if batchSize is 4 */
+    std::vector<Tetra::batch<4>> batches4;
+
+    /** batches of tetrahedrons, used if batchSize is 8 */
+    std::vector<Tetra::batch<8>> batches8;
+
+    /** matrix free operator, equivalent to K */
+    MatrixFreeOperator mfOp;
+
+    /** spin transfer torque contributions to the integrales of the tetrahedrons */
+    Tetra::sttTerms stt;
+
+    /** true if the spin transfer torque contributions have been set */
+    bool withSTT = false;
+
     /** speed of the domain wall */
     double DW_vz;
 
@@ -96,10 +189,39 @@ private:
     /** RHS vector of the system to solve */
     Eigen::VectorXd L_TH;
 
-    /** eigen stabilized biconjugate gradient solver, for row major sparse matrix and ILU preconditionner. Row major sparse matrix allows some parallelism with openMP multithreading */
-    Eigen::BiCGSTAB<Eigen::SparseMatrix<double,Eigen::RowMajor>,Eigen::IncompleteLUT<double>> _solver;
+    /** eigen stabilized biconjugate gradient solver, for row major sparse matrix and preconditioner selected in the settings. Row major sparse matrix allows some parallelism with openMP multithreading */
+    Eigen::BiCGSTAB<Eigen::SparseMatrix<double,Eigen::RowMajor>,Precond::wrapper> _solver;
+
+    /** eigen stabilized biconjugate gradient solver for the matrix free operator */
+    Eigen::BiCGSTAB<MatrixFreeOperator,Precond::wrapper> _mfSolver;
 
     /** computes local vector basis {ep,eq} in the tangeant plane for projection on the elements */
     void base_projection();
+
+    /** computes Kp, Lp (and energies if tetE is not null) of the tetrahedrons by batches, in parallel */
+    template<int L>
+    void integrales(std::vector<Tetra::batch<L>> const &batches /**< [in] */, Eigen::Vector3d const &Hext /**< [in] */,
+                    timing const &t_prm /**< [in] */, Energies *tetE /**< [out] */)
+        {
+        std::for_each(std::execution::par, batches.begin(), batches.end(),
+                      [this, &Hext, &t_prm, tetE](Tetra::batch<L> const &b)
+                      {
+                      Tetra::integrales<L>(b, refMsh->tet, prmTetra[b.idxPrm], t_prm, Hext, idx_dir, DW_vz, tetE,
+                                           withSTT ? &stt : nullptr);
+                      });
+        }
+
+    /** returns true if the preconditioner has to be computed again for time step dt */
+    bool precondIsStale(const double dt /**< [in] */) const;
+
+    /** numerical setup of the preconditioner of solver s for operator A, the pattern analysis is done once by the
+     * constructor */
+    template<class Solver, class Operator>
+    void factorize(Solver &s /**< [in|out] */, Operator const &A /**< [in] */, const double dt /**< [in] */);
+
+    /** solves A sol = L_TH with bicgstab solver s, initial guess X_guess, returns zero if converged */
+    template<class Solver, class Operator>
+    int solve(Solver &s /**< [in|out] */, Operator const &A /**< [in] */, const double dt /**< [in] */,
+              Eigen::VectorXd &sol /**< [out] */);
     };// end class linAlgebra
 #endif
@@ -1,4 +1,6 @@
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <signal.h>
 #include <stdio.h>      // for perror()
 #include <sys/stat.h>   // for mkdir(), stat()
@@ -79,6 +81,56 @@ static std::string pad(const std::string &s, int length)
     return s + std::string(length, ' ');
     }
 
+// Time a few steps of the finite element solver with each node ordering, and print the bandwidth
+// and the envelope of the graph of the nodes, the size of the matrix and of the factors of the
+// preconditioner, and the time per step. The demag field is not computed.
+static void compareOrderings(Settings &settings, timing const &t_prm)
+    {
+    const int nbSteps = 5;
+    const Ordering::type initial = settings.nodeOrdering;
+    const bool initialCache = settings.meshCache;
+    settings.meshCache = false;
+    std::vector<std::string> rows;
+    for (Ordering::type t : {Ordering::LONGEST_AXIS, Ordering::RCM, Ordering::HILBERT, Ordering::MORTON})
+        {
+        settings.nodeOrdering = t;
+        timing t_cmp(t_prm);
+        Fem fem(settings, t_cmp);
+        LinAlgebra linAlg(settings, fem.msh);
+        const Ordering::profile prf = fem.msh.nodeProfile();
+        const Eigen::Vector3d Hext = settings.getField(t_cmp.get_t());
+        chronometer counter;
+        for (int i = 0; i < nbSteps; i++)
+            {
+            linAlg.prepareElements(Hext, t_cmp);
+            linAlg.solver(t_cmp);
+            }
+        const double stepTime = counter.fp_elapsed() / nbSteps;
+        const long nnz = linAlg.getNbNonZeros();
+        const long precondNnz = linAlg.getPrecondNonZeros();
+
+        std::ostringstream row;
+        row << pad(Ordering::name(t), 14) << pad(std::to_string(prf.bandwidth), 11)
+            << pad(std::to_string(prf.envelope), 13) << pad(std::to_string(nnz), 12)
+            << pad(std::to_string(precondNnz), 13);
+        row.precision(3);
+        row << std::left << std::setw(10);
+        if (nnz > 0)
+            row << double(precondNnz) / nnz;
+        else
+            row << '-';
+        row << 1e3 * stepTime << " ms";
+        rows.push_back(row.str());
+        }
+    std::cout << "\nnode orderings, over " << nbSteps << " time steps:\n";
+    std::cout << pad("ordering", 14) << pad("bandwidth", 11) << pad("envelope", 13)
+              << pad("matrix nnz", 12) << pad("precond nnz", 13) << pad("fill", 10) << "step\n";
+    for (std::string const &row : rows)
+        { std::cout << row << '\n'; }
+    settings.nodeOrdering = initial;
+    settings.meshCache = initialCache;
+    }
+
 void prompt(void)
     {
     std::cout << "\t┌────────────────────────────────┐\n";
@@ -108,6 +160,10 @@ std::string parseOptions(Settings &settings, int argc, char *argv[], unsigned in
             {"", "--verify", "verify a settings file and exit", &verify},
             {"-v", "--verbose", "enable verbose mode", &settings.verbose},
             {"", "--seed", "set random seed", &use_fixed_seed},
+            {"", "--calibrate-fmm", "time and check several demag configurations and exit",
+             &settings.calibrateFmm},
+            {"", "--compare-orderings", "time the solver with each node ordering and exit",
+             &settings.compareOrderings},
             {"", "", nullptr, nullptr}  // sentinel
     };
 
@@ -142,7 +198,7 @@ std::string parseOptions(Settings &settings, int argc, char *argv[], unsigned in
                 std::cout << o->short_opt << " ";
             else
                 std::cout << "   ";
-            std::cout << pad(o->long_opt, 17) << " " << o->help << "\n";
+            std::cout << pad(o->long_opt, 20) << " " << o->help << "\n";
             }
         exit(0);
         }
@@ -200,8 +256,16 @@ int main(int argc, char *argv[])
     std::cout << "mesh file:         " << mySettings.getPbName() << '\n';
     std::cout << "output directory:  " << mySettings.r_path_output_dir << " ";
     create_dir_if_needed(mySettings.r_path_output_dir);
+    Threads::pool threads(mySettings.threadsConfig);
+    threads.report();
     timing t_prm = timing(mySettings.tf, mySettings.dt_min, mySettings.dt_max);
+    if (mySettings.compareOrderings)
+        {
+        compareOrderings(mySettings, t_prm);
+        return 0;
+        }
     Fem fem = Fem(mySettings, t_prm);
+    fem.msh.place(threads);
 
     if (mySettings.verbose)
         {
@@ -212,6 +276,12 @@ int main(int argc, char *argv[])
         fem.msh.infos();
         }
 
+    if (mySettings.calibrateFmm)
+        {
+        scal_fmm::calibrate(fem.msh, mySettings.scalfmmNbTh);
+        return 0;
+        }
+
     counter.reset();
     std::cout << "starting on:       " << date() << std::endl;
     LinAlgebra linAlg(mySettings, fem.msh);
@@ -222,14 +292,17 @@ int main(int argc, char *argv[])
         fileName += "_V.sol";
         electrostatSolver pot_solver = electrostatSolver(fem.msh, mySettings.p_stt, 1e-8,
                                                          mySettings.verbose, 5000, fileName);
+        linAlg.set_stt(pot_solver.getSTT());
         }
 
     chronometer fmm_counter(2);
-    scal_fmm::fmm myFMM(fem.msh, mySettings.scalfmmNbTh);
+    scal_fmm::fmm myFMM(fem.msh, mySettings);
+    if (threads.sharedCpus()) myFMM.setPipeline(false);
     if (mySettings.verbose)
             {
             std::cout << "Magnetostatics: particles inserted, using " << mySettings.scalfmmNbTh
                       << " threads, in " << fmm_counter.millis() << std::endl;
+            std::cout << "  " << myFMM.description() << std::endl;
             }
 
     // Catch SIGINT and SIGTERM.
@@ -0,0 +1,213 @@
+#ifndef matrix_assembly_h
+#define matrix_assembly_h
+
+/** \file matrix_assembly.h
+\brief parallel assembly of the global sparse matrix and vector of the finite element problem
+<br> The sparsity pattern of the matrix only depends on the mesh connectivity: it is computed once,
+together with a scatter map from the inner matrices Kp of the tetrahedrons to the values of the row
+major sparse matrix. The elements are colored, two elements of the same color never share a node,
+hence all the elements of a color can be scattered concurrently without any race condition.
+*/
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <vector>
+
+#include <eigen3/Eigen/Sparse>
+
+#include "tetra.h"
+
+/**
+greedy coloring of a container of elements (class T derived from element), returns the lists of the
+indices of the elements of each color. Two elements of the same color do not share any node. The
+coloring is deterministic: it only depends on the order of the elements in the container.
+*/
+template<class T>
+std::vector<std::vector<int>> colorElements(std::vector<T> const &elem /**< [in] */,
+                                            const int NOD /**< [in] nb nodes */)
+    {
+    // node to elements adjacency, compressed row storage
+    std::vector<int> start(NOD + 1, 0);
+    std::for_each(elem.begin(), elem.end(), [&start](T const &e)
+                  { for (int i : e.ind) start[i + 1]++; });
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    std::vector<int> adj(start[NOD]);
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (unsigned int k = 0; k < elem.size(); k++)
+        {
+        for (int i : elem[k].ind) adj[fill[i]++] = k;
+        }
+
+    std::vector<int> color(elem.size(), -1);
+    std::vector<unsigned int> stamp;  // stamp[c] == k if color c is forbidden for element k
+    std::vector<std::vector<int>> result;
+    for (unsigned int k = 0; k < elem.size(); k++)
+        {
+        for (int i : elem[k].ind)
+            for (int j = start[i]; j < start[i + 1]; j++)
+                {
+                const int c = color[adj[j]];
+                if (c >= 0) stamp[c] = k;
+                }
+
+        unsigned int c = 0;
+        while (c < stamp.size() && stamp[c] == k) c++;
+        if (c == stamp.size())
+            {
+            stamp.push_back(elem.size());
+            result.emplace_back();
+            }
+        color[k] = c;
+        result[c].push_back(k);
+        }
+    return result;
+    }
+
+/** \class MatrixAssembler
+colors the tetrahedrons, and precomputes the compressed row storage sparsity pattern of the global
+matrix K of the finite element problem from the tetrahedrons connectivity, and the positions in
+K.valuePtr() of all the coefficients of the inner matrices Kp. Each time step, assembling K is then a
+parallel scatter of the Kp values, with no triplets, no sort and no memory reallocation.
+*/
+class MatrixAssembler
+    {
+public:
+    /** constructor: computes the tetrahedrons coloring */
+    MatrixAssembler(const int _NOD /**< [in] nb nodes */,
+                    std::vector<Tetra::Tet> const &tet /**< [in] */)
+        : NOD(_NOD), colors(colorElements(tet, _NOD))
+        {}
+
+    /** computes the sparsity pattern and the scatter map, shape K to 2NOD*2NOD with this pattern,
+     * values are set to zero. It is not needed to assemble only vectors. */
+    void buildPattern(std::vector<Tetra::Tet> const &tet /**< [in] */,
+                      Eigen::SparseMatrix<double, Eigen::RowMajor> &K /**< [out] */)
+        {
+        // neighbours of each node through the tetrahedrons (including itself), sorted
+        std::vector<std::vector<int>> neighbours(NOD);
+        std::for_each(tet.begin(), tet.end(), [&neighbours](Tetra::Tet const &te)
+                      {
+                      for (int i : te.ind)
+                          neighbours[i].insert(neighbours[i].end(), te.ind.begin(), te.ind.end());
+                      });
+        std::for_each(std::execution::par, neighbours.begin(), neighbours.end(),
+                      [](std::vector<int> &v)
+                      {
+                      std::sort(v.begin(), v.end());
+                      v.erase(std::unique(v.begin(), v.end()), v.end());
+                      });
+
+        // rows i and NOD+i share the same columns: neighbours of node i, then their shift by NOD
+        outer.resize(2 * NOD + 1);
+        outer[0] = 0;
+        for (int r = 0; r < 2 * NOD; r++)
+            { outer[r + 1] = outer[r] + 2 * neighbours[r % NOD].size(); }
+        inner.resize(outer[2 * NOD]);
+        for (int r = 0; r < 2 * NOD; r++)
+            {
+            std::vector<int> const &v = neighbours[r % NOD];
+            const int deg = v.size();
+            for (int k = 0; k < deg; k++)
+                {
+                inner[outer[r] + k] = v[k];
+                inner[outer[r] + deg + k] = NOD + v[k];
+                }
+            }
+
+        // scatter map: Kp is column major, its coefficient (i,j) is Kp.data()[i + 2*N*j]
+        scatter.resize(tet.size() * NB_COEFFS);
+        std::for_each(std::execution::par, tet.begin(), tet.end(),
+                      [this, &tet](Tetra::Tet const &te)
+                      {
+                      int *pos = scatter.data() + NB_COEFFS * (&te - tet.data());
+                      for (int j = 0; j < 2 * Tetra::N; j++)
+                          for (int i = 0; i < 2 * Tetra::N; i++)
+                              { pos[i + 2 * Tetra::N * j] = position(row(te, i), col(te, j)); }
+                      });
+
+        K.resize(2 * NOD, 2 * NOD);
+        K.resizeNonZeros(inner.size());
+        std::copy(outer.begin(), outer.end(), K.outerIndexPtr());
+        std::copy(inner.begin(), inner.end(), K.innerIndexPtr());
+        std::fill(K.valuePtr(), K.valuePtr() + inner.size(), 0.0);
+        }
+
+    /** number of colors of the tetrahedrons */
+    inline int getNbColors(void) const { return colors.size(); }
+
+    /** groups of tetrahedrons indices sharing no node */
+    inline std::vector<std::vector<int>> const &getColors(void) const { return colors; }
+
+    /** number of non zero coefficients of the sparsity pattern, zero before buildPattern() */
+    inline int getNbNonZeros(void) const { return inner.size(); }
+
+    /** assemble the sparse matrix K from the inner matrices Kp of the tetrahedrons. K must have
+     * been shaped by buildPattern() */
+    void assemble(std::vector<Tetra::Tet> const &tet /**< [in] */,
+                  Eigen::SparseMatrix<double, Eigen::RowMajor> &K /**< [in|out] */) const
+        {
+        double *val = K.valuePtr();
+        std::fill(std::execution::par, val, val + K.nonZeros(), 0.0);
+        std::for_each(colors.begin(), colors.end(),
+                      [this, &tet, val](std::vector<int> const &color)
+                      {
+                      std::for_each(std::execution::par, color.begin(), color.end(),
+                                    [this, &tet, val](const int k)
+                                    {
+                                    const double *Kp = tet[k].Kp.data();
+                                    const int *pos = scatter.data() + NB_COEFFS * k;
+                                    for (int i = 0; i < NB_COEFFS; i++) { val[pos[i]] += Kp[i]; }
+                                    });
+                      });
+        }
+
+    /** assemble the vector L from the inner vectors Lp of the tetrahedrons (L is not zeroed) */
+    void assemble(std::vector<Tetra::Tet> const &tet /**< [in] */,
+                  Eigen::Ref<Eigen::VectorXd> L /**< [in|out] */) const
+        {
+        std::for_each(colors.begin(), colors.end(),
+                      [&tet, &L, this](std::vector<int> const &color)
+                      {
+                      std::for_each(std::execution::par, color.begin(), color.end(),
+                                    [&tet, &L, this](const int k)
+                                    { tet[k].assemblage_vect(NOD, L); });
+                      });
+        }
+
+private:
+    /** number of coefficients of Kp */
+    static const int NB_COEFFS = 4 * Tetra::N * Tetra::N;
+
+    /** number of nodes */
+    const int NOD;
+
+    /** tetrahedrons indices grouped by color */
+    const std::vector<std::vector<int>> colors;
+
+    /** row pointers of the compressed row storage pattern */
+    std::vector<int> outer;
+
+    /** column indices of the compressed row storage pattern */
+    std::vector<int> inner;
+
+    /** positions in K.valuePtr() of the coefficients of Kp, NB_COEFFS per tetrahedron */
+    std::vector<int> scatter;
+
+    /** row of K of the row i of Kp, consistent with element::assemblage_mat */
+    inline int row(Tetra::Tet const &te, const int i) const
+        { return (i < Tetra::N) ? NOD + te.ind[i] : te.ind[i - Tetra::N]; }
+
+    /** column of K of the column j of Kp, consistent with element::assemblage_mat */
+    inline int col(Tetra::Tet const &te, const int j) const
+        { return (j < Tetra::N) ? te.ind[j] : NOD + te.ind[j - Tetra::N]; }
+
+    /** position of coefficient (r,c) in the values of the pattern */
+    inline int position(const int r, const int c) const
+        {
+        return std::lower_bound(inner.begin() + outer[r], inner.begin() + outer[r + 1], c)
+               - inner.begin();
+        }
+    };  // end class MatrixAssembler
+
+#endif
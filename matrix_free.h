@@ -0,0 +1,171 @@
+#ifndef matrix_free_h
+#define matrix_free_h
+
+/** \file matrix_free.h
+\brief matrix free operator of the finite element problem
+<br> The global matrix K is never built: the product K*x is computed by looping over the
+tetrahedrons and applying their inner matrices Kp, color by color (see matrix_assembly.h) to scatter
+without race condition. The class follows the matrix replacement pattern of the eigen documentation,
+so that it can be used with the eigen iterative solvers.
+*/
+
+#include <algorithm>
+#include <execution>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Sparse>
+
+#include "preconditioner.h"
+#include "tetra.h"
+
+class MatrixFreeOperator;
+
+namespace Eigen
+    {
+namespace internal
+    {
+/** MatrixFreeOperator looks like a sparse matrix for eigen */
+template<>
+struct traits<MatrixFreeOperator> : public traits<SparseMatrix<double>>
+    {
+    };
+    }  // namespace internal
+    }  // namespace Eigen
+
+/** \class MatrixFreeOperator
+linear operator of size 2NOD, its coefficients are stored in the inner matrices Kp of the
+tetrahedrons, with the same conventions as element::assemblage_mat
+*/
+class MatrixFreeOperator : public Eigen::EigenBase<MatrixFreeOperator>
+    {
+public:
+    /** scalar type */
+    typedef double Scalar;
+
+    /** real scalar type */
+    typedef double RealScalar;
+
+    /** index type */
+    typedef int StorageIndex;
+
+    /** dimensions are unknown at compile time */
+    enum
+        {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+        };
+
+    /** constructor */
+    MatrixFreeOperator(const int _NOD /**< [in] nb nodes */,
+                       std::vector<Tetra::Tet> const &_tet /**< [in] */,
+                       std::vector<std::vector<int>> const &_colors /**< [in] tetrahedrons colors */)
+        : NOD(_NOD), tet(_tet), colors(_colors)
+        {}
+
+    /** number of rows */
+    inline Eigen::Index rows() const { return 2 * NOD; }
+
+    /** number of columns */
+    inline Eigen::Index cols() const { return 2 * NOD; }
+
+    /** lazy product with a vector */
+    template<typename Rhs>
+    Eigen::Product<MatrixFreeOperator, Rhs, Eigen::AliasFreeProduct>
+    operator*(const Eigen::MatrixBase<Rhs> &x) const
+        { return Eigen::Product<MatrixFreeOperator, Rhs, Eigen::AliasFreeProduct>(*this, x.derived()); }
+
+    /** y = K x */
+    void apply(Eigen::Ref<const Eigen::VectorXd> x /**< [in] */,
+               Eigen::Ref<Eigen::VectorXd> y /**< [out] */) const
+        {
+        y.setZero();
+        std::for_each(colors.begin(), colors.end(),
+                      [this, &x, &y](std::vector<int> const &color)
+                      {
+                      std::for_each(std::execution::par, color.begin(), color.end(),
+                                    [this, &x, &y](const int k)
+                                    {
+                                    Tetra::Tet const &te = tet[k];
+                                    Eigen::Matrix<double, 2 * Tetra::N, 1> X;
+                                    for (int i = 0; i < Tetra::N; i++)
+                                        {
+                                        X(i) = x(te.ind[i]);
+                                        X(Tetra::N + i) = x(NOD + te.ind[i]);
+                                        }
+                                    const Eigen::Matrix<double, 2 * Tetra::N, 1> Y = te.Kp * X;
+                                    for (int i = 0; i < Tetra::N; i++)
+                                        {
+                                        y(NOD + te.ind[i]) += Y(i);
+                                        y(te.ind[i]) += Y(Tetra::N + i);
+                                        }
+                                    });
+                      });
+        }
+
+    /** returns the 2x2 diagonal blocks (i, NOD+i) of the operator, to build preconditioners */
+    Precond::nodeBlocks getNodeBlocks(void) const
+        {
+        Precond::nodeBlocks B(NOD, Eigen::Matrix2d::Zero());
+        std::for_each(colors.begin(), colors.end(),
+                      [this, &B](std::vector<int> const &color)
+                      {
+                      std::for_each(std::execution::par, color.begin(), color.end(),
+                                    [this, &B](const int k)
+                                    {
+                                    Tetra::Tet const &te = tet[k];
+                                    const int N = Tetra::N;
+                                    for (int a = 0; a < N; a++)
+                                        {
+                                        Eigen::Matrix2d &b = B[te.ind[a]];
+                                        b(0, 0) += te.Kp(N + a, a);
+                                        b(0, 1) += te.Kp(N + a, N + a);
+                                        b(1, 0) += te.Kp(a, a);
+                                        b(1, 1) += te.Kp(a, N + a);
+                                        }
+                                    });
+                      });
+        return B;
+        }
+
+private:
+    /** number of nodes */
+    const int NOD;
+
+    /** tetrahedrons, holding the inner matrices Kp */
+    std::vector<Tetra::Tet> const &tet;
+
+    /** tetrahedrons indices grouped by color */
+    std::vector<std::vector<int>> const &colors;
+    };
+
+namespace Eigen
+    {
+namespace internal
+    {
+/** product of a MatrixFreeOperator with a dense vector */
+template<typename Rhs>
+struct generic_product_impl<MatrixFreeOperator, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<MatrixFreeOperator, Rhs,
+                                generic_product_impl<MatrixFreeOperator, Rhs>>
+    {
+    /** dst = lhs * rhs */
+    template<typename Dest>
+    static void evalTo(Dest &dst, const MatrixFreeOperator &lhs, const Rhs &rhs)
+        { lhs.apply(rhs, dst); }
+
+    /** dst += alpha * lhs * rhs */
+    template<typename Dest>
+    static void scaleAndAddTo(Dest &dst, const MatrixFreeOperator &lhs, const Rhs &rhs,
+                              const double &alpha)
+        {
+        Eigen::VectorXd y(lhs.rows());
+        lhs.apply(rhs, y);
+        dst.noalias() += alpha * y;
+        }
+    };
+    }  // namespace internal
+    }  // namespace Eigen
+
+#endif
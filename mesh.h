@@ -2,17 +2,21 @@
 #define mesh_h
 
 /** \file mesh.h
-\brief class mesh, readMesh is expecting a mesh file in gmsh text format 2.2, with first order tetraedrons and triangular facettes.
+\brief class mesh, readMesh is expecting a mesh file in gmsh format 2.2 text or 4.1 text or binary, with first order tetraedrons and triangular facettes.
 */
 
 #include <algorithm>
+#include <cstdint>
 #include <execution>
 #include <map>
 #include <numeric>
-#include <set>
+#include <tuple>
 
+#include "chronometer.h"
 #include "facette.h"
 #include "node.h"
+#include "ordering.h"
+#include "snapshot.h"
 #include "surface.h"
 #include "tetra.h"
 
@@ -29,12 +33,53 @@ class mesh
     {
 public:
     /** constructor : read mesh file, reorder indices and computes some values related to the mesh :
-     center and length along coordinates and diameter = max(l(x|y|z)), volume and surface */
+     center and length along coordinates and diameter = max(l(x|y|z)), volume and surface. If the
+     mesh cache is enabled, the preprocessed mesh is read from the cache when it is up to date, and
+     written to it otherwise. */
     inline mesh(Settings const &mySets /**< [in] */)
+        {
+        const std::string cacheName = mySets.getPbName() + ".cache";
+        chronometer counter(2);
+        const uint64_t key = mySets.meshCache ? cacheKey(mySets) : 0;
+        if (mySets.meshCache && readCache(mySets, cacheName, key))
+            {
+            if (mySets.verbose)
+                {
+                std::cout << "Mesh read from cache " << cacheName << " in " << counter.millis() << '\n';
+                }
+            }
+        else
+            {
+            preprocess(mySets);
+            if (mySets.meshCache) writeCache(mySets, cacheName, key);
+            }
+        setFacettesMs(mySets);
+
+        vol = std::transform_reduce(std::execution::par, tet.begin(), tet.end(), 0.0, std::plus{},
+                                    [](Tetra::Tet const &te) { return te.calc_vol(); });
+
+        // devNote: Ms for tetra is computed here, might be better to do it in Tet constructor
+        std::for_each(std::execution::par, tet.begin(), tet.end(), [&mySets](Tetra::Tet &te)
+                      { te.Ms = nu0 * mySets.paramTetra[te.idxPrm].J; }  );
+
+        surf = std::transform_reduce(std::execution::par, fac.begin(), fac.end(), 0.0, std::plus{},
+                                     [](Facette::Fac const &fa) { return fa.surf; });
+        if (mySets.verbose)
+            {
+            std::cout << "  volume and surface in " << counter.millis() << '\n';
+            }
+        }
+
+    /** reads the mesh file, reorders the indices, computes the bounding box and sorts the nodes */
+    void preprocess(Settings const &mySets /**< [in] */)
         {
         readMesh(mySets);
-        indexReorder(mySets);  // reordering of index nodes for facette orientation, also some
-                               // modifications on fac::Ms
+        chronometer counter(2);
+        indexReorder();  // reordering of index nodes for facette orientation
+        if (mySets.verbose)
+            {
+            std::cout << "  reindexed in " << counter.millis() << '\n';
+            }
 
         double xmin = minNodes(Nodes::IDX_X);
         double xmax = maxNodes(Nodes::IDX_X);
@@ -49,17 +94,29 @@ public:
         diam = l.maxCoeff();
         c = Eigen::Vector3d(0.5 * (xmax + xmin), 0.5 * (ymax + ymin), 0.5 * (zmax + zmin));
 
-        sortNodes();
-
-        vol = std::transform_reduce(std::execution::par, tet.begin(), tet.end(), 0.0, std::plus{},
-                                    [](Tetra::Tet const &te) { return te.calc_vol(); });
+        sortNodes(mySets.nodeOrdering, mySets.verbose);
+        if (mySets.sortTetrahedrons) sortTets();
+        if (mySets.verbose)
+            {
+            std::cout << "  nodes sorted in " << counter.millis() << '\n';
+            }
+        }
 
-        // devNote: Ms for tetra is computed here, might be better to do it in Tet constructor
-        std::for_each(std::execution::par, tet.begin(), tet.end(), [&mySets](Tetra::Tet &te)
-                      { te.Ms = nu0 * mySets.paramTetra[te.idxPrm].J; }  );
+    /** graph of the nodes through the tetrahedrons */
+    Ordering::graph nodeGraph(void) const
+        {
+        std::vector<int> ind(Tetra::N * tet.size());
+        for (size_t k = 0; k < tet.size(); k++)
+            { std::copy(tet[k].ind.begin(), tet[k].ind.end(), ind.begin() + Tetra::N * k); }
+        return Ordering::buildGraph(node.size(), ind, Tetra::N);
+        }
 
-        surf = std::transform_reduce(std::execution::par, fac.begin(), fac.end(), 0.0, std::plus{},
-                                     [](Facette::Fac const &fa) { return fa.surf; });
+    /** bandwidth and envelope of the graph of the nodes in their current ordering */
+    Ordering::profile nodeProfile(void) const
+        {
+        std::vector<int> identity(node.size());
+        std::iota(identity.begin(), identity.end(), 0);
+        return Ordering::measure(nodeGraph(), identity);
         }
 
     /** return number of nodes  */
@@ -72,16 +129,16 @@ public:
     inline int getNbTets(void) const { return tet.size(); }
 
     /** getter : return node.p */
-    inline const Eigen::Vector3d getNode_p(const int i) const { return node[i].p; }
+    inline const Eigen::Vector3d getNode_p(const int i) const { return node.p[i]; }
     
     /** getter : return node */
-    inline const Eigen::Vector3d getNode_u(const int i) const { return node[i].u; }
+    inline const Eigen::Vector3d getNode_u(const int i) const { return node.u[i]; }
 
     /** setter for u0 */
-    inline void set_node_u0(const int i, Eigen::Vector3d const &val) { node[i].u0 = val; }
+    inline void set_node_u0(const int i, Eigen::Vector3d const &val) { node.u0[i] = val; }
 
-    /** fix to zero node[i].v */
-    inline void set_node_zero_v(const int i) { node[i].v.setZero(); }
+    /** fix to zero node.v[i] */
+    inline void set_node_zero_v(const int i) { node.v[i].setZero(); }
 
     /** basic informations on the mesh */
     void infos(void) const
@@ -98,8 +155,7 @@ public:
     /** call setBasis for all nodes, and update P matrix for all elements */
     void setBasis(const double r)
         {
-        std::for_each(std::execution::par, node.begin(), node.end(),
-                      [&r](Nodes::Node &nod) { nod.setBasis(r); });
+        node.setBasis(r);
 
         std::for_each(std::execution::par, tet.begin(), tet.end(),
                       [](Tetra::Tet &t) { t.buildMatP();} );
@@ -123,7 +179,7 @@ public:
                 {
                 v2max = v2;
                 }
-            node[i].make_evol(vp, vq, dt);
+            node.make_evol(i, vp, vq, dt);
             }
 
         return sqrt(v2max);
@@ -136,18 +192,30 @@ public:
 
         for (unsigned int i = 0; i < NOD; i++)
             {
-            Eigen::Vector3d const& n_v = node[i].v;
+            Eigen::Vector3d const& n_v = node.v[i];
             
-            G(i) = n_v.dot(node[i].ep) / gamma0;
-            G(NOD + i) = n_v.dot(node[i].eq) / gamma0;
+            G(i) = n_v.dot(node.ep[i]) / gamma0;
+            G(NOD + i) = n_v.dot(node.eq[i]) / gamma0;
             }
         }
 
     /** call evolution for all the nodes */
     inline void evolution(void)
         {
-        std::for_each(std::execution::par, node.begin(), node.end(),
-                      [](Nodes::Node &nod) { nod.evolution(); });
+        node.evolution();
+        }
+
+    /** moves the arrays of the nodes and of the elements to the NUMA nodes of the threads of pool,
+     * see Threads::pool::place */
+    void place(Threads::pool const &pool /**< [in] */)
+        {
+        for (auto *v : {&node.p, &node.u0, &node.v0, &node.u, &node.v, &node.ep, &node.eq})
+            { pool.place(*v); }
+        for (auto *v : {&node.phi0, &node.phi, &node.phiv0, &node.phiv})
+            { pool.place(*v); }
+        pool.place(tetGeom);
+        pool.place(tet);
+        pool.place(fac);
         }
 
     /** isobarycenter */
@@ -168,44 +236,65 @@ public:
     /** face container */
     std::vector<Facette::Fac> fac;
 
+    /** geometries of the tetrahedrons, filled by the constructor of Tet */
+    std::vector<Tetra::geometry> tetGeom;
+
     /** tetrahedron container */
     std::vector<Tetra::Tet> tet;
 
     /** surface container */
     std::vector<Mesh::Surf> s;
 
-    /** read a solution from a file (tsv formated) and initialize fem struct to restart computation
-     * from that distribution, return time
+    /** read a solution from a file (tsv formated, or a binary snapshot, see snapshot.h) and
+     * initialize fem struct to restart computation from that distribution, return time
      */
     double readSol(bool VERBOSE /**< [in] */,
-                   const std::string fileName /**< [in] input .sol text file */);
+                   const std::string fileName /**< [in] input .sol text file or snapshot */);
 
     /** computes an analytical initial magnetization distribution as a starting point for the
      * simulation */
     inline void init_distrib(Settings const &mySets /**< [in] */)
         {
-        std::for_each(node.begin(),node.end(),[&mySets](Nodes::Node &n)
-                                              {
-                                              n.u0 = mySets.getMagnetization(n.p);
-                                              n.u = n.u0;
-                                              n.phi = 0.;
-                                              n.phiv = 0.;
-                                              } );
+        for (int i = 0; i < node.size(); i++)
+            {
+            node.u0[i] = mySets.getMagnetization(node.p[i]);
+            node.u[i] = node.u0[i];
+            node.phi[i] = 0.;
+            node.phiv[i] = 0.;
+            }
+        }
+
+    /**
+    average component idx of the vector field F on the whole set of tetetrahedron
+    */
+    template<Nodes::vectorField F>
+    double avg(Nodes::index d /**< [in] */) const
+        {
+        double sum =
+                std::transform_reduce(std::execution::par, tet.begin(), tet.end(), 0.0, std::plus{},
+                                      [&d](Tetra::Tet const &te)
+                                      {
+                                          Eigen::Matrix<double,Tetra::NPI,1> val;
+                                          te.interpolation<F>(d, val);
+                                          return te.weights().dot(val);
+                                      });
+
+        return sum / vol;
         }
 
     /**
     average component of either u or v through getter on the whole set of tetetrahedron
     */
-    double avg(std::function<double(Nodes::Node, Nodes::index)> getter /**< [in] */,
+    double avg(std::function<double(Nodes::Node const &, Nodes::index)> getter /**< [in] */,
                Nodes::index d /**< [in] */) const
         {
         double sum =
                 std::transform_reduce(std::execution::par, tet.begin(), tet.end(), 0.0, std::plus{},
-                                      [getter, &d](Tetra::Tet const &te)
+                                      [&getter, &d](Tetra::Tet const &te)
                                       {
                                           Eigen::Matrix<double,Tetra::NPI,1> val;
                                           te.interpolation(getter, d, val);
-                                          return te.weight.dot(val);
+                                          return te.weights().dot(val);
                                       });
 
         return sum / vol;
@@ -216,28 +305,40 @@ public:
                  const std::string fileName /**< [in] */,
                  std::string const &metadata /**< [in] */) const;
 
+    /** copy of the solution in the order of the mesh file, to be written as a binary snapshot */
+    Snapshot::data snapshot(const double t /**< [in] */, std::string const &metadata /**< [in] */,
+                            const bool singlePrecision /**< [in] */) const;
+
     /** text file (tsv) writing function for a solution of a side problem, used by electrostatSolver
      */
     bool savesol(const int precision /**< [in] */, const std::string fileName /**< [in] */,
                  std::string const &metadata /**< [in] */,
                  std::vector<double> const &val /**< [in] */) const;
 
-    /** setter for node[i]; what_to_set will fix what is the part of the node struct to set (usefull
-     * for fmm_demag.h) */
+    /** setter for the scalar field F of node[i] (usefull for fmm_demag.h) */
+    template<Nodes::scalarField F>
+    inline void set(const int i, const double val)
+        {
+        node.set<F>(i, val);
+        }
+
+    /** setter for node[i]; what_to_set will fix what is the part of the node struct to set */
     inline void set(const int i, std::function<void(Nodes::Node &, const double)> what_to_set,
                     const double val)
         {
-        what_to_set(node[i], val);
+        Nodes::Node n = node.getNode(i);
+        what_to_set(n, val);
+        node.setNode(i, n);
         }
 
 private:
-    /** node container: not initialized by constructor, but later while reading the mesh by member
+    /** node storage: not initialized by constructor, but later while reading the mesh by member
      * function init_node */
-    std::vector<Nodes::Node> node;
+    Nodes::Store node;
 
-    /** Index of a node in the `node` vector. This vector is itself indexed by the node position in
+    /** Index of a node in the `node` arrays. This vector is itself indexed by the node position in
      * the *.msh and *.sol files. In other words, the node found at `file_idx` in a file is stored
-     * as `node[node_index[file_idx]]`.
+     * at `node_index[file_idx]`, e.g. its position is `node.p[node_index[file_idx]]`.
      *
      * This is the inverse of the permutation we applied when sorting the nodes. */
     std::vector<int> node_index;
@@ -248,10 +349,64 @@ private:
     /** map of the volume region physical names from mesh file */
     std::map<int, std::string> volRegNames;
 
+    /** \struct faceKey
+    oriented face of a tetrahedron, for indexReorder: its node indices in increasing order, the
+    parity of the permutation sorting them, which is the orientation of the face, and its tetrahedron
+    */
+    struct faceKey
+        {
+        int i[3];   /**< node indices, in increasing order */
+        int parity; /**< 0 if the face is an even permutation of i, 1 otherwise */
+        int tet;    /**< index of the tetrahedron */
+
+        /** default constructor */
+        faceKey() = default;
+
+        /** constructor from the face i0 i1 i2 of the tetrahedron k */
+        faceKey(const int i0, const int i1, const int i2, const int k) : tet(k)
+            {
+            // rotation to the smallest index first keeps the orientation
+            if (i0 < i1 && i0 < i2)
+                i[0] = i0, i[1] = i1, i[2] = i2;
+            else if (i1 < i2)
+                i[0] = i1, i[1] = i2, i[2] = i0;
+            else
+                i[0] = i2, i[1] = i0, i[2] = i1;
+            parity = (i[1] > i[2]);
+            if (parity) std::swap(i[1], i[2]);
+            }
+
+        /** true if both are the same face with the same orientation */
+        bool sameFace(faceKey const &k) const
+            { return i[0] == k.i[0] && i[1] == k.i[1] && i[2] == k.i[2] && parity == k.parity; }
+
+        /** lexicographic order on i, parity, tet */
+        bool operator<(faceKey const &k) const
+            {
+            return std::tie(i[0], i[1], i[2], parity, tet)
+                   < std::tie(k.i[0], k.i[1], k.i[2], k.parity, k.tet);
+            }
+        };
+
+    /** tetrahedron of each facette found by indexReorder: its index plus one, with the sign of the
+     * orientation of the facette relative to the tetrahedron, or zero if none */
+    std::vector<int> facAdjacent;
+
+    /** key of the mesh cache: hash of the mesh file, of the length unit, of the orderings and of
+     * the names of the regions of the settings */
+    static uint64_t cacheKey(Settings const &mySets);
+
+    /** reads the preprocessed mesh from the cache fileName, returns false if the cache is missing
+     * or if its key or its version differ */
+    bool readCache(Settings const &mySets, std::string const &fileName, const uint64_t key);
+
+    /** writes the preprocessed mesh to the cache fileName, prints a warning on failure */
+    void writeCache(Settings const &mySets, std::string const &fileName, const uint64_t key) const;
+
     /** memory allocation for the nodes */
     inline void init_node(const int Nb) { node.resize(Nb); }
 
-    /** reading mesh format 2.2 text file function */
+    /** reading mesh file function, see mesh_reader.h for the supported formats */
     void readMesh(Settings const &mySets);
 
     /** loop on nodes to apply predicate 'whatTodo'  */
@@ -259,10 +414,10 @@ private:
                      std::function<bool(double, double)> whatToDo) const
         {
         double result(init_val);
-        std::for_each(node.begin(), node.end(),
-                      [&result, coord, whatToDo](Nodes::Node const &n)
+        std::for_each(node.p.begin(), node.p.end(),
+                      [&result, coord, whatToDo](Eigen::Vector3d const &p)
                       {
-                          double val = n.p(coord);
+                          double val = p(coord);
                           if (whatToDo(val, result)) result = val;
                       });
         return result;
@@ -281,7 +436,8 @@ private:
         }
 
     /** redefine orientation of triangular faces in accordance with the tetrahedron
-    * reorientation of the tetrahedrons if needed; definition of Ms on facette elements
+    * reorientation of the tetrahedrons if needed; finds the tetrahedron of each facette for
+    * setFacettesMs
     Indices and orientation convention :
 
                         v
@@ -304,103 +460,129 @@ private:
                         ` w
 
 */
-    void indexReorder(Settings const &settings)
+    void indexReorder(void)
         {
-        std::set<Facette::Fac> sf;  // implicit use of operator< overloaded in class Fac
-
-        std::for_each(tet.begin(), tet.end(),
-                      [this,&sf](Tetra::Tet const &te)
+        // the four faces of each tetrahedron, oriented outward, sorted by key to be found by
+        // binary search
+        std::vector<faceKey> keys(4 * tet.size());
+        std::for_each(std::execution::par, tet.begin(), tet.end(),
+                      [this, &keys](Tetra::Tet const &te)
                       {
                       const int ia = te.ind[0];
                       const int ib = te.ind[1];
                       const int ic = te.ind[2];
                       const int id = te.ind[3];
+                      const int k = &te - tet.data();
 
-                      sf.insert(Facette::Fac(node, 0, te.idxPrm, {ia, ic, ib} ));
-                      sf.insert(Facette::Fac(node, 0, te.idxPrm, {ib, ic, id} ));
-                      sf.insert(Facette::Fac(node, 0, te.idxPrm, {ia, id, ic} ));
-                      sf.insert(Facette::Fac(node, 0, te.idxPrm, {ia, ib, id} ));
+                      keys[4 * k] = faceKey(ia, ic, ib, k);
+                      keys[4 * k + 1] = faceKey(ib, ic, id, k);
+                      keys[4 * k + 2] = faceKey(ia, id, ic, k);
+                      keys[4 * k + 3] = faceKey(ia, ib, id, k);
                       });  // end for_each
+        std::sort(std::execution::par, keys.begin(), keys.end());
 
+        facAdjacent.assign(fac.size(), 0);
+        std::for_each(
+                std::execution::par, fac.begin(), fac.end(),
+                [this, &keys](Facette::Fac const &fa)
+                {
+                    int i0 = fa.ind[0], i1 = fa.ind[1], i2 = fa.ind[2];
+                    for (int perm = 0; perm < 2; perm++)
+                        {
+                        // first tetrahedron with the face i0 i1 i2 in this orientation
+                        const faceKey key(i0, i1, i2, -1);
+                        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+                        if (it != keys.end() && it->sameFace(key))
+                            {  // found
+                            Eigen::Vector3d p0p1 = node.p[i1] - node.p[i0];
+                            Eigen::Vector3d p0p2 = node.p[i2] - node.p[i0];
+
+                            // carefull, calc_norm computes the normal to the face before idx swap
+                            const double orientation = p0p1.dot(p0p2.cross(fa.calc_norm()));
+                            facAdjacent[&fa - fac.data()] = std::copysign(it->tet + 1, orientation);
+                            }
+                        std::swap(i1, i2);  // it seems from ref archive we do not want to swap
+                                            // inner fac indices but local i1 and i2
+                        }                   // end perm
+                });  // end for_each
+        }
+
+    /** definition of Ms on facette elements, from the tetrahedron found by indexReorder, with the
+     * sign of the orientation of the facette relative to the tetrahedron. Ms is zero on the facettes
+     * without charges. */
+    void setFacettesMs(Settings const &settings)
+        {
         std::for_each(
                 fac.begin(), fac.end(),
-                [this, &settings, &sf](Facette::Fac &fa)
+                [this, &settings](Facette::Fac &fa)
                 {
+                    const int adjacent = facAdjacent[&fa - fac.data()];
                     fa.Ms = 0.;
-                    if (!(settings.paramFacette[fa.idxPrm].suppress_charges))
+                    if (adjacent != 0 && !(settings.paramFacette[fa.idxPrm].suppress_charges))
                         {
-                        int i0 = fa.ind[0], i1 = fa.ind[1], i2 = fa.ind[2];
-                        std::set<Facette::Fac>::iterator it = sf.end();
-                        for (int perm = 0; perm < 2; perm++)
-                            {
-                            for (int nrot = 0; nrot < 3; nrot++)
-                                {
-                                Facette::Fac fc(node, 0, 0, {0, 0, 0} );
-                                fc.ind[(0 + nrot) % 3] = i0;
-                                fc.ind[(1 + nrot) % 3] = i1;
-                                fc.ind[(2 + nrot) % 3] = i2;
-                                it = sf.find(fc);
-                                if (it != sf.end()) break;
-                                }
-
-                            if (it != sf.end())
-                                {  // found
-                                Eigen::Vector3d p0p1 = node[it->ind[1]].p - node[it->ind[0]].p;
-                                Eigen::Vector3d p0p2 = node[it->ind[2]].p - node[it->ind[0]].p;
-                                
-                                // fa.Ms will have the magnitude of first arg of copysign, with the
-                                // sign of second arg
-                                fa.Ms = std::copysign(
-                                        nu0 * settings.paramTetra[it->idxPrm].J,
-                                        p0p1.dot(p0p2.cross(fa.calc_norm())) );  // carefull, calc_norm computes the normal to the face before idx swap
-                                }
-                            std::swap(i1, i2);  // it seems from ref archive we do not want to swap
-                                                // inner fac indices but local i1 and i2
-                            fa.n = fa.calc_norm(); // update normal vector
-                            }                   // end perm
+                        // fa.Ms will have the magnitude of first arg of copysign, with the
+                        // sign of second arg
+                        fa.Ms = std::copysign(nu0 * settings.paramTetra[tet[std::abs(adjacent) - 1].idxPrm].J,
+                                              adjacent);
                         }
                 });  // end for_each
-        if (settings.verbose)
-            {
-            std::cout << "  reindexed\n";
-            }
         }
 
-    /** Sort the nodes along the longest axis of the sample. This should reduce the bandwidth of
-     * the matrix we will have to solve for. */
-    void sortNodes()
+    /** Sort the nodes in the ordering t, by default along the longest axis of the sample. This
+     * should reduce the bandwidth of the matrix we will have to solve for. If verbose, the bandwidth
+     * and the envelope of the graph of the nodes are printed before and after. */
+    void sortNodes(const Ordering::type t = Ordering::LONGEST_AXIS, const bool verbose = false)
         {
-        // Find the longest axis of the sample.
-        Nodes::index long_axis;
-        if (l.x() > l.y())
-            {
-            if (l.x() > l.z())
-                long_axis = Nodes::IDX_X;
-            else
-                long_axis = Nodes::IDX_Z;
-            }
-        else
+        Ordering::graph g;
+        if (t == Ordering::RCM || verbose) g = nodeGraph();
+
+        std::vector<int> permutation;
+        switch (t)
             {
-            if (l.y() > l.z())
-                long_axis = Nodes::IDX_Y;
-            else
-                long_axis = Nodes::IDX_Z;
+            case Ordering::RCM: permutation = Ordering::rcm(g); break;
+            case Ordering::HILBERT: permutation = Ordering::hilbert(node.p); break;
+            case Ordering::MORTON: permutation = Ordering::morton(node.p); break;
+            default:
+                {
+                // Find the longest axis of the sample.
+                Nodes::index long_axis;
+                if (l.x() > l.y())
+                    {
+                    if (l.x() > l.z())
+                        long_axis = Nodes::IDX_X;
+                    else
+                        long_axis = Nodes::IDX_Z;
+                    }
+                else
+                    {
+                    if (l.y() > l.z())
+                        long_axis = Nodes::IDX_Y;
+                    else
+                        long_axis = Nodes::IDX_Z;
+                    }
+                // Sort the nodes along this axis, indirectly through an array of indices.
+                permutation = Ordering::alongAxis(node.p, long_axis);
+                }
             }
-
-        // Sort the nodes along this axis, indirectly through an array of indices.
-        std::vector<int> permutation(node.size());
-        std::iota(permutation.begin(), permutation.end(), 0);
-        std::sort(permutation.begin(), permutation.end(),
-                  [this, long_axis](int a, int b)
-                  { return node[a].p(long_axis) < node[b].p(long_axis); });
         node_index.resize(node.size());
-        for (size_t i = 0; i < node.size(); i++)
+        for (int i = 0; i < node.size(); i++)
             node_index[permutation[i]] = i;
 
+        if (verbose)
+            {
+            std::vector<int> identity(node.size());
+            std::iota(identity.begin(), identity.end(), 0);
+            const Ordering::profile before = Ordering::measure(g, identity);
+            const Ordering::profile after = Ordering::measure(g, node_index);
+            std::cout << "  node ordering " << Ordering::name(t) << ": bandwidth " << before.bandwidth
+                      << " -> " << after.bandwidth << ", envelope " << before.envelope << " -> "
+                      << after.envelope << '\n';
+            }
+
         // Actually sort the array of nodes.
-        std::vector<Nodes::Node> node_copy(node);
-        for (size_t i = 0; i < node.size(); i++)
-            node[i] = node_copy[permutation[i]];
+        Nodes::Store node_copy(node);
+        for (int i = 0; i < node.size(); i++)
+            node.setNode(i, node_copy.getNode(permutation[i]));
 
         // Update the indices stored in the elements.
         std::for_each(tet.begin(), tet.end(),
@@ -431,6 +613,44 @@ private:
                                         });
                       });
         }
+
+    /** Sort the tetrahedrons by their first node in the node ordering, so that consecutive
+     * tetrahedrons share nodes close in memory. The geometry table is sorted as well, and the
+     * tetrahedrons of the facettes are updated. */
+    void sortTets(void)
+        {
+        std::vector<int> order(tet.size());
+        std::iota(order.begin(), order.end(), 0);
+        auto first = [this](const int k) { return *std::min_element(tet[k].ind.begin(), tet[k].ind.end()); };
+        std::stable_sort(order.begin(), order.end(),
+                         [&first](const int a, const int b) { return first(a) < first(b); });
+
+        std::vector<Tetra::geometry> geom(tet.size());
+        std::vector<int> newIndex(tet.size());
+        for (size_t i = 0; i < order.size(); i++)
+            {
+            geom[i] = tetGeom[order[i]];
+            newIndex[order[i]] = i;
+            }
+        tetGeom.swap(geom);
+
+        std::vector<Tetra::Tet> sorted;
+        sorted.reserve(tet.size());
+        for (size_t i = 0; i < order.size(); i++)
+            {
+            Tetra::Tet const &te = tet[order[i]];
+            sorted.push_back(Tetra::Tet(node, tetGeom, te.idxPrm,
+                                        {te.ind[0], te.ind[1], te.ind[2], te.ind[3]}, i));
+            sorted.back().idx = i;
+            }
+        tet.swap(sorted);
+
+        for (int &adjacent : facAdjacent)
+            {
+            if (adjacent != 0)
+                adjacent = std::copysign(newIndex[std::abs(adjacent) - 1] + 1, adjacent);
+            }
+        }
     };
 
     }  // end namespace Mesh
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mesh.h"
+
+/** \file mesh_cache.cpp
+\brief binary cache of the preprocessed mesh. The cache holds the nodes sorted by sortNodes, the
+node_index permutation, the tetrahedrons and the facettes with their zero based oriented indices and
+their region, the geometry table of the tetrahedrons, the tetrahedron of each facette and the
+surfaces. It is keyed by a hash of the mesh file, of the length unit, of the orderings and of the
+region names of the settings, since the elements kept and their region index depend on them. Numbers
+are in the native byte order, the cache is not meant to be moved to another machine.
+*/
+
+using namespace Mesh;
+
+namespace
+    {
+/** magic bytes at the beginning of the cache */
+constexpr char magic[8] = "FLGMSHC";
+
+/** version of the cache format, to increment on any change of the layout or of the preprocessing */
+constexpr uint32_t cacheVersion = 1;
+
+/** FNV-1a like hash, fed by 64 bits words */
+class hasher
+    {
+public:
+    /** adds the bytes [data, data + size) */
+    void add(const void *data, const size_t size)
+        {
+        const char *p = static_cast<const char *>(data);
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+            {
+            uint64_t w;
+            std::memcpy(&w, p + i, sizeof(w));
+            mix(w);
+            }
+        uint64_t w = 0;
+        if (size > i) std::memcpy(&w, p + i, size - i);
+        mix(w ^ size);
+        }
+
+    /** adds a string */
+    void add(std::string const &s) { add(s.data(), s.size()); }
+
+    /** adds a number */
+    template<class T>
+    void add(const T x) { add(&x, sizeof(x)); }
+
+    /** resulting key */
+    uint64_t value(void) const { return h; }
+
+private:
+    uint64_t h = 0xcbf29ce484222325ULL; /**< current value */
+
+    /** mixes a word in the hash */
+    void mix(const uint64_t w)
+        {
+        h ^= w;
+        h *= 0x100000001b3ULL;
+        h ^= h >> 29;
+        }
+    };
+
+/** \class mapping
+read only memory mapping of a whole file, empty if the file cannot be mapped */
+class mapping
+    {
+public:
+    /** constructor, maps the file */
+    explicit mapping(std::string const &fileName)
+        {
+        const int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+                {
+                data = static_cast<const char *>(p);
+                size = st.st_size;
+                madvise(p, size, MADV_SEQUENTIAL);
+                }
+            }
+        close(fd);
+        }
+
+    /** destructor, unmaps the file */
+    ~mapping()
+        {
+        if (data != nullptr) munmap(const_cast<char *>(data), size);
+        }
+
+    const char *data = nullptr; /**< first byte */
+    size_t size = 0;            /**< size of the file in bytes */
+    };
+
+/** \class reader
+sequential reading of the cache, all the reads fail after the first one past the end */
+class reader
+    {
+public:
+    /** constructor */
+    reader(const char *b, const char *e) : cur(b), end(e) {}
+
+    /** copies n objects to x, returns false past the end */
+    template<class T>
+    bool get(T *x, const size_t n = 1)
+        {
+        const size_t bytes = n * sizeof(T);
+        if (!ok || (size_t)(end - cur) < bytes)
+            {
+            ok = false;
+            return false;
+            }
+        std::memcpy(static_cast<void *>(x), cur, bytes);
+        cur += bytes;
+        return true;
+        }
+
+    /** reads a string */
+    bool get(std::string &s)
+        {
+        uint32_t n = 0;
+        if (!get(&n) || !fits(n, 1))
+            {
+            ok = false;
+            return false;
+            }
+        s.resize(n);
+        return get(s.data(), n);
+        }
+
+    /** true if n objects of the given size in bytes are left to read, to check the counts read
+     * from the cache before allocating from them */
+    bool fits(const int64_t n, const size_t bytes) const
+        { return ok && n >= 0 && (uint64_t)n <= left() / bytes; }
+
+    /** number of bytes left to read */
+    size_t left(void) const { return end - cur; }
+
+    /** true if all the reads succeeded and the whole cache was read */
+    bool complete(void) const { return ok && cur == end; }
+
+    bool ok = true; /**< false after a read past the end */
+
+private:
+    const char *cur; /**< next byte to read */
+    const char *end; /**< end of the cache */
+    };
+
+/** \class writer
+sequential writing of the cache */
+class writer
+    {
+public:
+    /** constructor */
+    explicit writer(std::ofstream &f) : out(f) {}
+
+    /** writes n objects */
+    template<class T>
+    void put(const T *x, const size_t n = 1)
+        { out.write(reinterpret_cast<const char *>(x), n * sizeof(T)); }
+
+    /** writes a string */
+    void put(std::string const &s)
+        {
+        const uint32_t n = s.size();
+        put(&n);
+        put(s.data(), n);
+        }
+
+private:
+    std::ofstream &out; /**< cache file */
+    };
+
+/** writes a map of region names */
+void putNames(writer &w, std::map<int, std::string> const &names)
+    {
+    const int64_t n = names.size();
+    w.put(&n);
+    for (auto const &[tag, name] : names)
+        {
+        const int32_t t = tag;
+        w.put(&t);
+        w.put(name);
+        }
+    }
+
+/** reads a map of region names */
+bool getNames(reader &r, std::map<int, std::string> &names)
+    {
+    int64_t n = 0;
+    if (!r.get(&n) || n < 0) return false;
+    for (int64_t i = 0; i < n; i++)
+        {
+        int32_t t;
+        std::string name;
+        if (!r.get(&t) || !r.get(name)) return false;
+        names[t] = name;
+        }
+    return true;
+    }
+
+    }  // namespace
+
+uint64_t mesh::cacheKey(Settings const &mySets)
+    {
+    hasher h;
+    h.add(cacheVersion);
+    mapping file(mySets.getPbName());
+    h.add(file.data, file.size);
+    h.add(mySets.getScale());
+    for (Tetra::prm const &p : mySets.paramTetra)
+        { h.add(p.regName); }
+    h.add(mySets.paramTetra.size());
+    for (Facette::prm const &p : mySets.paramFacette)
+        { h.add(p.regName); }
+    h.add(mySets.paramFacette.size());
+    h.add(mySets.nodeOrdering);
+    h.add(mySets.sortTetrahedrons);
+    return h.value();
+    }
+
+bool mesh::readCache(Settings const &mySets, std::string const &fileName, const uint64_t key)
+    {
+    mapping file(fileName);
+    if (file.data == nullptr) return false;
+    reader r(file.data, file.data + file.size);
+
+    char m[sizeof(magic)];
+    uint32_t version;
+    uint64_t k;
+    if (!r.get(m, sizeof(magic)) || std::memcmp(m, magic, sizeof(magic)) != 0 || !r.get(&version)
+        || version != cacheVersion || !r.get(&k) || k != key)
+        {
+        if (mySets.verbose)
+            {
+            std::cout << "mesh cache " << fileName << " missing or out of date\n";
+            }
+        return false;
+        }
+
+    // a truncated or corrupted cache leaves the mesh empty, to be read from the mesh file
+    auto fail = [this]()
+    {
+        node.resize(0);
+        node_index.clear();
+        tet.clear();
+        tetGeom.clear();
+        fac.clear();
+        facAdjacent.clear();
+        s.clear();
+        surfRegNames.clear();
+        volRegNames.clear();
+        std::cerr << "warning: the mesh cache is corrupted\n";
+        return false;
+    };
+
+    int64_t nbNodes, nbTets, nbFacs, nbSurfs;
+    r.get(&nbNodes);
+    r.get(&nbTets);
+    r.get(&nbFacs);
+    r.get(&nbSurfs);
+    r.get(l.data(), 3);
+    r.get(c.data(), 3);
+    r.get(&diam);
+
+    // the arrays of the nodes and of the elements must fit in the rest of the cache
+    const size_t nodeBytes = 3 * sizeof(double) + sizeof(int);
+    const size_t tetBytes = 5 * sizeof(int32_t) + (Tetra::N * Nodes::DIM + 1) * sizeof(double);
+    const size_t facBytes = 5 * sizeof(int32_t);
+    if (!r.fits(nbNodes, nodeBytes) || !r.fits(nbTets, tetBytes) || !r.fits(nbFacs, facBytes) || nbSurfs < 0
+        || nbNodes * nodeBytes + nbTets * tetBytes + nbFacs * facBytes > r.left())
+        return fail();
+
+    init_node(nbNodes);
+    node_index.resize(nbNodes);
+    std::vector<double> p(3 * nbNodes);
+    r.get(p.data(), p.size());
+    for (int i = 0; i < nbNodes; i++)
+        { node.p[i] = Eigen::Vector3d(p[3 * i], p[3 * i + 1], p[3 * i + 2]); }
+    r.get(node_index.data(), nbNodes);
+
+    std::vector<int32_t> t(5 * nbTets);
+    r.get(t.data(), t.size());
+    tetGeom.resize(nbTets);
+    for (Tetra::geometry &g : tetGeom)
+        {
+        r.get(g.da.data(), Tetra::N * Nodes::DIM);
+        r.get(&g.detJ);
+        }
+
+    std::vector<int32_t> f(5 * nbFacs);
+    r.get(f.data(), f.size());
+    if (!r.ok) return fail();
+
+    // the indices of the nodes, of the regions and of the tetrahedrons must be in range
+    auto inRange = [](const int64_t x, const int64_t n) { return x >= 0 && x < n; };
+    const int64_t nbVolRegs = mySets.paramTetra.size();
+    const int64_t nbSurfRegs = mySets.paramFacette.size();
+    bool valid = true;
+    for (int i = 0; i < nbNodes; i++)
+        { valid &= inRange(node_index[i], nbNodes); }
+    for (int i = 0; i < nbTets; i++)
+        {
+        const int32_t *e = &t[5 * i];
+        valid &= inRange(e[0], nbVolRegs) && inRange(e[1], nbNodes) && inRange(e[2], nbNodes)
+                 && inRange(e[3], nbNodes) && inRange(e[4], nbNodes);
+        }
+    for (int i = 0; i < nbFacs; i++)
+        {
+        const int32_t *e = &f[5 * i];
+        valid &= inRange(e[0], nbSurfRegs) && inRange(e[1], nbNodes) && inRange(e[2], nbNodes)
+                 && inRange(e[3], nbNodes) && std::abs((int64_t)e[4]) <= nbTets;
+        }
+    if (!valid) return fail();
+
+    tet.clear();
+    tet.reserve(nbTets);
+    for (int i = 0; i < nbTets; i++)
+        {
+        const int32_t *e = &t[5 * i];
+        tet.push_back(Tetra::Tet(node, tetGeom, e[0], {e[1], e[2], e[3], e[4]}, i));
+        tet.back().idx = i;
+        }
+
+    fac.clear();
+    fac.reserve(nbFacs);
+    facAdjacent.resize(nbFacs);
+    for (int i = 0; i < nbFacs; i++)
+        {
+        const int32_t *e = &f[5 * i];
+        fac.push_back(Facette::Fac(node, nbNodes, e[0], {e[1] + 1, e[2] + 1, e[3] + 1}));
+        facAdjacent[i] = e[4];
+        }
+
+    if (!getNames(r, surfRegNames) || !getNames(r, volRegNames)) return fail();
+    s.clear();
+    for (int64_t i = 0; i < nbSurfs; i++)
+        {
+        std::string name;
+        int64_t nbTri = 0;
+        if (!r.get(name) || !r.get(&nbTri) || !r.fits(nbTri, 3 * sizeof(int32_t))) return fail();
+        std::vector<int32_t> ind(3 * nbTri);
+        if (!r.get(ind.data(), ind.size())
+            || !std::all_of(ind.begin(), ind.end(), [nbNodes](const int32_t k) { return k >= 0 && k < nbNodes; }))
+            return fail();
+        Mesh::Surf surface(node, name);
+        surface.elem.reserve(nbTri);
+        for (int j = 0; j < nbTri; j++)
+            {
+            surface.push_back(Mesh::Triangle(node, ind[3 * j] + 1, ind[3 * j + 1] + 1, ind[3 * j + 2] + 1));
+            }
+        s.push_back(surface);
+        }
+    return r.complete() || fail();
+    }
+
+void mesh::writeCache(Settings const &mySets, std::string const &fileName, const uint64_t key) const
+    {
+    // a temporary file of its own for each process, as several runs may start on the same mesh
+    std::ostringstream ss;
+    ss << fileName << '.' << getpid() << '.' << std::hex << std::random_device()() << ".tmp";
+    const std::string tmpName = ss.str();
+    std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+    writer w(out);
+
+    w.put(magic, sizeof(magic));
+    w.put(&cacheVersion);
+    w.put(&key);
+    const int64_t nbNodes = node.size(), nbTets = tet.size(), nbFacs = fac.size(), nbSurfs = s.size();
+    w.put(&nbNodes);
+    w.put(&nbTets);
+    w.put(&nbFacs);
+    w.put(&nbSurfs);
+    w.put(l.data(), 3);
+    w.put(c.data(), 3);
+    w.put(&diam);
+
+    std::vector<double> p(3 * nbNodes);
+    for (int i = 0; i < nbNodes; i++)
+        {
+        p[3 * i] = node.p[i].x();
+        p[3 * i + 1] = node.p[i].y();
+        p[3 * i + 2] = node.p[i].z();
+        }
+    w.put(p.data(), p.size());
+    const std::vector<int32_t> idx(node_index.begin(), node_index.end());
+    w.put(idx.data(), idx.size());
+
+    std::vector<int32_t> t;
+    t.reserve(5 * nbTets);
+    for (Tetra::Tet const &te : tet)
+        { t.insert(t.end(), {te.idxPrm, te.ind[0], te.ind[1], te.ind[2], te.ind[3]}); }
+    w.put(t.data(), t.size());
+    for (Tetra::geometry const &g : tetGeom)
+        {
+        w.put(g.da.data(), Tetra::N * Nodes::DIM);
+        w.put(&g.detJ);
+        }
+
+    std::vector<int32_t> f;
+    f.reserve(5 * nbFacs);
+    for (int i = 0; i < nbFacs; i++)
+        {
+        Facette::Fac const &fa = fac[i];
+        f.insert(f.end(), {fa.idxPrm, fa.ind[0], fa.ind[1], fa.ind[2], facAdjacent[i]});
+        }
+    w.put(f.data(), f.size());
+
+    putNames(w, surfRegNames);
+    putNames(w, volRegNames);
+    for (Mesh::Surf const &surface : s)
+        {
+        w.put(surface.getName());
+        const int64_t nbTri = surface.elem.size();
+        w.put(&nbTri);
+        for (Mesh::Triangle const &tri : surface.elem)
+            { w.put(tri.ind, 3); }
+        }
+    out.close();
+
+    std::error_code ec;
+    if (!out)
+        ec = std::make_error_code(std::errc::io_error);
+    else
+        std::filesystem::rename(tmpName, fileName, ec);
+    if (ec)
+        {
+        std::filesystem::remove(tmpName, ec);
+        std::cerr << "warning: the mesh cache " << fileName << " could not be written\n";
+        }
+    else if (mySets.verbose)
+        {
+        std::cout << "  mesh cache written to " << fileName << '\n';
+        }
+    }
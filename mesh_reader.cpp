@@ -0,0 +1,604 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <execution>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "mesh_reader.h"
+#include "tags.h"
+
+using namespace Mesh::Gmsh;
+
+namespace
+    {
+/** size of the chunks of lines parsed in parallel, in bytes */
+constexpr size_t chunkSize = 1 << 20;
+
+/** node tags up to this ratio times the number of nodes are converted with a table indexed by the
+ * tags, larger ones with a sorted table of the tags */
+constexpr long maxTagRatio = 4;
+
+/** prints the error message and exits */
+[[noreturn]] void fail(std::string const &what)
+    {
+    std::cerr << "mesh reading error: " << what << std::endl;
+    SYSTEM_ERROR;
+    }
+
+/** number of nodes of the elements of gmsh type typ, 0 if unknown */
+int nodesOfType(const int typ)
+    {
+    static const int nb[] = {0, 2, 3, 4, 4, 8, 6, 5, 3, 6, 9, 10, 27, 18, 14, 1, 8, 20, 15, 13};
+    return (typ > 0 && typ < (int)std::size(nb)) ? nb[typ] : 0;
+    }
+
+/** \class cursor
+reads the tokens of a text, or the values of binary data, from the current position
+*/
+class cursor
+    {
+public:
+    /** constructor */
+    cursor(const char *b, const char *e) : pos(b), end(e) {}
+
+    const char *pos; /**< current position */
+    const char *end; /**< end of the text */
+    bool ok = true;  /**< false after a failed read */
+
+    /** skips the blanks and the end of lines */
+    void skipSpaces(void)
+        {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n'))
+            { pos++; }
+        }
+
+    /** skips the rest of the current line, and its end */
+    void skipLine(void)
+        {
+        pos = std::find(pos, end, '\n');
+        if (pos < end) pos++;
+        }
+
+    /** reads the next number of the text */
+    template<class T>
+    T next(void)
+        {
+        T x = T();
+        skipSpaces();
+        auto [p, ec] = std::from_chars(pos, end, x);
+        if (ec != std::errc())
+            { ok = false; }
+        pos = p;
+        return x;
+        }
+
+    /** reads the next token of the text, a double quoted token may hold blanks */
+    std::string_view word(void)
+        {
+        skipSpaces();
+        const char *first = pos;
+        if (pos < end && *pos == '"')
+            {
+            pos = std::find(pos + 1, end, '"');
+            if (pos < end) pos++;
+            }
+        else
+            {
+            while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n')
+                { pos++; }
+            }
+        return std::string_view(first, pos - first);
+        }
+
+    /** reads the next value of binary data */
+    template<class T>
+    T raw(void)
+        {
+        T x = T();
+        if (end - pos < (long)sizeof(T))
+            {
+            ok = false;
+            return x;
+            }
+        std::memcpy(&x, pos, sizeof(T));
+        pos += sizeof(T);
+        return x;
+        }
+    };
+
+/** returns the position of the line starting with tag after pos, or end */
+const char *findLine(const char *pos, const char *end, std::string_view tag)
+    {
+    std::string_view text(pos, end - pos);
+    for (size_t i = text.find(tag); i != std::string_view::npos; i = text.find(tag, i + 1))
+        {
+        const size_t after = i + tag.size();
+        if ((i == 0 || text[i - 1] == '\n')
+            && (after == text.size() || text[after] == '\r' || text[after] == '\n'))
+            return pos + i;
+        }
+    return end;
+    }
+
+/** splits [begin, end) in chunks of whole lines, of about chunkSize bytes */
+std::vector<std::pair<const char *, const char *>> chunks(const char *begin, const char *end)
+    {
+    std::vector<std::pair<const char *, const char *>> c;
+    while (begin < end)
+        {
+        const char *last = (size_t(end - begin) > chunkSize) ? begin + chunkSize : end;
+        last = std::find(last, end, '\n');
+        if (last < end) last++;
+        c.emplace_back(begin, last);
+        begin = last;
+        }
+    return c;
+    }
+
+/** \struct nodeChunk
+nodes of a chunk of lines */
+struct nodeChunk
+    {
+    std::vector<long> tags;               /**< tags of the nodes */
+    std::vector<Eigen::Vector3d> nodes;   /**< positions of the nodes */
+    bool ok = true;                       /**< false if the chunk could not be parsed */
+    };
+
+/** \struct elementChunk
+elements of a chunk of lines */
+struct elementChunk
+    {
+    std::vector<element> triangles;    /**< triangles, node tags not yet converted */
+    std::vector<element> tetrahedrons; /**< tetrahedrons, node tags not yet converted */
+    long nbElements = 0;               /**< number of elements */
+    long nbUnknown = 0;                /**< number of elements of other types */
+    bool ok = true;                    /**< false if the chunk could not be parsed */
+    };
+
+/** \class parser
+sections of a gmsh file, the sections are parsed in the order of the file
+*/
+class parser
+    {
+public:
+    /** constructor */
+    parser(const char *b, const char *e) : begin(b), end(e) {}
+
+    /** parses the whole file */
+    contents run(void)
+        {
+        const char *pos = begin;
+        while ((pos = findSection(pos)) < end)
+            {
+            cursor c(pos, end);
+            const std::string tag(c.word());
+            c.skipLine();
+            if (tag == tags::msh::format)
+                { pos = meshFormat(c); }
+            else if (tag == tags::msh::begin_physical_names)
+                { pos = physicalNames(c); }
+            else if (tag == tags::msh::begin_entities)
+                { pos = entities(c); }
+            else if (tag == tags::msh::begin_nodes)
+                { pos = (version == tags::msh::version) ? nodes22(c) : nodes41(c); }
+            else if (tag == tags::msh::begin_elements)
+                { pos = (version == tags::msh::version) ? elements22(c) : elements41(c); }
+            else
+                { pos = c.pos; }  // unused section, its end is skipped as any line
+            }
+        if (f.version.empty()) fail("no " + tags::msh::format + " section.");
+        if (!withNodes) fail("could not find tag " + tags::msh::begin_nodes);
+        if (!withElements) fail("could not find tag " + tags::msh::begin_elements);
+        toPositions(f.triangles, 3);
+        toPositions(f.tetrahedrons, 4);
+        return std::move(f);
+        }
+
+private:
+    const char *begin; /**< begin of the file */
+    const char *end;   /**< end of the file */
+    contents f;        /**< contents read so far */
+    std::string version; /**< version of the format */
+    bool withNodes = false;    /**< true once the nodes are read */
+    bool withElements = false; /**< true once the elements are read */
+    std::vector<long> nodeTags;  /**< tags of the nodes, in the order of f.nodes */
+
+    /** first physical tag of the entities of each dimension of the format 4.1, by entity tag */
+    std::map<int, int> physicalOf[4];
+
+    /** returns the next line starting with a $ from pos, skipping the lines starting with $End */
+    const char *findSection(const char *pos) const
+        {
+        while (pos < end)
+            {
+            if (*pos == '$' && std::string_view(pos, std::min<long>(4, end - pos)) != "$End")
+                return pos;
+            pos = std::find(pos, end, '\n');
+            if (pos < end) pos++;
+            }
+        return end;
+        }
+
+    /** returns the position after the line endTag, from c */
+    const char *after(cursor &c, std::string_view endTag) const
+        {
+        cursor e(findLine(c.pos, end, endTag), end);
+        if (e.pos == end) fail("could not find tag " + std::string(endTag));
+        e.skipLine();
+        return e.pos;
+        }
+
+    /** $MeshFormat: version, binary or text, size of the binary data */
+    const char *meshFormat(cursor &c)
+        {
+        version = std::string(c.word());
+        const int fileType = c.next<int>();
+        const int dataSize = c.next<int>();
+        if (version != tags::msh::version && version != tags::msh::version41)
+            {
+            std::cout << "mesh file format " << version << " not supported." << std::endl;
+            SYSTEM_ERROR;
+            }
+        f.version = version;
+        f.binary = (fileType == 1);
+        if (f.binary)
+            {
+            if (version != tags::msh::version41) fail("binary format is only supported in version 4.1.");
+            if (dataSize != sizeof(size_t)) fail("binary data size should be " + std::to_string(sizeof(size_t)));
+            c.skipLine();
+            if (c.raw<int>() != 1) fail("binary file of another endianness.");
+            }
+        if (!c.ok) fail("error while reading " + tags::msh::format);
+        return after(c, tags::msh::end_format);
+        }
+
+    /** $PhysicalNames: names of the surfaces and of the volumes */
+    const char *physicalNames(cursor &c)
+        {
+        const int nbRegNames = c.next<int>();
+        for (int i = 0; i < nbRegNames && c.ok; i++)
+            {
+            const int dim = c.next<int>();
+            const int tag = c.next<int>();
+            const std::string_view quoted = c.word();
+            if (quoted.size() < 2 || quoted.front() != '"' || quoted.back() != '"')
+                fail("error while reading " + tags::msh::begin_physical_names + ": names should be double quoted");
+            const std::string name(quoted.substr(1, quoted.size() - 2));
+            switch (dim)
+                {
+                case tags::msh::DIM_OBJ_2D: f.surfRegNames[tag] = name; break;
+                case tags::msh::DIM_OBJ_3D: f.volRegNames[tag] = name; break;
+                default:
+                    std::cerr << "unknown type in mesh " << tags::msh::begin_physical_names << std::endl;
+                    break;
+                }
+            }
+        if (!c.ok) fail("error while reading " + tags::msh::begin_physical_names);
+        f.withPhysicalNames = true;
+        return after(c, tags::msh::end_physical_names);
+        }
+
+    /** $Entities of the format 4.1: physical tags of the entities */
+    const char *entities(cursor &c)
+        {
+        size_t nb[4];
+        for (size_t &n : nb)
+            { n = f.binary ? c.raw<size_t>() : c.next<size_t>(); }
+        for (int dim = 0; dim < 4; dim++)
+            for (size_t k = 0; k < nb[dim] && c.ok; k++)
+                {
+                const int tag = f.binary ? c.raw<int>() : c.next<int>();
+                for (int i = 0; i < ((dim == 0) ? 3 : 6); i++)
+                    { f.binary ? c.raw<double>() : c.next<double>(); }
+                const size_t nbPhysical = f.binary ? c.raw<size_t>() : c.next<size_t>();
+                for (size_t i = 0; i < nbPhysical; i++)
+                    {
+                    const int physical = f.binary ? c.raw<int>() : c.next<int>();
+                    if (i == 0) physicalOf[dim][tag] = physical;
+                    }
+                if (dim > 0)
+                    {
+                    const size_t nbBounding = f.binary ? c.raw<size_t>() : c.next<size_t>();
+                    for (size_t i = 0; i < nbBounding; i++)
+                        { f.binary ? c.raw<int>() : c.next<int>(); }
+                    }
+                }
+        if (!c.ok) fail("error while reading " + tags::msh::begin_entities);
+        return after(c, tags::msh::end_entities);
+        }
+
+    /** $Nodes of the format 2.2, one node per line, parsed by chunks in parallel */
+    const char *nodes22(cursor &c)
+        {
+        const long nbNod = c.next<long>();
+        c.skipLine();
+        const char *last = findLine(c.pos, end, tags::msh::end_nodes);
+        std::vector<std::pair<const char *, const char *>> parts = chunks(c.pos, last);
+        std::vector<nodeChunk> parsed(parts.size());
+        std::for_each(std::execution::par, parts.begin(), parts.end(),
+                      [&parts, &parsed](std::pair<const char *, const char *> const &part)
+                          {
+                          nodeChunk &n = parsed[&part - parts.data()];
+                          cursor l(part.first, part.second);
+                          for (l.skipSpaces(); l.pos < l.end && l.ok; l.skipSpaces())
+                              {
+                              n.tags.push_back(l.next<long>());
+                              const double x = l.next<double>();
+                              const double y = l.next<double>();
+                              const double z = l.next<double>();
+                              n.nodes.emplace_back(x, y, z);
+                              }
+                          n.ok = l.ok;
+                          });
+        for (nodeChunk const &n : parsed)
+            {
+            if (!n.ok) fail("error while reading nodes");
+            nodeTags.insert(nodeTags.end(), n.tags.begin(), n.tags.end());
+            f.nodes.insert(f.nodes.end(), n.nodes.begin(), n.nodes.end());
+            }
+        if ((long)f.nodes.size() != nbNod) fail("error while reading nodes: wrong number of nodes");
+        withNodes = true;
+        c.pos = last;
+        return after(c, tags::msh::end_nodes);
+        }
+
+    /** $Elements of the format 2.2, one element per line, parsed by chunks in parallel */
+    const char *elements22(cursor &c)
+        {
+        const long nbElem = c.next<long>();
+        c.skipLine();
+        const char *last = findLine(c.pos, end, tags::msh::end_elements);
+        std::vector<std::pair<const char *, const char *>> parts = chunks(c.pos, last);
+        std::vector<elementChunk> parsed(parts.size());
+        std::for_each(std::execution::par, parts.begin(), parts.end(),
+                      [&parts, &parsed](std::pair<const char *, const char *> const &part)
+                          {
+                          elementChunk &e = parsed[&part - parts.data()];
+                          cursor l(part.first, part.second);
+                          for (l.skipSpaces(); l.pos < l.end && l.ok; l.skipSpaces())
+                              {
+                              l.next<long>();
+                              const int typ = l.next<int>();
+                              const int nbTags = l.next<int>();
+                              element elem = {0, {0, 0, 0, 0}};
+                              for (int i = 0; i < nbTags; i++)
+                                  {
+                                  const int t = l.next<int>();
+                                  if (i == 0) elem.reg = t;
+                                  }
+                              e.nbElements++;
+                              if (typ == tags::msh::TYP_ELEM_TRIANGLE || typ == tags::msh::TYP_ELEM_TETRAEDRON)
+                                  {
+                                  const int nb = nodesOfType(typ);
+                                  for (int i = 0; i < nb; i++)
+                                      { elem.ind[i] = l.next<int>(); }
+                                  (typ == tags::msh::TYP_ELEM_TRIANGLE ? e.triangles : e.tetrahedrons).push_back(elem);
+                                  }
+                              else
+                                  { e.nbUnknown++; }
+                              l.skipLine();
+                              }
+                          e.ok = l.ok;
+                          });
+        for (elementChunk const &e : parsed)
+            {
+            if (!e.ok) fail("error while reading elements");
+            f.triangles.insert(f.triangles.end(), e.triangles.begin(), e.triangles.end());
+            f.tetrahedrons.insert(f.tetrahedrons.end(), e.tetrahedrons.begin(), e.tetrahedrons.end());
+            f.nbElements += e.nbElements;
+            f.nbUnknown += e.nbUnknown;
+            }
+        if (f.nbElements != nbElem) fail("error while reading elements: wrong number of elements");
+        withElements = true;
+        c.pos = last;
+        return after(c, tags::msh::end_elements);
+        }
+
+    /** $Nodes of the format 4.1, by blocks of nodes of the same entity */
+    const char *nodes41(cursor &c)
+        {
+        auto index = [this, &c]() { return f.binary ? c.raw<size_t>() : c.next<size_t>(); };
+        const size_t nbBlocks = index();
+        const size_t nbNod = index();
+        index();  // min node tag
+        index();  // max node tag
+        f.nodes.reserve(nbNod);
+        nodeTags.reserve(nbNod);
+        for (size_t b = 0; b < nbBlocks && c.ok; b++)
+            {
+            const int dim = f.binary ? c.raw<int>() : c.next<int>();
+            f.binary ? c.raw<int>() : c.next<int>();  // entity tag
+            const int parametric = f.binary ? c.raw<int>() : c.next<int>();
+            const size_t nb = index();
+            const int nbCoords = 3 + (parametric ? std::clamp(dim, 0, 3) : 0);
+            for (size_t i = 0; i < nb; i++)
+                { nodeTags.push_back(index()); }
+            for (size_t i = 0; i < nb; i++)
+                {
+                double x[6];
+                for (int k = 0; k < nbCoords; k++)
+                    { x[k] = f.binary ? c.raw<double>() : c.next<double>(); }
+                f.nodes.emplace_back(x[0], x[1], x[2]);
+                }
+            }
+        if (!c.ok || f.nodes.size() != nbNod) fail("error while reading nodes");
+        withNodes = true;
+        return after(c, tags::msh::end_nodes);
+        }
+
+    /** $Elements of the format 4.1, by blocks of elements of the same type and entity */
+    const char *elements41(cursor &c)
+        {
+        auto index = [this, &c]() { return f.binary ? c.raw<size_t>() : c.next<size_t>(); };
+        const size_t nbBlocks = index();
+        f.nbElements = index();
+        index();  // min element tag
+        index();  // max element tag
+        for (size_t b = 0; b < nbBlocks && c.ok; b++)
+            {
+            const int dim = f.binary ? c.raw<int>() : c.next<int>();
+            const int entity = f.binary ? c.raw<int>() : c.next<int>();
+            const int typ = f.binary ? c.raw<int>() : c.next<int>();
+            const size_t nb = index();
+            const int nbNodes = nodesOfType(typ);
+            if (nbNodes == 0) fail("unknown element type " + std::to_string(typ));
+            const bool known = (typ == tags::msh::TYP_ELEM_TRIANGLE || typ == tags::msh::TYP_ELEM_TETRAEDRON);
+            std::vector<element> &dest = (typ == tags::msh::TYP_ELEM_TRIANGLE) ? f.triangles : f.tetrahedrons;
+            element elem = {0, {0, 0, 0, 0}};
+            if (dim >= 0 && dim < 4)
+                if (auto it = physicalOf[dim].find(entity); it != physicalOf[dim].end()) elem.reg = it->second;
+            if (!known)
+                {
+                f.nbUnknown += nb;
+                if (f.binary)
+                    { c.pos += std::min<size_t>(nb * (1 + nbNodes) * sizeof(size_t), c.end - c.pos); }
+                else
+                    {
+                    for (size_t i = 0; i < nb; i++)
+                        {
+                        c.skipSpaces();
+                        c.skipLine();
+                        }
+                    }
+                continue;
+                }
+            for (size_t i = 0; i < nb; i++)
+                {
+                index();  // element tag
+                for (int k = 0; k < nbNodes; k++)
+                    {
+                    const size_t tag = index();
+                    if (tag > (size_t)std::numeric_limits<int>::max())
+                        fail("node tag " + std::to_string(tag) + " of an element is larger than "
+                             + std::to_string(std::numeric_limits<int>::max()));
+                    elem.ind[k] = tag;
+                    }
+                dest.push_back(elem);
+                }
+            }
+        if (!c.ok || (long)(f.triangles.size() + f.tetrahedrons.size()) + f.nbUnknown != f.nbElements)
+            fail("error while reading elements");
+        withElements = true;
+        return after(c, tags::msh::end_elements);
+        }
+
+    /** converts the node tags of the elements into one based positions in f.nodes */
+    void toPositions(std::vector<element> &elems, const int nbNodes) const
+        {
+        bool identity = true;
+        for (size_t i = 0; i < nodeTags.size() && identity; i++)
+            { identity = (nodeTags[i] == (long)i + 1); }
+        const int NOD = nodeTags.size();
+        if (identity)
+            {
+            for (element const &e : elems)
+                for (int k = 0; k < nbNodes; k++)
+                    if (e.ind[k] < 1 || e.ind[k] > NOD) fail("element with an unknown node tag");
+            return;
+            }
+
+        for (int i = 0; i < NOD; i++)
+            if (nodeTags[i] < 1) fail("node with tag " + std::to_string(nodeTags[i]));
+        const long maxTag = nodeTags.empty() ? 0 : *std::max_element(nodeTags.begin(), nodeTags.end());
+        if (maxTag <= maxTagRatio * (long)NOD)
+            {
+            std::vector<int> position(maxTag + 1, 0);
+            for (int i = 0; i < NOD; i++)
+                { position[nodeTags[i]] = i + 1; }
+            std::for_each(std::execution::par, elems.begin(), elems.end(),
+                          [&position, maxTag, nbNodes](element &e)
+                              {
+                              for (int k = 0; k < nbNodes; k++)
+                                  { e.ind[k] = (e.ind[k] >= 1 && e.ind[k] <= maxTag) ? position[e.ind[k]] : 0; }
+                              });
+            }
+        else
+            {  // sparse tags: sorted table of the pairs (tag, position), its size is the number of nodes
+            std::vector<std::pair<long, int>> position(NOD);
+            for (int i = 0; i < NOD; i++)
+                { position[i] = {nodeTags[i], i + 1}; }
+            std::sort(std::execution::par, position.begin(), position.end());
+            std::for_each(std::execution::par, elems.begin(), elems.end(),
+                          [&position, nbNodes](element &e)
+                              {
+                              for (int k = 0; k < nbNodes; k++)
+                                  {
+                                  auto it = std::lower_bound(position.begin(), position.end(),
+                                                             std::make_pair((long)e.ind[k], 0));
+                                  e.ind[k] = (it != position.end() && it->first == e.ind[k]) ? it->second : 0;
+                                  }
+                              });
+            }
+        for (element const &e : elems)
+            for (int k = 0; k < nbNodes; k++)
+                if (e.ind[k] == 0) fail("element with an unknown node tag");
+        }
+    };
+
+/** \class mappedFile
+read only memory mapping of a whole file */
+class mappedFile
+    {
+public:
+    /** constructor, maps the file, exits on error */
+    explicit mappedFile(std::string const &fileName)
+        {
+        const int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            {
+            std::cerr << "cannot open file " << fileName << ": " << strerror(errno) << std::endl;
+            SYSTEM_ERROR;
+            }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+            size = st.st_size;
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+        close(fd);
+        if (data == MAP_FAILED || data == nullptr)
+            {
+            std::cerr << "cannot map file " << fileName << ": " << strerror(errno) << std::endl;
+            SYSTEM_ERROR;
+            }
+        madvise(data, size, MADV_SEQUENTIAL);
+        madvise(data, size, MADV_WILLNEED);
+        }
+
+    /** destructor, unmaps the file */
+    ~mappedFile()
+        { munmap(data, size); }
+
+    /** first byte */
+    const char *begin(void) const { return static_cast<const char *>(data); }
+
+    /** end of the file */
+    const char *end(void) const { return begin() + size; }
+
+private:
+    void *data = nullptr; /**< mapping */
+    size_t size = 0;      /**< size of the file in bytes */
+    };
+
+    }  // namespace
+
+contents Mesh::Gmsh::parse(const char *begin, const char *end)
+    {
+    parser p(begin, end);
+    return p.run();
+    }
+
+contents Mesh::Gmsh::read(std::string const &fileName)
+    {
+    mappedFile file(fileName);
+    return parse(file.begin(), file.end());
+    }
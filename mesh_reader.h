@@ -0,0 +1,59 @@
+#ifndef mesh_reader_h
+#define mesh_reader_h
+
+/** \file mesh_reader.h
+\brief reader of the gmsh mesh files, in format 2.2 text and 4.1 text or binary. The file is mapped
+in memory, the numbers are parsed with std::from_chars, and the nodes and the elements of the format
+2.2 are parsed by chunks of lines in parallel. The result is the raw content of the file, the
+elements are built from it by Mesh::mesh.
+*/
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+
+namespace Mesh
+    {
+/** \namespace Gmsh
+parsing of the gmsh files
+*/
+namespace Gmsh
+    {
+/** \struct element
+triangle or tetrahedron of the file
+*/
+struct element
+    {
+    int reg;    /**< physical tag of the region */
+    int ind[4]; /**< indices of the nodes, one based positions in contents::nodes */
+    };
+
+/** \struct contents
+what feeLLGood uses of a gmsh file
+*/
+struct contents
+    {
+    std::string version;                  /**< version of the format, 2.2 or 4.1 */
+    bool binary = false;                  /**< true for the binary format */
+    bool withPhysicalNames = false;       /**< true if the file has a $PhysicalNames section */
+    std::map<int, std::string> surfRegNames; /**< names of the surface regions, by physical tag */
+    std::map<int, std::string> volRegNames;  /**< names of the volume regions, by physical tag */
+    std::vector<Eigen::Vector3d> nodes;   /**< positions of the nodes, in the units of the file */
+    std::vector<element> triangles;       /**< triangles, in the order of the file */
+    std::vector<element> tetrahedrons;    /**< tetrahedrons, in the order of the file */
+    long nbElements = 0;                  /**< number of elements of the file, of all types */
+    long nbUnknown = 0;                   /**< number of elements of other types */
+    };
+
+/** reads the gmsh file fileName, exits on error */
+contents read(std::string const &fileName /**< [in] */);
+
+/** parses the gmsh file mapped in [begin, end), exits on error */
+contents parse(const char *begin /**< [in] */, const char *end /**< [in] */);
+
+    }  // namespace Gmsh
+    }  // namespace Mesh
+
+#endif
@@ -6,7 +6,11 @@
 */
 
 //#include <memory>
+#include <algorithm>
+#include <execution>
 #include <iostream>
+#include <vector>
+
 #include <eigen3/Eigen/Dense>
 #include "config.h"
 
@@ -31,6 +35,53 @@ namespace Nodes
 /** \return \f$ x^2 \f$ */
 inline double sq(const double x) { return x * x; }
 
+/** builds the local basis (ep,eq) orthogonal to u0, rotated by the random angle r */
+inline void setBasis(Eigen::Vector3d const &u0 /**< [in] */, Eigen::Vector3d &ep /**< [out] */,
+                     Eigen::Vector3d &eq /**< [out] */, const double r /**< [in] */)
+    {
+    // Choose for an initial ep the direction, among (X, Y, Z), which is further away from u0.
+    // devNote: Eigen documentation recommends NOT to use ternary operations (see General Topics/common pitfalls)
+    double abs_x = fabs(u0.x()), abs_y = fabs(u0.y()), abs_z = fabs(u0.z());
+    if (abs_x < abs_y)
+        {
+        if (abs_x < abs_z)
+            { ep = Eigen::Vector3d::UnitX(); }
+        else
+            { ep = Eigen::Vector3d::UnitZ(); }
+        }
+    else
+        {
+        if (abs_y < abs_z)
+            { ep = Eigen::Vector3d::UnitY(); }
+        else
+            { ep = Eigen::Vector3d::UnitZ(); }
+        }
+
+    // Gram-Schmidt orthonormalization of (u0, ep).
+    ep -= ep.dot(u0) * u0;
+    ep.normalize();
+
+    // Complete the basis with a vector product.
+    eq = u0.cross(ep);
+
+    // Rotate (ep, eq) by the random angle.
+    Eigen::Vector3d new_ep = cos(r) * ep - sin(r) * eq;
+    eq = sin(r) * ep + cos(r) * eq;
+    ep = new_ep;
+
+    // The basis (u0, ep, eq) should already be orthonormal. An extra orthonormalization could
+    // reduce the rounding errors.
+    if (PARANOID_ORTHONORMALIZATION)
+        {
+        // Modified Gram-Schmidt orthonormalization.
+        ep -= ep.dot(u0) * u0;
+        ep.normalize();
+        eq -= eq.dot(u0) * u0;
+        eq -= eq.dot(ep) * ep;
+        eq.normalize();
+        }
+    }
+
 /** \struct Node
 Node is containing physical point of coordinates \f$ p = (x,y,z) \f$, magnetization value at \f$
 m(p,t) \f$. Many other values for the computation of the scalar potential \f$ \phi \f$
@@ -52,50 +103,7 @@ struct Node
     double phiv;  /**< scalar potential of velocity after the current time step */
 
     /** setter for the local basis vector */
-    inline void setBasis(const double r)
-        {
-        // Choose for an initial ep the direction, among (X, Y, Z), which is further away from u0.
-        // devNote: Eigen documentation recommends NOT to use ternary operations (see General Topics/common pitfalls)
-        double abs_x = fabs(u0.x()), abs_y = fabs(u0.y()), abs_z = fabs(u0.z());
-        if (abs_x < abs_y)
-            {
-            if (abs_x < abs_z)
-                { ep = Eigen::Vector3d::UnitX(); }
-            else
-                { ep = Eigen::Vector3d::UnitZ(); }
-            }
-        else
-            {
-            if (abs_y < abs_z)
-                { ep = Eigen::Vector3d::UnitY(); }
-            else
-                { ep = Eigen::Vector3d::UnitZ(); }
-            }
-
-        // Gram-Schmidt orthonormalization of (u0, ep).
-        ep -= ep.dot(u0) * u0;
-        ep.normalize();
-
-        // Complete the basis with a vector product.
-        eq = u0.cross(ep);
-
-        // Rotate (ep, eq) by the random angle.
-        Eigen::Vector3d new_ep = cos(r) * ep - sin(r) * eq;
-        eq = sin(r) * ep + cos(r) * eq;
-        ep = new_ep;
-
-        // The basis (u0, ep, eq) should already be orthonormal. An extra orthonormalization could
-        // reduce the rounding errors.
-        if (PARANOID_ORTHONORMALIZATION)
-            {
-            // Modified Gram-Schmidt orthonormalization.
-            ep -= ep.dot(u0) * u0;
-            ep.normalize();
-            eq -= eq.dot(u0) * u0;
-            eq -= eq.dot(ep) * ep;
-            eq.normalize();
-            }
-        }
+    inline void setBasis(const double r) { Nodes::setBasis(u0, ep, eq, r); }
 
     /**
     preparation of the quantities u0,v0,phi0,phiv0 for incomming time-step
@@ -167,6 +175,220 @@ inline double get_phi0(Node const &n /**< [in] */) { return n.phi0; }
 /** getter for phiv0 */
 inline double get_phiv0(Node const &n /**< [in] */) { return n.phiv0; }
 
+/** \enum vectorField
+vector valued fields of the nodes, to select at compile time what part of the node is read by get()
+*/
+enum vectorField
+    {
+    VEC_P,  /**< physical position */
+    VEC_U0, /**< magnetization at the start of the current time step */
+    VEC_V0, /**< magnetization speed at the start of the current time step */
+    VEC_U,  /**< magnetization after the current time step */
+    VEC_V,  /**< magnetization speed after the current time step */
+    VEC_EP, /**< first vector of the local basis */
+    VEC_EQ  /**< second vector of the local basis */
+    };
+
+/** \enum scalarField
+scalar fields of the nodes, to select at compile time what part of the node is read by get() or
+written by set()
+*/
+enum scalarField
+    {
+    SCAL_PHI0,  /**< scalar potential at the start of the current time step */
+    SCAL_PHI,   /**< scalar potential after the current time step */
+    SCAL_PHIV0, /**< scalar potential of velocity at the start of the current time step */
+    SCAL_PHIV   /**< scalar potential of velocity after the current time step */
+    };
+
+/** compile time getter for the vector field F, inlined in the element interpolations */
+template<vectorField F>
+inline const Eigen::Vector3d &get(Node const &n /**< [in] */)
+    {
+    if constexpr (F == VEC_P) { return n.p; }
+    else if constexpr (F == VEC_U0) { return n.u0; }
+    else if constexpr (F == VEC_V0) { return n.v0; }
+    else if constexpr (F == VEC_U) { return n.u; }
+    else if constexpr (F == VEC_V) { return n.v; }
+    else if constexpr (F == VEC_EP) { return n.ep; }
+    else { return n.eq; }
+    }
+
+/** compile time getter for the scalar field F */
+template<scalarField F>
+inline double get(Node const &n /**< [in] */)
+    {
+    if constexpr (F == SCAL_PHI0) { return n.phi0; }
+    else if constexpr (F == SCAL_PHI) { return n.phi; }
+    else if constexpr (F == SCAL_PHIV0) { return n.phiv0; }
+    else { return n.phiv; }
+    }
+
+/** compile time setter for the scalar field F */
+template<scalarField F>
+inline void set(Node &n /**< [in|out] */, const double val /**< [in] */)
+    {
+    if constexpr (F == SCAL_PHI0) { n.phi0 = val; }
+    else if constexpr (F == SCAL_PHI) { n.phi = val; }
+    else if constexpr (F == SCAL_PHIV0) { n.phiv0 = val; }
+    else { n.phiv = val; }
+    }
+
+/** \struct Store
+struct of arrays storage of the nodes: each field of Node has its own contiguous array, indexed by
+the node index. The loops on all the nodes stream over the few arrays they need instead of whole
+Node structs, and the elements gather the nodal values with get<F>(i).
+*/
+struct Store
+    {
+    std::vector<Eigen::Vector3d> p;  /**< Physical positions of the nodes */
+    std::vector<Eigen::Vector3d> u0; /**< magnetization at the start of the current time step */
+    std::vector<Eigen::Vector3d> v0; /**< magnetization speed at the start of the current time step */
+    std::vector<Eigen::Vector3d> u;  /**< magnetization after the current time step */
+    std::vector<Eigen::Vector3d> v;  /**< magnetization speed after the current time step */
+    std::vector<Eigen::Vector3d> ep; /**< first vector of the local basis */
+    std::vector<Eigen::Vector3d> eq; /**< second vector of the local basis */
+
+    std::vector<double> phi0;  /**< scalar potential at the start of the current time step */
+    std::vector<double> phi;   /**< scalar potential after the current time step */
+    std::vector<double> phiv0; /**< scalar potential of velocity at the start of the current time step */
+    std::vector<double> phiv;  /**< scalar potential of velocity after the current time step */
+
+    /** empty store */
+    Store() {}
+
+    /** store filled with a copy of a vector of nodes */
+    explicit Store(std::vector<Node> const &nodes /**< [in] */)
+        {
+        resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++)
+            { setNode(i, nodes[i]); }
+        }
+
+    /** number of nodes */
+    inline int size(void) const { return p.size(); }
+
+    /** memory allocation for Nb nodes */
+    void resize(const int Nb)
+        {
+        p.resize(Nb);
+        u0.resize(Nb);
+        v0.resize(Nb);
+        u.resize(Nb);
+        v.resize(Nb);
+        ep.resize(Nb);
+        eq.resize(Nb);
+        phi0.resize(Nb);
+        phi.resize(Nb);
+        phiv0.resize(Nb);
+        phiv.resize(Nb);
+        }
+
+    /** returns a copy of node i as a Node struct */
+    inline Node getNode(const int i) const
+        {
+        return Node {p[i], u0[i], v0[i], u[i], v[i], ep[i], eq[i], phi0[i], phi[i], phiv0[i], phiv[i]};
+        }
+
+    /** copy all the fields of n in node i */
+    inline void setNode(const int i, Node const &n)
+        {
+        p[i] = n.p;
+        u0[i] = n.u0;
+        v0[i] = n.v0;
+        u[i] = n.u;
+        v[i] = n.v;
+        ep[i] = n.ep;
+        eq[i] = n.eq;
+        phi0[i] = n.phi0;
+        phi[i] = n.phi;
+        phiv0[i] = n.phiv0;
+        phiv[i] = n.phiv;
+        }
+
+    /** array of the vector field F */
+    template<vectorField F>
+    inline std::vector<Eigen::Vector3d> const &field(void) const { return fieldOf<F>(*this); }
+
+    /** array of the vector field F */
+    template<vectorField F>
+    inline std::vector<Eigen::Vector3d> &field(void) { return fieldOf<F>(*this); }
+
+    /** array of the scalar field F */
+    template<scalarField F>
+    inline std::vector<double> const &field(void) const { return fieldOf<F>(*this); }
+
+    /** array of the scalar field F */
+    template<scalarField F>
+    inline std::vector<double> &field(void) { return fieldOf<F>(*this); }
+
+    /** compile time getter for the vector field F of node i */
+    template<vectorField F>
+    inline const Eigen::Vector3d &get(const int i) const { return field<F>()[i]; }
+
+    /** compile time getter for the scalar field F of node i */
+    template<scalarField F>
+    inline double get(const int i) const { return field<F>()[i]; }
+
+    /** compile time setter for the scalar field F of node i */
+    template<scalarField F>
+    inline void set(const int i, const double val) { field<F>()[i] = val; }
+
+    /** setter for the local basis vectors of all the nodes */
+    void setBasis(const double r)
+        {
+        std::for_each(std::execution::par, u0.begin(), u0.end(),
+                      [this, &r](Eigen::Vector3d const &_u0)
+                      {
+                      const int i = &_u0 - u0.data();
+                      Nodes::setBasis(_u0, ep[i], eq[i], r);
+                      });
+        }
+
+    /** preparation of the quantities u0,v0,phi0,phiv0 for incomming time-step, whole arrays are
+     * copied */
+    void evolution(void)
+        {
+        std::copy(std::execution::par, u.begin(), u.end(), u0.begin());
+        std::copy(std::execution::par, v.begin(), v.end(), v0.begin());
+        std::copy(std::execution::par, phi.begin(), phi.end(), phi0.begin());
+        std::copy(std::execution::par, phiv.begin(), phiv.end(), phiv0.begin());
+        }
+
+    /** same as Node::make_evol for node i */
+    inline void make_evol(const int i /**< [in] */, const double vp /**< [in] */,
+                          const double vq /**< [in] */, const double dt /**< [in] */)
+        {
+        v[i] = vp * ep[i] + vq * eq[i];
+        u[i] = u0[i] + dt * v[i];
+        u[i].normalize();
+        }
+
+private:
+    /** array of the vector field F of s, S is Store or const Store */
+    template<vectorField F, class S>
+    static inline auto &fieldOf(S &s)
+        {
+        if constexpr (F == VEC_P) { return s.p; }
+        else if constexpr (F == VEC_U0) { return s.u0; }
+        else if constexpr (F == VEC_V0) { return s.v0; }
+        else if constexpr (F == VEC_U) { return s.u; }
+        else if constexpr (F == VEC_V) { return s.v; }
+        else if constexpr (F == VEC_EP) { return s.ep; }
+        else { return s.eq; }
+        }
+
+    /** array of the scalar field F of s, S is Store or const Store */
+    template<scalarField F, class S>
+    static inline auto &fieldOf(S &s)
+        {
+        if constexpr (F == SCAL_PHI0) { return s.phi0; }
+        else if constexpr (F == SCAL_PHI) { return s.phi; }
+        else if constexpr (F == SCAL_PHIV0) { return s.phiv0; }
+        else { return s.phiv; }
+        }
+    };  // end struct Store
+
 /** setter for phi */
 inline void set_phi(Node &n, double val) { n.phi = val; }
 
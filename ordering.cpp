@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+
+#include "ordering.h"
+
+using namespace Ordering;
+
+namespace
+    {
+/** number of bits of the integer coordinates along each axis on the space filling curves */
+constexpr int nbBits = 21;
+
+/** integer coordinates of the nodes in a grid of 2^nbBits cells along each axis over their bounding
+ * box, with the same cell size along all axes */
+std::vector<std::array<uint32_t, 3>> gridCoordinates(std::vector<Eigen::Vector3d> const &p)
+    {
+    Eigen::Vector3d pmin = Eigen::Vector3d::Constant(__DBL_MAX__);
+    Eigen::Vector3d pmax = Eigen::Vector3d::Constant(-__DBL_MAX__);
+    for (Eigen::Vector3d const &x : p)
+        {
+        pmin = pmin.cwiseMin(x);
+        pmax = pmax.cwiseMax(x);
+        }
+    const double size = (pmax - pmin).maxCoeff();
+    const double maxCoord = (1u << nbBits) - 1;
+    const double scale = (size > 0) ? maxCoord / size : 0;
+
+    std::vector<std::array<uint32_t, 3>> q(p.size());
+    std::transform(std::execution::par, p.begin(), p.end(), q.begin(),
+                   [&pmin, scale, maxCoord](Eigen::Vector3d const &x)
+                   {
+                   std::array<uint32_t, 3> c;
+                   for (int k = 0; k < 3; k++)
+                       { c[k] = std::min(maxCoord, std::floor((x[k] - pmin[k]) * scale)); }
+                   return c;
+                   });
+    return q;
+    }
+
+/** interleaves the bits of the coordinates, the most significant bit of c[0] first */
+uint64_t interleave(std::array<uint32_t, 3> const &c)
+    {
+    uint64_t key = 0;
+    for (int b = nbBits - 1; b >= 0; b--)
+        for (int k = 0; k < 3; k++)
+            { key = (key << 1) | ((c[k] >> b) & 1); }
+    return key;
+    }
+
+/** transforms the coordinates in place to the transposed Hilbert index, as in J. Skilling,
+ * Programming the Hilbert curve, AIP Conf. Proc. 707 (2004) */
+void axesToTranspose(std::array<uint32_t, 3> &x)
+    {
+    const uint32_t m = 1u << (nbBits - 1);
+    // inverse undo
+    for (uint32_t q = m; q > 1; q >>= 1)
+        {
+        const uint32_t p = q - 1;
+        for (int i = 0; i < 3; i++)
+            {
+            if (x[i] & q)
+                { x[0] ^= p; }  // invert
+            else
+                {  // exchange
+                const uint32_t t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+                }
+            }
+        }
+    // Gray encode
+    for (int i = 1; i < 3; i++)
+        { x[i] ^= x[i - 1]; }
+    uint32_t t = 0;
+    for (uint32_t q = m; q > 1; q >>= 1)
+        if (x[2] & q) t ^= q - 1;
+    for (int i = 0; i < 3; i++)
+        { x[i] ^= t; }
+    }
+
+/** permutation sorting the nodes by increasing keys */
+std::vector<int> sortByKeys(std::vector<uint64_t> const &keys)
+    {
+    std::vector<int> perm(keys.size());
+    std::iota(perm.begin(), perm.end(), 0);
+    std::sort(std::execution::par, perm.begin(), perm.end(),
+              [&keys](const int a, const int b) { return keys[a] < keys[b] || (keys[a] == keys[b] && a < b); });
+    return perm;
+    }
+
+/** breadth first search from root in the nodes not yet visited, appends the visited nodes to order
+ * by levels, the neighbours of a node by increasing degree. Returns the number of levels, lastLevel
+ * is the index in order of the first node of the last level. */
+int bfs(graph const &g, const int root, std::vector<char> &visited, std::vector<int> &order,
+        size_t &lastLevel)
+    {
+    order.push_back(root);
+    visited[root] = 1;
+    size_t levelBegin = order.size() - 1;
+    size_t levelEnd = order.size();
+    int nbLevels = 0;
+    while (levelBegin < levelEnd)
+        {
+        lastLevel = levelBegin;
+        nbLevels++;
+        for (size_t i = levelBegin; i < levelEnd; i++)
+            {
+            const size_t first = order.size();
+            for (const int j : g[order[i]])
+                {
+                if (!visited[j])
+                    {
+                    visited[j] = 1;
+                    order.push_back(j);
+                    }
+                }
+            std::sort(order.begin() + first, order.end(),
+                      [&g](const int a, const int b) { return g[a].size() < g[b].size(); });
+            }
+        levelBegin = levelEnd;
+        levelEnd = order.size();
+        }
+    return nbLevels;
+    }
+
+    }  // namespace
+
+graph Ordering::buildGraph(const int nbNodes, std::vector<int> const &ind, const int nbNodesPerElem)
+    {
+    graph g(nbNodes);
+    for (size_t e = 0; e < ind.size(); e += nbNodesPerElem)
+        for (int i = 0; i < nbNodesPerElem; i++)
+            for (int j = 0; j < nbNodesPerElem; j++)
+                if (i != j) g[ind[e + i]].push_back(ind[e + j]);
+    std::for_each(std::execution::par, g.begin(), g.end(),
+                  [](std::vector<int> &v)
+                  {
+                  std::sort(v.begin(), v.end());
+                  v.erase(std::unique(v.begin(), v.end()), v.end());
+                  });
+    return g;
+    }
+
+std::vector<int> Ordering::alongAxis(std::vector<Eigen::Vector3d> const &p, const int axis)
+    {
+    std::vector<int> perm(p.size());
+    std::iota(perm.begin(), perm.end(), 0);
+    std::sort(perm.begin(), perm.end(),
+              [&p, axis](const int a, const int b) { return p[a](axis) < p[b](axis); });
+    return perm;
+    }
+
+std::vector<int> Ordering::rcm(graph const &g)
+    {
+    const int n = g.size();
+    std::vector<int> byDegree(n);
+    std::iota(byDegree.begin(), byDegree.end(), 0);
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+                     [&g](const int a, const int b) { return g[a].size() < g[b].size(); });
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<char> visited(n, 0);
+    std::vector<char> probe(n, 0);
+    std::vector<int> levels, candidateLevels;
+    auto levelStructure = [&g, &probe](const int r, std::vector<int> &lv, size_t &last)
+    {
+        lv.clear();
+        const int nbLevels = bfs(g, r, probe, lv, last);
+        for (const int i : lv)
+            { probe[i] = 0; }
+        return nbLevels;
+    };
+    for (const int start : byDegree)
+        {
+        if (visited[start]) continue;
+
+        // pseudo peripheral node, as in George and Liu: the root moves to the node of lowest degree
+        // of the last level while the number of levels increases
+
+        int root = start;
+        size_t last = 0;
+        int depth = levelStructure(root, levels, last);
+        for (;;)
+            {
+            const int candidate = *std::min_element(levels.begin() + last, levels.end(),
+                                                    [&g](const int a, const int b)
+                                                    { return g[a].size() < g[b].size(); });
+            size_t candidateLast = 0;
+            const int d = levelStructure(candidate, candidateLevels, candidateLast);
+            if (d <= depth) break;
+            root = candidate;
+            depth = d;
+            std::swap(levels, candidateLevels);
+            last = candidateLast;
+            }
+        bfs(g, root, visited, order, last);
+        }
+    std::reverse(order.begin(), order.end());
+    return order;
+    }
+
+std::vector<int> Ordering::hilbert(std::vector<Eigen::Vector3d> const &p)
+    {
+    std::vector<std::array<uint32_t, 3>> q = gridCoordinates(p);
+    std::vector<uint64_t> keys(q.size());
+    std::transform(std::execution::par, q.begin(), q.end(), keys.begin(),
+                   [](std::array<uint32_t, 3> c)
+                   {
+                   axesToTranspose(c);
+                   return interleave(c);
+                   });
+    return sortByKeys(keys);
+    }
+
+std::vector<int> Ordering::morton(std::vector<Eigen::Vector3d> const &p)
+    {
+    std::vector<std::array<uint32_t, 3>> q = gridCoordinates(p);
+    std::vector<uint64_t> keys(q.size());
+    std::transform(std::execution::par, q.begin(), q.end(), keys.begin(),
+                   [](std::array<uint32_t, 3> const &c) { return interleave(c); });
+    return sortByKeys(keys);
+    }
+
+profile Ordering::measure(graph const &g, std::vector<int> const &newIndex)
+    {
+    profile prf;
+    for (size_t i = 0; i < g.size(); i++)
+        {
+        const long ni = newIndex[i];
+        long first = ni;
+        for (const int j : g[i])
+            {
+            const long nj = newIndex[j];
+            prf.bandwidth = std::max(prf.bandwidth, std::abs(nj - ni));
+            first = std::min(first, nj);
+            }
+        prf.envelope += ni - first;
+        }
+    return prf;
+    }
@@ -0,0 +1,93 @@
+#ifndef ordering_h
+#define ordering_h
+
+/** \file ordering.h
+\brief orderings of the nodes of the mesh in memory. The ordering of the nodes sets the bandwidth of
+the matrix of the linear system, hence the fill-in of its factorizations and the locality of the
+accesses to the nodes from the tetrahedrons. All the orderings return a permutation: the index in the
+initial ordering of the i-th node of the new ordering.
+*/
+
+#include <string>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+
+namespace Ordering
+    {
+/** \enum type
+ordering of the nodes
+*/
+enum type
+    {
+    LONGEST_AXIS = 0, /**< by increasing coordinate along the longest axis of the bounding box */
+    RCM = 1,          /**< reverse Cuthill-McKee on the graph of the nodes */
+    HILBERT = 2,      /**< along a Hilbert space filling curve */
+    MORTON = 3        /**< along a Morton space filling curve (Z order) */
+    };
+
+/** returns the name of the ordering, as written in the settings */
+inline std::string name(const type t)
+    {
+    switch (t)
+        {
+        case LONGEST_AXIS: return "longest_axis";
+        case RCM: return "rcm";
+        case HILBERT: return "hilbert";
+        case MORTON: return "morton";
+        }
+    return "unknown";
+    }
+
+/** returns the ordering from its name, returns false if the name is unknown */
+inline bool fromName(std::string const &s /**< [in] */, type &t /**< [out] */)
+    {
+    for (type x : {LONGEST_AXIS, RCM, HILBERT, MORTON})
+        {
+        if (s == name(x))
+            {
+            t = x;
+            return true;
+            }
+        }
+    return false;
+    }
+
+/** graph of the nodes: the neighbours of each node through the elements, sorted, without the node
+ * itself */
+using graph = std::vector<std::vector<int>>;
+
+/** \struct profile
+sizes of the sparsity pattern of the graph of the nodes for an ordering
+*/
+struct profile
+    {
+    long bandwidth = 0; /**< largest distance between the indices of two neighbours */
+    long envelope = 0;  /**< sum over the nodes of the distance to their first neighbour, the fill-in
+                             of a complete factorization without pivoting */
+    };
+
+/** graph of the nodes of the elements, whose node indices are consecutive in ind, by groups of
+ * nbNodesPerElem */
+graph buildGraph(const int nbNodes /**< [in] */, std::vector<int> const &ind /**< [in] */,
+                 const int nbNodesPerElem /**< [in] */);
+
+/** permutation sorting the nodes by increasing coordinate along axis */
+std::vector<int> alongAxis(std::vector<Eigen::Vector3d> const &p /**< [in] */, const int axis /**< [in] */);
+
+/** reverse Cuthill-McKee permutation of the graph, each connected component starting from a pseudo
+ * peripheral node */
+std::vector<int> rcm(graph const &g /**< [in] */);
+
+/** permutation along a Hilbert curve through the bounding box of the nodes */
+std::vector<int> hilbert(std::vector<Eigen::Vector3d> const &p /**< [in] */);
+
+/** permutation along a Morton curve through the bounding box of the nodes */
+std::vector<int> morton(std::vector<Eigen::Vector3d> const &p /**< [in] */);
+
+/** profile of the graph with the node i at newIndex[i] */
+profile measure(graph const &g /**< [in] */, std::vector<int> const &newIndex /**< [in] */);
+
+    }  // namespace Ordering
+
+#endif
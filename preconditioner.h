@@ -0,0 +1,525 @@
+#ifndef preconditioner_h
+#define preconditioner_h
+
+/** \file preconditioner.h
+\brief preconditioners for the bicgstab solver of the finite element problem
+<br> All preconditioners share the interface Precond::base, the class Precond::wrapper fulfills the
+preconditioner concept of the eigen iterative solvers and forwards to the one selected at runtime.
+The sparsity pattern of the matrix is constant (see matrix_assembly.h), so that the symbolic part of
+the setup is done once by analyzePattern(), each time step only calls factorize().
+*/
+
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Sparse>
+
+namespace Precond
+    {
+/** row major sparse matrix of the finite element problem */
+typedef Eigen::SparseMatrix<double, Eigen::RowMajor> spMat;
+
+/** read only reference to the matrix handled by the eigen iterative solvers */
+typedef Eigen::Ref<const spMat> refMat;
+
+/** 2x2 diagonal blocks (i, NOD+i) of the matrix for all nodes i, this is all what is known of a
+ * matrix free operator */
+typedef std::vector<Eigen::Matrix2d> nodeBlocks;
+
+/** \enum type
+available preconditioners
+*/
+enum type
+    {
+    NONE = 0,         /**< identity, no preconditioning */
+    JACOBI = 1,       /**< inverse of the diagonal */
+    BLOCK_JACOBI = 2, /**< inverse of the 2x2 blocks coupling unknowns i and NOD+i of each node */
+    ILU0 = 3,         /**< incomplete LU factorization without fill-in */
+    ILUT = 4          /**< incomplete LU factorization with threshold (eigen IncompleteLUT) */
+    };
+
+/** returns the name of the preconditioner, as written in the settings */
+inline std::string name(const type t)
+    {
+    switch (t)
+        {
+        case NONE: return "none";
+        case JACOBI: return "jacobi";
+        case BLOCK_JACOBI: return "block_jacobi";
+        case ILU0: return "ilu0";
+        case ILUT: return "ilut";
+        }
+    return "unknown";
+    }
+
+/** returns true if the preconditioner can be built from the node blocks of a matrix free operator */
+inline bool isMatrixFree(const type t) { return (t == NONE || t == JACOBI || t == BLOCK_JACOBI); }
+
+/** returns the preconditioner type from its name, returns false if the name is unknown */
+inline bool fromName(std::string const &s /**< [in] */, type &t /**< [out] */)
+    {
+    for (type x : {NONE, JACOBI, BLOCK_JACOBI, ILU0, ILUT})
+        {
+        if (s == name(x))
+            {
+            t = x;
+            return true;
+            }
+        }
+    return false;
+    }
+
+/** \class base
+interface of the preconditioners: a preconditioner is an approximation of the inverse of the matrix
+*/
+class base
+    {
+public:
+    virtual ~base() {}
+
+    /** symbolic setup, only depends on the sparsity pattern of A */
+    virtual void analyzePattern(refMat const &A /**< [in] */) = 0;
+
+    /** numerical setup, depends on the coefficients of A */
+    virtual void factorize(refMat const &A /**< [in] */) = 0;
+
+    /** numerical setup from the node blocks of a matrix free operator, if supported */
+    virtual void factorize(nodeBlocks const & /**< [in] */) { info = Eigen::InvalidInput; }
+
+    /** x = M^-1 b */
+    virtual void apply(Eigen::Ref<const Eigen::VectorXd> b /**< [in] */,
+                       Eigen::Ref<Eigen::VectorXd> x /**< [out] */) const = 0;
+
+    /** number of non zero coefficients of the factors, zero if the preconditioner is not a
+     * factorization */
+    virtual long nonZeros(void) const { return 0; }
+
+    /** status of the last setup */
+    Eigen::ComputationInfo info = Eigen::Success;
+    };
+
+/** \class identity
+no preconditioning
+*/
+class identity : public base
+    {
+public:
+    void analyzePattern(refMat const &) override {}
+
+    void factorize(refMat const &) override {}
+
+    void factorize(nodeBlocks const &) override { info = Eigen::Success; }
+
+    void apply(Eigen::Ref<const Eigen::VectorXd> b, Eigen::Ref<Eigen::VectorXd> x) const override
+        { x = b; }
+    };
+
+/** \class jacobi
+inverse of the diagonal of the matrix, positions of the diagonal coefficients are computed once
+*/
+class jacobi : public base
+    {
+public:
+    void analyzePattern(refMat const &A) override
+        {
+        diagPos.resize(A.rows());
+        for (int i = 0; i < A.rows(); i++)
+            { diagPos[i] = findPos(A, i, i); }
+        invDiag.resize(A.rows());
+        }
+
+    void factorize(refMat const &A) override
+        {
+        const double *val = A.valuePtr();
+        info = Eigen::Success;
+        std::for_each(std::execution::par, diagPos.begin(), diagPos.end(),
+                      [this, val](const int &pos)
+                      {
+                      const int i = &pos - diagPos.data();
+                      const double d = (pos < 0) ? 0.0 : val[pos];
+                      invDiag[i] = (d != 0.0) ? 1.0 / d : 1.0;
+                      });
+        }
+
+    void factorize(nodeBlocks const &B) override
+        {
+        const int NOD = B.size();
+        invDiag.resize(2 * NOD);
+        info = Eigen::Success;
+        std::for_each(std::execution::par, B.begin(), B.end(),
+                      [this, &B, NOD](Eigen::Matrix2d const &b)
+                      {
+                      const int i = &b - B.data();
+                      invDiag[i] = (b(0, 0) != 0.0) ? 1.0 / b(0, 0) : 1.0;
+                      invDiag[NOD + i] = (b(1, 1) != 0.0) ? 1.0 / b(1, 1) : 1.0;
+                      });
+        }
+
+    void apply(Eigen::Ref<const Eigen::VectorXd> b, Eigen::Ref<Eigen::VectorXd> x) const override
+        { x = invDiag.cwiseProduct(b); }
+
+    /** position of the coefficient (i,j) of A in A.valuePtr(), -1 if it is not in the pattern */
+    static int findPos(refMat const &A, const int i, const int j)
+        {
+        const int *first = A.innerIndexPtr() + A.outerIndexPtr()[i];
+        const int *last = A.innerIndexPtr() + A.outerIndexPtr()[i + 1];
+        const int *it = std::lower_bound(first, last, j);
+        return ((it != last) && (*it == j)) ? (it - A.innerIndexPtr()) : -1;
+        }
+
+private:
+    /** positions of the diagonal coefficients */
+    std::vector<int> diagPos;
+
+    /** inverse of the diagonal */
+    Eigen::VectorXd invDiag;
+    };
+
+/** \class blockJacobi
+block diagonal preconditioner: for each node i, the 2x2 block of the coefficients of the rows and
+columns (i, NOD+i) is inverted. Those blocks couple the two components of the magnetization speed in
+the tangent plane, they hold the gyromagnetic part of the matrix.
+*/
+class blockJacobi : public base
+    {
+public:
+    void analyzePattern(refMat const &A) override
+        {
+        NOD = A.rows() / 2;
+        pos.resize(4 * NOD);
+        for (int i = 0; i < NOD; i++)
+            {
+            pos[4 * i] = jacobi::findPos(A, i, i);
+            pos[4 * i + 1] = jacobi::findPos(A, i, NOD + i);
+            pos[4 * i + 2] = jacobi::findPos(A, NOD + i, i);
+            pos[4 * i + 3] = jacobi::findPos(A, NOD + i, NOD + i);
+            }
+        invBlock.resize(NOD);
+        }
+
+    void factorize(refMat const &A) override
+        {
+        const double *val = A.valuePtr();
+        std::for_each(std::execution::par, invBlock.begin(), invBlock.end(),
+                      [this, val](Eigen::Matrix2d &B)
+                      {
+                      const int *p = pos.data() + 4 * (&B - invBlock.data());
+                      B << coeff(val, p[0]), coeff(val, p[1]), coeff(val, p[2]), coeff(val, p[3]);
+                      });
+        invert();
+        }
+
+    void factorize(nodeBlocks const &B) override
+        {
+        NOD = B.size();
+        invBlock = B;
+        invert();
+        }
+
+    void apply(Eigen::Ref<const Eigen::VectorXd> b, Eigen::Ref<Eigen::VectorXd> x) const override
+        {
+        std::for_each(std::execution::par, invBlock.begin(), invBlock.end(),
+                      [this, &b, &x](Eigen::Matrix2d const &inv)
+                      {
+                      const int i = &inv - invBlock.data();
+                      const double b0 = b(i);
+                      const double b1 = b(NOD + i);
+                      x(i) = inv(0, 0) * b0 + inv(0, 1) * b1;
+                      x(NOD + i) = inv(1, 0) * b0 + inv(1, 1) * b1;
+                      });
+        }
+
+private:
+    /** number of nodes */
+    int NOD;
+
+    /** positions of the 4 coefficients of the block of each node, -1 if not in the pattern */
+    std::vector<int> pos;
+
+    /** inverse of the block of each node */
+    std::vector<Eigen::Matrix2d> invBlock;
+
+    /** value of the coefficient at position p, zero if not in the pattern */
+    static inline double coeff(const double *val, const int p) { return (p < 0) ? 0.0 : val[p]; }
+
+    /** inverts in place the blocks, a singular block is replaced by identity */
+    void invert(void)
+        {
+        info = Eigen::Success;
+        std::for_each(std::execution::par, invBlock.begin(), invBlock.end(),
+                      [](Eigen::Matrix2d &B)
+                      {
+                      Eigen::Matrix2d inv;
+                      bool invertible;
+                      double det;
+                      B.computeInverseAndDetWithCheck(inv, det, invertible);
+                      if (invertible)
+                          { B = inv; }
+                      else
+                          { B.setIdentity(); }
+                      });
+        }
+    };
+
+/** \class ilu0
+incomplete LU factorization with zero fill-in: L and U share the sparsity pattern of the matrix. The
+rows are grouped by levels once by analyzePattern(): a row only depends on rows of lower levels, so
+that the rows of a level are factorized and solved concurrently. Two sets of levels are needed, one
+for the lower triangular part (factorization and forward substitution), one for the upper triangular
+part (backward substitution).
+*/
+class ilu0 : public base
+    {
+public:
+    void analyzePattern(refMat const &A) override
+        {
+        const int n = A.rows();
+        outer.assign(A.outerIndexPtr(), A.outerIndexPtr() + n + 1);
+        inner.assign(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros());
+        LU.resize(A.nonZeros());
+        diagPos.resize(n);
+        for (int i = 0; i < n; i++)
+            { diagPos[i] = jacobi::findPos(A, i, i); }
+
+        std::vector<int> level(n, 0);
+        for (int i = 0; i < n; i++)
+            for (int k = outer[i]; k < outer[i + 1] && inner[k] < i; k++)
+                { level[i] = std::max(level[i], level[inner[k]] + 1); }
+        groupByLevel(level, lowerLevels);
+
+        std::fill(level.begin(), level.end(), 0);
+        for (int i = n - 1; i >= 0; i--)
+            for (int k = outer[i + 1] - 1; k >= outer[i] && inner[k] > i; k--)
+                { level[i] = std::max(level[i], level[inner[k]] + 1); }
+        groupByLevel(level, upperLevels);
+        }
+
+    void factorize(refMat const &A) override
+        {
+        info = Eigen::Success;
+        if (std::find(diagPos.begin(), diagPos.end(), -1) != diagPos.end())
+            {
+            info = Eigen::NumericalIssue;
+            return;
+            }
+        std::copy(std::execution::par, A.valuePtr(), A.valuePtr() + A.nonZeros(), LU.begin());
+        for (std::vector<int> const &rows : lowerLevels)
+            {
+            std::for_each(std::execution::par, rows.begin(), rows.end(),
+                          [this](const int i) { factorizeRow(i); });
+            }
+        if (std::any_of(diagPos.begin(), diagPos.end(), [this](const int p) { return LU[p] == 0; }))
+            { info = Eigen::NumericalIssue; }
+        }
+
+    void apply(Eigen::Ref<const Eigen::VectorXd> b, Eigen::Ref<Eigen::VectorXd> x) const override
+        {
+        for (std::vector<int> const &rows : lowerLevels)
+            {
+            std::for_each(std::execution::par, rows.begin(), rows.end(),
+                          [this, &b, &x](const int i)
+                          {
+                          double s = b(i);
+                          for (int k = outer[i]; k < diagPos[i]; k++)
+                              { s -= LU[k] * x(inner[k]); }
+                          x(i) = s;
+                          });
+            }
+        for (std::vector<int> const &rows : upperLevels)
+            {
+            std::for_each(std::execution::par, rows.begin(), rows.end(),
+                          [this, &x](const int i)
+                          {
+                          double s = x(i);
+                          for (int k = diagPos[i] + 1; k < outer[i + 1]; k++)
+                              { s -= LU[k] * x(inner[k]); }
+                          x(i) = s / LU[diagPos[i]];
+                          });
+            }
+        }
+
+    long nonZeros(void) const override { return LU.size(); }
+
+    /** number of levels of the lower and upper triangular parts */
+    inline std::pair<int, int> getNbLevels(void) const
+        { return std::make_pair(lowerLevels.size(), upperLevels.size()); }
+
+private:
+    /** row pointers of the pattern */
+    std::vector<int> outer;
+
+    /** column indices of the pattern */
+    std::vector<int> inner;
+
+    /** positions of the diagonal coefficients */
+    std::vector<int> diagPos;
+
+    /** coefficients of L (strictly lower part, unit diagonal) and U (upper part) */
+    std::vector<double> LU;
+
+    /** rows grouped by levels of the lower triangular part */
+    std::vector<std::vector<int>> lowerLevels;
+
+    /** rows grouped by levels of the upper triangular part */
+    std::vector<std::vector<int>> upperLevels;
+
+    /** fills levels with the rows of each level */
+    static void groupByLevel(std::vector<int> const &level, std::vector<std::vector<int>> &levels)
+        {
+        levels.assign(*std::max_element(level.begin(), level.end()) + 1, std::vector<int>());
+        for (unsigned int i = 0; i < level.size(); i++)
+            { levels[level[i]].push_back(i); }
+        }
+
+    /** IKJ variant of the factorization of row i, rows of lower levels are already factorized */
+    void factorizeRow(const int i)
+        {
+        const int end_i = outer[i + 1];
+        for (int k = outer[i]; k < diagPos[i]; k++)
+            {
+            const int r = inner[k];
+            const double l_ik = (LU[k] /= LU[diagPos[r]]);
+            // merge of the sorted columns of rows i and r, right of the coefficient (i,r)
+            int m = k + 1;
+            for (int p = diagPos[r] + 1; p < outer[r + 1] && m < end_i; p++)
+                {
+                while (m < end_i && inner[m] < inner[p])
+                    { m++; }
+                if (m < end_i && inner[m] == inner[p])
+                    { LU[m] -= l_ik * LU[p]; }
+                }
+            }
+        }
+    };
+
+/** \class ilut
+incomplete LU factorization with threshold, from eigen. The fill-in makes it more efficient than
+ilu0, but its factorization is sequential.
+*/
+class ilut : public base
+    {
+public:
+    void analyzePattern(refMat const &A) override
+        {
+        _ilut.analyzePattern(A);
+        info = _ilut.info();
+        }
+
+    void factorize(refMat const &A) override
+        {
+        _ilut.factorize(A);
+        info = _ilut.info();
+        }
+
+    void apply(Eigen::Ref<const Eigen::VectorXd> b, Eigen::Ref<Eigen::VectorXd> x) const override
+        { x = _ilut.solve(b); }
+
+    long nonZeros(void) const override { return _ilut.nonZeros(); }
+
+private:
+    /** \class lut
+    eigen incomplete LU factorization with threshold, with access to the size of its factors */
+    class lut : public Eigen::IncompleteLUT<double>
+        {
+    public:
+        /** number of non zero coefficients of L and U */
+        long nonZeros(void) const { return m_lu.nonZeros(); }
+        };
+
+    /** eigen incomplete LU factorization with threshold */
+    lut _ilut;
+    };
+
+/** \class wrapper
+preconditioner for the eigen iterative solvers, forwarding to the preconditioner selected with
+select(). Default is ilut. The matrix is either a sparse matrix, or a matrix free operator providing
+a member getNodeBlocks() returning its 2x2 node blocks.
+*/
+class wrapper
+    {
+public:
+    /** dimensions are unknown at compile time */
+    enum
+        {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic
+        };
+
+    /** default constructor */
+    wrapper() { select(ILUT); }
+
+    /** select the preconditioner, must be called before analyzePattern() */
+    void select(const type t /**< [in] */)
+        {
+        _type = t;
+        switch (t)
+            {
+            case NONE: impl = std::make_unique<identity>(); break;
+            case JACOBI: impl = std::make_unique<jacobi>(); break;
+            case BLOCK_JACOBI: impl = std::make_unique<blockJacobi>(); break;
+            case ILU0: impl = std::make_unique<ilu0>(); break;
+            case ILUT: impl = std::make_unique<ilut>(); break;
+            }
+        }
+
+    /** getter for the type of the preconditioner */
+    inline type getType(void) const { return _type; }
+
+    /** symbolic setup */
+    template<typename MatType>
+    wrapper &analyzePattern(const MatType &A)
+        {
+        if constexpr (std::is_convertible_v<const MatType &, refMat>)
+            { impl->analyzePattern(A); }
+        return *this;
+        }
+
+    /** numerical setup */
+    template<typename MatType>
+    wrapper &factorize(const MatType &A)
+        {
+        if constexpr (std::is_convertible_v<const MatType &, refMat>)
+            { impl->factorize(A); }
+        else
+            { impl->factorize(A.getNodeBlocks()); }
+        return *this;
+        }
+
+    /** symbolic and numerical setup */
+    template<typename MatType>
+    wrapper &compute(const MatType &A)
+        {
+        analyzePattern(A);
+        return factorize(A);
+        }
+
+    /** returns M^-1 b */
+    template<typename Rhs>
+    inline Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs> &b) const
+        {
+        Eigen::VectorXd x(b.rows());
+        impl->apply(b, x);
+        return x;
+        }
+
+    /** status of the last setup */
+    inline Eigen::ComputationInfo info(void) const { return impl->info; }
+
+    /** number of non zero coefficients of the factors of the selected preconditioner */
+    inline long nonZeros(void) const { return impl->nonZeros(); }
+
+private:
+    /** selected preconditioner */
+    type _type;
+
+    /** implementation of the selected preconditioner */
+    std::unique_ptr<base> impl;
+    };
+    }  // namespace Precond
+
+#endif
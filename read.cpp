@@ -1,6 +1,8 @@
 #include <fstream>
+#include "chronometer.h"
 #include "feellgoodSettings.h"
 #include "mesh.h"
+#include "mesh_reader.h"
 #include "tags.h"
 
 namespace Mesh
@@ -12,187 +14,133 @@ void mesh::readMesh(Settings const &mySets)
         {
         std::cout << "Reading mesh file " << mySets.getPbName() << ":\n";
         }
-    std::string symb;
-    std::ifstream msh(mySets.getPbName());
-
-    on_fail_msg_error(msh, "cannot open file " + mySets.getPbName() );
+    chronometer counter(2);
+    Gmsh::contents file = Gmsh::read(mySets.getPbName());
+    if (mySets.verbose)
+        {
+        std::cout << "  format " << file.version << (file.binary ? " binary" : " text")
+                  << ", parsed in " << counter.millis() << '\n';
+        }
 
-    msh >> symb;
-    if (symb == tags::msh::format)
+    if (file.withPhysicalNames)
         {
-        std::string mshFormat = "";
-        msh >> mshFormat;
-        if (mshFormat == tags::msh::version)
+        surfRegNames = std::move(file.surfRegNames);
+        volRegNames = std::move(file.volRegNames);
+        if (mySets.verbose)
             {
-            int _tags, reg, TYP,nbRegNames;
-
-            if (tags::lookFor(false, msh, tags::msh::begin_physical_names))
+            std::cout << "  found " << surfRegNames.size() + volRegNames.size() << " regions:\n";
+            std::map<int, std::string>::iterator it;
+            for (it = surfRegNames.begin(); it != surfRegNames.end(); ++it)
                 {
-                msh >> nbRegNames;
-
-                while ((msh >> symb) && (symb != tags::msh::end_physical_names) && (!msh.fail()))
-                    {
-                    std::string name;
-                    msh >> _tags >> name;
-
-                    switch (stoi(symb))
-                        {
-                        case tags::msh::DIM_OBJ_2D:
-                            {
-                            surfRegNames[_tags] = name.substr(1, name.length() - 2);
-                            break;
-                            }
-                        case tags::msh::DIM_OBJ_3D:
-                            {
-                            volRegNames[_tags] = name.substr(1, name.length() - 2);
-                            break;
-                            }
-                        default:
-                            std::cerr << "unknown type in mesh " << tags::msh::begin_physical_names << std::endl;
-                            break;
-                        }
-                    }
-                if (mySets.verbose)
-                    {
-                    std::cout << "  found " << nbRegNames << " regions:\n";
-                    std::map<int, std::string>::iterator it;
-                    for (it = surfRegNames.begin(); it != surfRegNames.end(); ++it)
-                        {
-                        std::cout << "    " << it->first << ": " << it->second << '\n';
-                        }
-                    for (it = volRegNames.begin(); it != volRegNames.end(); ++it)
-                        {
-                        std::cout << "    " << it->first << ": " << it->second << '\n';
-                        }
-                    }
+                std::cout << "    " << it->first << ": " << it->second << '\n';
                 }
-            else
+            for (it = volRegNames.begin(); it != volRegNames.end(); ++it)
                 {
-                std::cerr << tags::msh::begin_physical_names <<" undefined." << std::endl;
-                msh.clear();
-                msh.seekg(std::ios::beg);
-                }
-
-            double scale = mySets.getScale();
-            int nbNod;
-
-            if (tags::lookFor(true, msh, tags::msh::begin_nodes))
-                {
-                msh >> nbNod;
-                init_node(nbNod);
-
-                for (int i = 0; i < nbNod; i++)
-                    {
-                    double x,y,z;
-                    msh >> symb >> x >> y >> z;//node[i].p;
-                    x *= scale;
-                    y *= scale;
-                    z *= scale;
-                    node[i].p = Eigen::Vector3d(x,y,z);//.rescale(scale);
-                    }
+                std::cout << "    " << it->first << ": " << it->second << '\n';
                 }
+            }
+        }
+    else
+        {
+        std::cerr << tags::msh::begin_physical_names << " undefined." << std::endl;
+        }
 
-            on_fail_msg_error(msh, "error while reading nodes");
+    const double scale = mySets.getScale();
+    const int nbNod = file.nodes.size();
+    init_node(nbNod);
+    std::transform(std::execution::par, file.nodes.begin(), file.nodes.end(), node.p.begin(),
+                   [scale](Eigen::Vector3d const &p) { return scale * p; });
 
-            for (auto it = surfRegNames.begin(); it != surfRegNames.end(); ++it)
-                {
-                s.push_back(Mesh::Surf(node, it->second));
-                }
+    for (auto it = surfRegNames.begin(); it != surfRegNames.end(); ++it)
+        {
+        s.push_back(Mesh::Surf(node, it->second));
+        }
 
-            int nbElem;
+    if (mySets.verbose)
+        {
+        std::cout << "  element count: " << file.nbElements << '\n';
+        }
+    if (file.nbUnknown > 0)
+        {
+        std::cerr << "unknown object type in mesh: " << file.nbUnknown << " elements ignored\n";
+        }
 
-            if (tags::lookFor(true, msh, tags::msh::begin_elements))
+    fac.reserve(file.triangles.size());
+    for (Gmsh::element const &e : file.triangles)
+        {
+        const int i0 = e.ind[0], i1 = e.ind[1], i2 = e.ind[2];
+        if (auto search = surfRegNames.find(e.reg); search != surfRegNames.end())
+            {  // found named surface
+            for (auto it = s.begin(); it != s.end(); ++it)
                 {
-                msh >> nbElem;
-                if (mySets.verbose)
-                    {
-                    std::cout << "  element count: " << nbElem << '\n';
-                    }
-                while ((msh >> symb) && (symb != tags::msh::end_elements) && (!msh.fail()))
+                if (it->getName() == search->second)
                     {
-                    msh >> TYP >> _tags >> reg;
-                    for (int i = 1; i < _tags; i++)
-                        msh >> symb;
-                    switch (TYP)
-                        {
-                        case tags::msh::TYP_ELEM_TRIANGLE:
-                            {
-                            int i0, i1, i2;
-                            msh >> i0 >> i1 >> i2;
-                            if (auto search = surfRegNames.find(reg); search != surfRegNames.end())
-                                {  // found named surface
-                                for (auto it = s.begin(); it != s.end(); ++it)
-                                    {
-                                    if (it->getName() == search->second)
-                                        {
-                                        it->push_back(Mesh::Triangle(node, i0, i1, i2));
-                                        }
-                                    }
-
-                                int idx = mySets.findFacetteRegionIdx(search->second);
-                                if (idx > -1)
-                                    fac.push_back(
-                                            Facette::Fac(node, nbNod, idx, {i0, i1,
-                                                         i2}));  // we only want to store in fac
-                                                                // vector the facettes for micromag
-                                                                // problem, nothing for bc for stt
-                                }
-                            else
-                                {
-                                std::cout << "mesh reading error : unnamed surface region"
-                                          << std::endl;
-                                }  // unnamed surface
-
-                            break;
-                            }
-                        case tags::msh::TYP_ELEM_TETRAEDRON:
-                            {
-                            int i0,i1,i2,i3;
-                            msh >> i0 >> i1 >> i2 >> i3;
-                            if (auto search = volRegNames.find(reg); search != volRegNames.end())
-                                {  // found named volume
-                                int idx = mySets.findTetraRegionIdx(search->second);
-                                if (idx > -1) tet.push_back(Tetra::Tet(node, idx, {i0,i1,i2,i3}));
-                                }
-                            else
-                                {
-                                std::cout << "mesh reading error : unnamed volume region"
-                                          << std::endl;
-                                }
-                            break;
-                            }
-                        default: std::cerr << "unknown object type in mesh\n"; break;
-                        }
+                    it->push_back(Mesh::Triangle(node, i0, i1, i2));
                     }
                 }
-            on_fail_msg_error(msh, "error while reading elements");
+
+            int idx = mySets.findFacetteRegionIdx(search->second);
+            if (idx > -1)
+                fac.push_back(Facette::Fac(node, nbNod, idx, {i0, i1, i2}));  // we only want to store in fac
+                                                                            // vector the facettes for micromag
+                                                                            // problem, nothing for bc for stt
             }
         else
             {
-            std::cout << "mesh file format " << mshFormat << " not supported." << std::endl;
-            SYSTEM_ERROR;
-            }
+            std::cout << "mesh reading error : unnamed surface region" << std::endl;
+            }  // unnamed surface
         }
 
-    if (!msh.fail())
+    tet.reserve(file.tetrahedrons.size());
+    tetGeom.reserve(file.tetrahedrons.size());
+    for (Gmsh::element const &e : file.tetrahedrons)
         {
-        if (mySets.verbose) std::cout << "  closing file\n";
-        msh.close();
-        }
-    else
-        {
-        std::cout << "error before closing mesh." << std::endl;
-        SYSTEM_ERROR;
+        if (auto search = volRegNames.find(e.reg); search != volRegNames.end())
+            {  // found named volume
+            int idx = mySets.findTetraRegionIdx(search->second);
+            if (idx > -1) tet.push_back(Tetra::Tet(node, tetGeom, idx, {e.ind[0], e.ind[1], e.ind[2], e.ind[3]}));
+            }
+        else
+            {
+            std::cout << "mesh reading error : unnamed volume region" << std::endl;
+            }
         }
 
     for (unsigned int i = 0; i < tet.size(); i++)
         {
         tet[i].idx = i;
         }
+    if (mySets.verbose)
+        {
+        std::cout << "  elements built in " << counter.millis() << '\n';
+        }
     }
 
 double mesh::readSol(bool VERBOSE, const std::string fileName)
     {
+    if (Snapshot::isSnapshot(fileName))
+        {
+        Snapshot::data d = Snapshot::read(fileName);
+        if (d.nbNodes() != node.size())
+            {
+            std::cerr << "error: " << d.nbNodes() << " nodes in snapshot " << fileName << ", "
+                      << node.size() << " in the mesh" << std::endl;
+            SYSTEM_ERROR;
+            }
+        if (VERBOSE)
+            {
+            std::cout << "snapshot: " << fileName << " @ time t = " << d.t << std::endl;
+            }
+        for (int i = 0; i < node.size(); i++)
+            {
+            const int k = node_index[i];
+            node.u[k] = Eigen::Vector3d(d.u[3 * i], d.u[3 * i + 1], d.u[3 * i + 2]);
+            if (d.singlePrecision) node.u[k].normalize();
+            node.phi[k] = d.phi[i];
+            }
+        return d.t;
+        }
+
     double t(0);
     std::ifstream fin(fileName, std::ifstream::in);
 
@@ -224,13 +172,13 @@ double mesh::readSol(bool VERBOSE, const std::string fileName)
         std::cout << ".sol file: " << fileName << " @ time t = " << t << std::endl;
         }
 
-    for (unsigned int i = 0; i < node.size(); i++)
+    for (int i = 0; i < node.size(); i++)
         {
         double mx,my,mz;
-        unsigned int i_;
+        int i_;
         int node_idx = node_index[i];
-        fin >> i_ >> mx >> my >> mz >> node[node_idx].phi;
-        node[node_idx].u = Eigen::Vector3d(mx,my,mz);
+        fin >> i_ >> mx >> my >> mz >> node.phi[node_idx];
+        node.u[node_idx] = Eigen::Vector3d(mx,my,mz);
         if (i != i_)
             {
             std::cerr << "error: mesh node index mismatch between mesh and input .sol file"
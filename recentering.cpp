@@ -57,7 +57,7 @@ bool Fem::recenter(double thres, char recentering_direction)
         }
 
     thres = abs(thres);
-    double m_i = msh.avg(Nodes::get_u_comp, idx_dir);
+    double m_i = msh.avg<Nodes::VEC_U>(idx_dir);
     if (fabs(m_i) < thres) return false;
 
     const int NPS = 1;
@@ -47,27 +47,27 @@ void Fem::saver(Settings &settings, timing const &t_prm, ofstream &fout, const i
             }
         if (keyVal == "<Mx>")
             {
-            fout << msh.avg(Nodes::get_u_comp, IDX_X) << sep;
+            fout << msh.avg<Nodes::VEC_U>(IDX_X) << sep;
             }
         if (keyVal == "<My>")
             {
-            fout << msh.avg(Nodes::get_u_comp, IDX_Y) << sep;
+            fout << msh.avg<Nodes::VEC_U>(IDX_Y) << sep;
             }
         if (keyVal == "<Mz>")
             {
-            fout << msh.avg(Nodes::get_u_comp, IDX_Z) << sep;
+            fout << msh.avg<Nodes::VEC_U>(IDX_Z) << sep;
             }
         if (keyVal == "<dMx/dt>")
             {
-            fout << msh.avg(Nodes::get_v_comp, IDX_X) << sep;
+            fout << msh.avg<Nodes::VEC_V>(IDX_X) << sep;
             }
         if (keyVal == "<dMy/dt>")
             {
-            fout << msh.avg(Nodes::get_v_comp, IDX_Y) << sep;
+            fout << msh.avg<Nodes::VEC_V>(IDX_Y) << sep;
             }
         if (keyVal == "<dMz/dt>")
             {
-            fout << msh.avg(Nodes::get_v_comp, IDX_Z) << sep;
+            fout << msh.avg<Nodes::VEC_V>(IDX_Z) << sep;
             }
         if (keyVal == "E_ex")
             {
@@ -108,20 +108,41 @@ void Fem::saver(Settings &settings, timing const &t_prm, ofstream &fout, const i
 
     if (save_period && (nt % save_period) == 0)
         {
-        string str = baseName + "_iter" + to_string(nt) + ".sol";
+        string str = saveConfig(settings, baseName + "_iter" + to_string(nt), t_prm.get_t(), true);
 
         if (settings.verbose)
             {
             cout << " " << str << endl;
+            cout << (settings.binarySol ? "all nodes copied." : "all nodes written.") << endl;
             }
+        }
+    }
 
-        string metadata = settings.solMetadata(t_prm.get_t(), "idx\tmx\tmy\tmz\tphi");
+std::string Fem::saveConfig(Settings const &settings, std::string const &baseName, const double t,
+                            const bool async) const
+    {
+    string metadata = settings.solMetadata(t, "idx\tmx\tmy\tmz\tphi");
+    if (!settings.binarySol)
+        {
+        string str = baseName + ".sol";
         msh.savesol(settings.getPrecision(), str, metadata);
-        if (settings.verbose)
+        return str;
+        }
+
+    string str = baseName + ".solb";
+    Snapshot::data d = msh.snapshot(t, metadata, settings.solSinglePrecision);
+    if (async)
+        { snapshots.push(str, std::move(d)); }
+    else
+        {
+        snapshots.wait();
+        if (!Snapshot::write(str, d))
             {
-            cout << "all nodes written." << endl;
+            std::cout << "cannot write file " << str << std::endl;
+            SYSTEM_ERROR;
             }
         }
+    return str;
     }
 
 void Mesh::mesh::savesol(const int precision, const std::string fileName,
@@ -138,15 +159,33 @@ void Mesh::mesh::savesol(const int precision, const std::string fileName,
          << std::setprecision(precision);
 
     Eigen::IOFormat outputSolFmt(precision, Eigen::DontAlignCols, "\t", "\t", "", "", "", "");
-    for (unsigned int i = 0; i < node.size(); i++)
+    for (int i = 0; i < node.size(); i++)
         {
-        const Node &n = node[node_index[i]];
-        fout << i << '\t' << n.u.format(outputSolFmt) << '\t' << n.phi << endl;
+        const int k = node_index[i];
+        fout << i << '\t' << node.u[k].format(outputSolFmt) << '\t' << node.phi[k] << '\n';
         }
 
     fout.close();
     }
 
+Snapshot::data Mesh::mesh::snapshot(const double t, std::string const &metadata,
+                                    const bool singlePrecision) const
+    {
+    Snapshot::data d;
+    d.t = t;
+    d.metadata = tags::sol::rw_time + ' ' + date() + '\n' + metadata;
+    d.singlePrecision = singlePrecision;
+    d.u.resize(3 * node.size());
+    d.phi.resize(node.size());
+    for (int i = 0; i < node.size(); i++)
+        {
+        const int k = node_index[i];
+        Eigen::Map<Eigen::Vector3d>(d.u.data() + 3 * i) = node.u[k];
+        d.phi[i] = node.phi[k];
+        }
+    return d;
+    }
+
 bool Mesh::mesh::savesol(const int precision, const std::string fileName,
                          std::string const &metadata, std::vector<double> const &val) const
     {
@@ -160,11 +199,11 @@ bool Mesh::mesh::savesol(const int precision, const std::string fileName,
     fout << tags::sol::rw_time << ' ' << date() << '\n' << metadata << std::scientific 
          << std::setprecision(precision);
 
-    if (node.size() == val.size())
+    if (static_cast<size_t>(node.size()) == val.size())
         {
-        for (unsigned int i = 0; i < node.size(); i++)
+        for (int i = 0; i < node.size(); i++)
             {
-            fout << i << '\t' << val[node_index[i]] << endl;
+            fout << i << '\t' << val[node_index[i]] << '\n';
             }
         }
     else
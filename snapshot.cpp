@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include "config.h"
+#include "snapshot.h"
+
+using namespace Snapshot;
+
+namespace
+    {
+/** number of values converted and written at once */
+constexpr size_t chunkSize = 1 << 16;
+
+/** writes the values of v as T, by chunks */
+template<class T>
+void writeValues(std::ofstream &out, std::vector<double> const &v)
+    {
+    if constexpr (std::is_same_v<T, double>)
+        { out.write(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(double)); }
+    else
+        {
+        std::vector<T> buf(std::min(chunkSize, v.size()));
+        for (size_t begin = 0; begin < v.size(); begin += chunkSize)
+            {
+            const size_t n = std::min(chunkSize, v.size() - begin);
+            std::copy(v.begin() + begin, v.begin() + begin + n, buf.begin());
+            out.write(reinterpret_cast<const char *>(buf.data()), n * sizeof(T));
+            }
+        }
+    }
+
+/** reads n values stored as T into v */
+template<class T>
+void readValues(std::ifstream &in, const size_t n, std::vector<double> &v)
+    {
+    v.resize(n);
+    if constexpr (std::is_same_v<T, double>)
+        { in.read(reinterpret_cast<char *>(v.data()), n * sizeof(double)); }
+    else
+        {
+        std::vector<T> buf(std::min(chunkSize, n));
+        for (size_t begin = 0; begin < n && in; begin += chunkSize)
+            {
+            const size_t m = std::min(chunkSize, n - begin);
+            in.read(reinterpret_cast<char *>(buf.data()), m * sizeof(T));
+            std::copy(buf.begin(), buf.begin() + m, v.begin() + begin);
+            }
+        }
+    }
+
+/** prints the error message and exits */
+[[noreturn]] void fail(std::string const &fileName, std::string const &what)
+    {
+    std::cerr << "error: " << what << " in snapshot " << fileName << std::endl;
+    SYSTEM_ERROR;
+    }
+
+    }  // namespace
+
+bool Snapshot::isSnapshot(std::string const &fileName)
+    {
+    std::ifstream in(fileName, std::ios::binary);
+    char m[sizeof(magic)];
+    return in.read(m, sizeof(m)) && std::memcmp(m, magic, sizeof(magic)) == 0;
+    }
+
+bool Snapshot::write(std::string const &fileName, data const &d)
+    {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    const uint32_t valueSize = d.singlePrecision ? sizeof(float) : sizeof(double);
+    const uint64_t nbNodes = d.nbNodes();
+    const uint64_t metadataSize = d.metadata.size();
+    out.write(magic, sizeof(magic));
+    out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char *>(&valueSize), sizeof(valueSize));
+    out.write(reinterpret_cast<const char *>(&nbNodes), sizeof(nbNodes));
+    out.write(reinterpret_cast<const char *>(&d.t), sizeof(d.t));
+    out.write(reinterpret_cast<const char *>(&metadataSize), sizeof(metadataSize));
+    out.write(d.metadata.data(), metadataSize);
+    if (d.singlePrecision)
+        {
+        writeValues<float>(out, d.u);
+        writeValues<float>(out, d.phi);
+        }
+    else
+        {
+        writeValues<double>(out, d.u);
+        writeValues<double>(out, d.phi);
+        }
+    out.close();
+    return !out.fail();
+    }
+
+data Snapshot::read(std::string const &fileName)
+    {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) fail(fileName, "cannot open file");
+
+    char m[sizeof(magic)];
+    uint32_t v, valueSize;
+    uint64_t nbNodes, metadataSize;
+    data d;
+    in.read(m, sizeof(m));
+    in.read(reinterpret_cast<char *>(&v), sizeof(v));
+    in.read(reinterpret_cast<char *>(&valueSize), sizeof(valueSize));
+    in.read(reinterpret_cast<char *>(&nbNodes), sizeof(nbNodes));
+    in.read(reinterpret_cast<char *>(&d.t), sizeof(d.t));
+    in.read(reinterpret_cast<char *>(&metadataSize), sizeof(metadataSize));
+    if (!in || std::memcmp(m, magic, sizeof(magic)) != 0) fail(fileName, "bad header");
+    if (v != version) fail(fileName, "unknown version " + std::to_string(v));
+    if (valueSize != sizeof(float) && valueSize != sizeof(double))
+        fail(fileName, "bad size of numbers");
+
+    // the metadata and the four values of each node must fit in the rest of the file
+    const uint64_t position = in.tellg();
+    in.seekg(0, std::ios::end);
+    const uint64_t left = (uint64_t)in.tellg() - position;
+    in.seekg(position);
+    if (metadataSize > left || nbNodes > (left - metadataSize) / (4 * valueSize))
+        fail(fileName, "sizes in the header larger than the file");
+
+    d.metadata.resize(metadataSize);
+    in.read(d.metadata.data(), metadataSize);
+    d.singlePrecision = (valueSize == sizeof(float));
+    if (d.singlePrecision)
+        {
+        readValues<float>(in, 3 * nbNodes, d.u);
+        readValues<float>(in, nbNodes, d.phi);
+        }
+    else
+        {
+        readValues<double>(in, 3 * nbNodes, d.u);
+        readValues<double>(in, nbNodes, d.phi);
+        }
+    if (!in) fail(fileName, "truncated data");
+    return d;
+    }
+
+void writer::push(std::string const &fileName, data &&d)
+    {
+    wait();
+    pendingName = fileName;
+    pending = std::async(std::launch::async,
+                         [fileName, d = std::move(d)]() { return Snapshot::write(fileName, d); });
+    }
+
+void writer::wait(void)
+    {
+    if (!pending.valid()) return;
+    if (!pending.get())
+        {
+        std::cerr << "warning: the magnetization configuration " << pendingName
+                  << " could not be written\n";
+        }
+    }
@@ -0,0 +1,75 @@
+#ifndef snapshot_h
+#define snapshot_h
+
+/** \file snapshot.h
+\brief binary magnetization configurations, the counterpart of the text .sol files. A snapshot file
+starts with a header: the magic bytes, the version of the format, the size in bytes of the numbers
+(4 or 8), the number of nodes, the time, and the text metadata of the .sol files. The header is
+followed by the contiguous arrays of the magnetization, three components per node, and of the
+potential phi, in the order of the nodes of the mesh file. Numbers are in the native byte order.
+*/
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace Snapshot
+    {
+/** magic bytes at the beginning of a snapshot file */
+constexpr char magic[8] = "FLGSOLB";
+
+/** version of the format */
+constexpr uint32_t version = 1;
+
+/** \struct data
+magnetization configuration, in the order of the nodes of the mesh file
+*/
+struct data
+    {
+    double t = 0;                 /**< time */
+    std::string metadata;         /**< text metadata, as in the header of the .sol files */
+    bool singlePrecision = false; /**< if true the numbers are written in single precision */
+    std::vector<double> u;        /**< magnetization, three components per node */
+    std::vector<double> phi;      /**< potential of the magnetic charges */
+
+    /** number of nodes */
+    inline int nbNodes(void) const { return phi.size(); }
+    };
+
+/** returns true if the file starts with the magic bytes of a snapshot */
+bool isSnapshot(std::string const &fileName /**< [in] */);
+
+/** writes the snapshot d to fileName, returns false on failure. The numbers are converted and
+ * written by chunks, without a copy of the whole arrays. */
+bool write(std::string const &fileName /**< [in] */, data const &d /**< [in] */);
+
+/** reads the snapshot fileName, exits on error */
+data read(std::string const &fileName /**< [in] */);
+
+/** \class writer
+writes the snapshots in a background thread while the computation goes on. A snapshot is written
+once the previous one is. */
+class writer
+    {
+public:
+    /** destructor, waits for the last snapshot */
+    ~writer() { wait(); }
+
+    /** starts writing the snapshot d to fileName, after the previous one */
+    void push(std::string const &fileName /**< [in] */, data &&d /**< [in] */);
+
+    /** waits for the snapshot being written, if any */
+    void wait(void);
+
+private:
+    /** snapshot being written, its result is false on failure */
+    std::future<bool> pending;
+
+    /** name of the file being written */
+    std::string pendingName;
+    };
+
+    }  // namespace Snapshot
+
+#endif
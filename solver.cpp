@@ -4,42 +4,59 @@
 #include <eigen3/Eigen/Sparse>
 #include <eigen3/Eigen/Dense>
 
-int LinAlgebra::solver(timing const &t_prm)
+bool LinAlgebra::precondIsStale(const double dt) const
+    {
+    return (precondAge < 0) || (precondAge >= precondReuseSteps)
+           || (fabs(dt - precondDt) > precondReuseDt * precondDt)
+           || (lastNbIter > precondRefreshIter);
+    }
+
+template<class Solver, class Operator>
+void LinAlgebra::factorize(Solver &s, Operator const &A, const double dt)
     {
     chronometer counter(2);
-    std::vector<Eigen::Triplet<double>> w_K_TH;
+    s.factorize(A);
 
-    std::for_each(refMsh->tet.begin(), refMsh->tet.end(),
-                      [this,&w_K_TH](Tetra::Tet &my_elem) { my_elem.assemblage_mat(NOD,w_K_TH); } );
-    
-    if (verbose)
+    if(s.info() != Eigen::Success)
+        { std::cout <<"sparse matrix factorize(): decomposition failed.\n";exit(1); }
+    else if (verbose)
         {
-        std::cout << "matrix assembly done in " << counter.millis() << std::endl;
-        counter.reset();
+        std::cout << "preconditioner " << Precond::name(s.preconditioner().getType())
+                  << " set up in " << counter.millis() << std::endl;
         }
+    precondAge = 0;
+    precondDt = dt;
+    }
 
-    K.setFromTriplets(w_K_TH.begin(),w_K_TH.end());
-    _solver.analyzePattern(K);// numerical values in K are not used
-    _solver.factorize(K);
-
-    if(_solver.info() != Eigen::Success)
-        { std::cout <<"sparse matrix factorize(): decomposition failed.\n";exit(1); }
+template<class Solver, class Operator>
+int LinAlgebra::solve(Solver &s, Operator const &A, const double dt, Eigen::VectorXd &sol)
+    {
+    bool fresh_precond = precondIsStale(dt);
+    if (fresh_precond)
+        { factorize(s, A, dt); }
     else if (verbose)
-        { std::cout << "K factorized (ILU precond) done in " << counter.millis() << std::endl; }
-
-    L_TH.setZero(2*NOD);
-    std::for_each(refMsh->tet.begin(), refMsh->tet.end(),
-                      [this](Tetra::Tet &my_elem) { my_elem.assemblage_vect(NOD,L_TH); } );
-    std::for_each(refMsh->fac.begin(), refMsh->fac.end(),
-                      [this](Facette::Fac &my_elem) { my_elem.assemblage_vect(NOD,L_TH); } );
+        { std::cout << "preconditioner reused, set up " << precondAge << " steps ago\n"; }
 
-    refMsh->buildInitGuess(X_guess);// gamma0 division handled by function buildInitGuess
-
-    counter.reset();
+    chronometer counter(2);
+    sol = s.solveWithGuess(L_TH,X_guess);
+    int nb_iter = s.iterations();
+    double solver_error= s.error();
 
-    Eigen::VectorXd sol = _solver.solveWithGuess(L_TH,X_guess);
-    int nb_iter = _solver.iterations();
-    double solver_error= _solver.error();
+    if ( !fresh_precond && ((nb_iter > MAXITER) || (solver_error > TOL)) )
+        {// the reused preconditioner may be too far from K, try again with a fresh one
+        if (verbose)
+            {
+            std::cout << "solver: bicgstab FAILED with reused preconditioner after " << nb_iter
+            << " iterations, in " << counter.millis() << std::endl;
+            }
+        factorize(s, A, dt);
+        counter.reset();
+        sol = s.solveWithGuess(L_TH,X_guess);
+        nb_iter = s.iterations();
+        solver_error= s.error();
+        }
+    precondAge++;
+    lastNbIter = nb_iter;
 
     if( (nb_iter > MAXITER) || (solver_error > TOL) )
         {
@@ -56,6 +73,32 @@ int LinAlgebra::solver(timing const &t_prm)
             std::cout << "solver: bicgstab converged in " << nb_iter
             << " iterations, " << counter.millis() << std::endl;
             }
+    return 0;
+    }
+
+int LinAlgebra::solver(timing const &t_prm)
+    {
+    if (!matrixFree)
+        {
+        chronometer counter(2);
+        assembler.assemble(refMsh->tet, K);
+
+        if (verbose)
+            { std::cout << "matrix assembly done in " << counter.millis() << std::endl; }
+        }
+
+    L_TH.setZero(2*NOD);
+    assembler.assemble(refMsh->tet, L_TH);
+    std::for_each(refMsh->fac.begin(), refMsh->fac.end(),
+                      [this](Facette::Fac &my_elem) { my_elem.assemblage_vect(NOD,L_TH); } );
+
+    refMsh->buildInitGuess(X_guess);// gamma0 division handled by function buildInitGuess
+
+    Eigen::VectorXd sol;
+    const double dt = t_prm.get_dt();
+    int err = matrixFree ? solve(_mfSolver, mfOp, dt, sol) : solve(_solver, K, dt, sol);
+    if (err)
+        { return 1; }
 
     v_max = refMsh->updateNodes(sol, t_prm.get_dt());//gamma0 multiplication handled by updateNodes
     return 0;
@@ -17,7 +17,7 @@ class Surf
     {
 public:
     /** constructor used by readMesh */
-    inline Surf(const std::vector<Nodes::Node> &_p_node /**< [in] vector of nodes */,
+    inline Surf(const Nodes::Store &_p_node /**< [in] nodes storage */,
                 const std::string _name /**< [in] physical name from mesh */
                 )
         : name(_name), refNode(_p_node)
@@ -41,7 +41,7 @@ private:
     const std::string name;
 
     /** direct access to the Nodes */
-    const std::vector<Nodes::Node> &refNode;
+    const Nodes::Store &refNode;
 
     };  // end class Surf
 
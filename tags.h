@@ -27,10 +27,15 @@ namespace tags
     namespace msh
         {
         const std::string format = "$MeshFormat";
+        const std::string end_format = "$EndMeshFormat";
         const std::string version = "2.2";
+        const std::string version41 = "4.1";
         const std::string begin_physical_names = "$PhysicalNames";
         const std::string end_physical_names = "$EndPhysicalNames";
+        const std::string begin_entities = "$Entities";
+        const std::string end_entities = "$EndEntities";
         const std::string begin_nodes = "$Nodes";
+        const std::string end_nodes = "$EndNodes";
         const std::string begin_elements = "$Elements";
         const std::string end_elements = "$EndElements";
 
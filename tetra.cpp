@@ -15,14 +15,16 @@ using namespace Nodes;
 void Tet::lumping(Eigen::Ref<Eigen::Matrix<double,NPI,1>> alpha_eff, double prefactor,
                   Eigen::Ref<Eigen::Matrix<double,3*N,3*N>> AE ) const
     {
+    const Eigen::Matrix<double,NPI,1> w = weights();
+    // the gradients of the hat functions are constant, the exchange contribution is integrated once
+    const Eigen::Matrix<double,N,N> stiffness = (w.sum() * prefactor) * (da() * da().transpose());
+
     for(int npi = 0; npi < NPI; npi++)
         {
-        const double w = weight[npi];
-
         for (int i = 0; i < N; i++)
             {
-            const double ai_w = w * a[i][npi];
-            const Eigen::Vector3d ai_w_u0 = ai_w * Nodes::get_u0(getNode(i));
+            const double ai_w = w[npi] * a[i][npi];
+            const Eigen::Vector3d ai_w_u0 = ai_w * getNode<Nodes::VEC_U0>(i);
 
             AE(i,i) += alpha_eff(npi) * ai_w;
             AE(N + i,N + i) += alpha_eff(npi) * ai_w;
@@ -34,19 +36,10 @@ void Tet::lumping(Eigen::Ref<Eigen::Matrix<double,NPI,1>> alpha_eff, double pref
             AE(N + i, 2*N + i) -= ai_w_u0(IDX_X);
             AE(2*N + i, N + i) += ai_w_u0(IDX_X);
             AE(2*N + i, i) -= ai_w_u0(IDX_Y);
-
-            for (int j = 0; j < N; j++)
-                {
-                double contrib = w * prefactor
-                                 * (dadx(i,npi) * dadx(j,npi) + dady(i,npi) * dady(j,npi)
-                                    + dadz(i,npi) * dadz(j,npi));
-
-                AE(i,j) += contrib;
-                AE(N + i,N + j) += contrib;
-                AE(2*N + i,2*N + j) += contrib;
-                }
             }
         }
+    for (int k = 0; k < DIM; k++)
+        { AE.block<N,N>(k*N, k*N) += stiffness; }
     }
 
 void Tet::add_drift_BE(double alpha, double s_dt, double Vdrift,
@@ -65,7 +58,7 @@ void Tet::add_drift_BE(double alpha, double s_dt, double Vdrift,
             interim.col(i) = a[i][npi]*( alpha*dUd_.col(npi) + U.col(npi).cross(dUd_.col(npi))
                     + s_dt*(alpha*dVd_.col(npi) + U.col(npi).cross(dVd_.col(npi)) + V.col(npi).cross(dUd_.col(npi))) );
             }
-        BE += Vdrift*weight[npi]*interim;
+        BE += Vdrift*weight(npi)*interim;
         }
     }
 
@@ -104,8 +97,31 @@ Eigen::Matrix<double,NPI,1> Tet::calc_aniso_cub(Eigen::Ref<const Eigen::Vector3d
     return -K3bis*result;
     }
 
+void Tet::add_stt_BE(sttTerms const &stt, const double Js,
+                     Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> U,
+                     Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> dUdx,
+                     Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> dUdy,
+                     Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> dUdz,
+                     Eigen::Ref<Eigen::Matrix<double,DIM,N>> BE) const
+    {
+    const double prefactor = stt.D0 / sq(stt.lJ) / (gamma0 * nu0 * Js); //nu0*Js shall be replaced by Ms
+    Eigen::Vector3d const &gV = stt.gradV[idx];
+    Eigen::Matrix<double,DIM,NPI> const &Hm = stt.Hm[idx];
+
+    for (int npi = 0; npi < NPI; npi++)
+        {
+        const Eigen::Vector3d j_grad_u = -stt.sigma * (gV.x() * dUdx.col(npi) + gV.y() * dUdy.col(npi)
+                                                       + gV.z() * dUdz.col(npi));
+        const Eigen::Vector3d m = stt.pf * (stt.ksi * j_grad_u + U.col(npi).cross(j_grad_u));
+        const Eigen::Vector3d h = weight(npi) * (Hm.col(npi) + prefactor * m);
+        for (int i = 0; i < N; i++)
+            { BE.col(i) += a[i][npi] * h; }
+        }
+    }
+
 void Tet::integrales(Tetra::prm const &param, timing const &prm_t,
-                     Eigen::Vector3d const &Hext, Nodes::index idx_dir, double Vdrift)
+                     Eigen::Vector3d const &Hext, Nodes::index idx_dir, double Vdrift, Energies *E,
+                     sttTerms const *stt)
     {
     const double alpha = param.alpha_LLG;
     const double Js = param.J;
@@ -118,20 +134,30 @@ void Tet::integrales(Tetra::prm const &param, timing const &prm_t,
 
     /*-------------------- INTERPOLATION --------------------*/
     Eigen::Matrix<double,DIM,NPI> U,dUdx,dUdy,dUdz;
-    interpolation(Nodes::get_u0, U, dUdx, dUdy, dUdz);
+    interpolation<Nodes::VEC_U0>(U, dUdx, dUdy, dUdz);
     Eigen::Matrix<double,DIM,NPI> V,dVdx,dVdy,dVdz;
-    interpolation(Nodes::get_v0, V, dVdx, dVdy, dVdz);
+    interpolation<Nodes::VEC_V0>(V, dVdx, dVdy, dVdz);
     /*
     devNote: we should not compute all dVd(x|y|z).
     Only one of them is used by add_drift_BE, which is idx_dir dependent
     */
 
     Eigen::Matrix<double,DIM,NPI> Hd;
-    interpolation_field(Nodes::get_phi0, Hd);
+    interpolation_field<Nodes::SCAL_PHI0>(Hd);
     Eigen::Matrix<double,DIM,NPI> Hv;
-    interpolation_field(Nodes::get_phiv0, Hv);
+    interpolation_field<Nodes::SCAL_PHIV0>(Hv);
     /*-------------------- END INTERPOLATION ----------------*/
 
+    if (E != nullptr)
+        {
+        Eigen::Matrix<double,NPI,1> phi;
+        interpolation<Nodes::SCAL_PHI0>(phi);
+        E->exch = exchangeEnergy(param, dUdx, dUdy, dUdz);
+        E->demag = demagEnergy(dUdx, dUdy, dUdz, phi);
+        E->aniso = ((param.K != 0.0) || (param.K3 != 0.0)) ? anisotropyEnergy(param, U) : 0.0;
+        E->zeeman = zeemanEnergy(param, Hext, U);
+        }
+
     Eigen::Matrix<double,DIM,NPI> H_aniso;
     H_aniso.setZero();
     Eigen::Matrix<double,NPI,1> uHeff = U.transpose() * Hext;
@@ -149,7 +175,8 @@ void Tet::integrales(Tetra::prm const &param, timing const &prm_t,
     uHeff -= Abis *( dUdx.colwise().squaredNorm() + dUdy.colwise().squaredNorm() + dUdz.colwise().squaredNorm());
 
     Eigen::Matrix<double,DIM,NPI> Heff = Hd;
-    extraField(Heff);// extraField do a +=like for STT contrib on Heff
+    if (stt != nullptr)
+        { Heff += stt->Hm[idx]; }
     uHeff += (U.cwiseProduct(Heff)).colwise().sum();//dot product on each col of U and Heff
 
     Eigen::Matrix<double,NPI,1> a_eff = calc_alpha_eff(dt, alpha, uHeff);
@@ -177,14 +204,15 @@ void Tet::integrales(Tetra::prm const &param, timing const &prm_t,
     
     for (int npi = 0; npi < NPI; npi++)
         {
-        const double w = weight[npi];
+        const double w = weight(npi);
         for (int i = 0; i < N; i++)
             {
-            BE.col(i) -= w*Abis*(da(i,0)*dUdx.col(npi) + da(i,1)*dUdy.col(npi) + da(i,2)*dUdz.col(npi));
+            BE.col(i) -= w*Abis*(da()(i,0)*dUdx.col(npi) + da()(i,1)*dUdy.col(npi) + da()(i,2)*dUdz.col(npi));
             BE.col(i) += w*a[i][npi]*H.col(npi);
             }
         }
-    extraCoeffs_BE(Js, U, dUdx, dUdy, dUdz, BE);  // STT
+    if (stt != nullptr)
+        { add_stt_BE(*stt, Js, U, dUdx, dUdy, dUdz, BE); }
 
     /*--------------------   PROJECTION: BE->Lp   --------------------*/
     #if EIGEN_VERSION_AT_LEAST(3,4,0)
@@ -206,7 +234,7 @@ double Tet::exchangeEnergy(Tetra::prm const &param,
     Eigen::Matrix<double,NPI,1> dens = dudx.colwise().squaredNorm()
                                      + dudy.colwise().squaredNorm()
                                      + dudz.colwise().squaredNorm();
-    return param.A * weight.dot(dens);
+    return param.A * weights().dot(dens);
     }
 
 double Tet::anisotropyEnergy(Tetra::prm const &param, Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> u) const
@@ -228,18 +256,14 @@ double Tet::anisotropyEnergy(Tetra::prm const &param, Eigen::Ref<Eigen::Matrix<d
                      * (sq(al0 * al1) + sq(al1 * al2) + sq(al2 * al0));  // cubic anisotropy (K3)
         }
 
-    return weight.dot(dens);
+    return weights().dot(dens);
     }
 
-Eigen::Matrix<double,NPI,1> Tet::charges(std::function<Eigen::Vector3d(Nodes::Node)> getter) const
+Eigen::Matrix<double,NPI,1> Tet::charges(std::function<Eigen::Vector3d(Nodes::Node const &)> getter) const
     {
     Eigen::Matrix<double,DIM,NPI> dudx,dudy,dudz;
     interpolation(getter,dudx,dudy,dudz);
-    
-    Eigen::Matrix<double,NPI,1> result;
-    for (int j = 0; j < NPI; j++)
-        { result(j) = dudx(0,j) + dudy(1,j) + dudz(2,j); }
-    return -Ms*weight.cwiseProduct(result);
+    return volumeCharges(dudx,dudy,dudz);
     }
 
 double Tet::demagEnergy(Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> dudx,
@@ -251,22 +275,22 @@ double Tet::demagEnergy(Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> dudx,
 
     for (int npi = 0; npi < NPI; npi++)
         { dens[npi] = (dudx(0,npi) + dudy(1,npi) + dudz(2,npi)) * phi[npi]; }
-    return -0.5*mu0*Ms*weight.dot(dens);
+    return -0.5*mu0*Ms*weights().dot(dens);
     }
 
-double Tet::zeemanEnergy(Tetra::prm const &param, Eigen::Ref<Eigen::Vector3d> const Hext,
+double Tet::zeemanEnergy(Tetra::prm const &param, Eigen::Ref<const Eigen::Vector3d> Hext,
                         Eigen::Ref<Eigen::Matrix<double,DIM,NPI>> const u) const
     {
     Eigen::Matrix<double,NPI,1> dens = u.transpose() * Hext;
 
-    return -param.J*weight.dot(dens);
+    return -param.J*weights().dot(dens);
     }
 
 double Tet::Jacobian(Eigen::Ref<Eigen::Matrix3d> J)
     {
-    Eigen::Vector3d p0p1 = getNode(1).p - getNode(0).p;
-    Eigen::Vector3d p0p2 = getNode(2).p - getNode(0).p;
-    Eigen::Vector3d p0p3 = getNode(3).p - getNode(0).p;
+    Eigen::Vector3d p0p1 = getNode<Nodes::VEC_P>(1) - getNode<Nodes::VEC_P>(0);
+    Eigen::Vector3d p0p2 = getNode<Nodes::VEC_P>(2) - getNode<Nodes::VEC_P>(0);
+    Eigen::Vector3d p0p3 = getNode<Nodes::VEC_P>(3) - getNode<Nodes::VEC_P>(0);
     J(0,0) = p0p1.x();
     J(0,1) = p0p2.x();
     J(0,2) = p0p3.x();
@@ -281,9 +305,9 @@ double Tet::Jacobian(Eigen::Ref<Eigen::Matrix3d> J)
 
 double Tet::calc_vol(void) const
     {
-    Eigen::Vector3d p0p1 = getNode(1).p - getNode(0).p;
-    Eigen::Vector3d p0p2 = getNode(2).p - getNode(0).p;
-    Eigen::Vector3d p0p3 = getNode(3).p - getNode(0).p;
+    Eigen::Vector3d p0p1 = getNode<Nodes::VEC_P>(1) - getNode<Nodes::VEC_P>(0);
+    Eigen::Vector3d p0p2 = getNode<Nodes::VEC_P>(2) - getNode<Nodes::VEC_P>(0);
+    Eigen::Vector3d p0p3 = getNode<Nodes::VEC_P>(3) - getNode<Nodes::VEC_P>(0);
 
     return p0p1.dot(p0p2.cross(p0p3))/6.0;
     }
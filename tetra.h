@@ -96,6 +96,36 @@ struct prm
         };
     };
 
+/** \struct sttTerms
+contributions of the spin transfer torque (Thiaville model) to the integrales of the tetrahedrons. The
+tables gradV and Hm are dense, indexed by Tet::idx, they are filled by electrostatSolver from the
+electrostatic potential
+*/
+struct sttTerms
+    {
+    double sigma; /**< conductivity */
+    double ksi;   /**< \f$ \xi = (l_J/l_{sf})^2 \f$, \f$ \beta_{DW} \f$ in Thiaville notations */
+    double pf;    /**< prefactor of the torque */
+    double D0;    /**< diffusion coefficient */
+    double lJ;    /**< length */
+
+    /** gradient of the electrostatic potential, constant over each tetrahedron */
+    std::vector<Eigen::Vector3d> gradV;
+
+    /** Oersted like field of the current at the Gauss points of each tetrahedron */
+    std::vector<Eigen::Matrix<double,Nodes::DIM,NPI>> Hm;
+    };
+
+/** \struct geometry
+geometry of a tetrahedron: the gradients of its hat functions and the determinant of its jacobian.
+The geometries of all the tetrahedrons are stored contiguously in a table, outside of the Tet objects
+*/
+struct geometry
+    {
+    Eigen::Matrix<double,N,Nodes::DIM> da; /**< gradients of the hat functions, row i for node i */
+    double detJ;                           /**< determinant of the jacobian */
+    };
+
 /** \class Tet
 Tet is a tetrahedron, containing the index references to nodes, must not be flat <br>
 indices convention is<br>
@@ -123,17 +153,21 @@ indices convention is<br>
 class Tet : public element<N,NPI>
     {
 public:
-    /** constructor. It initializes weight hat function with weights \f$ w_i = |J| p_i \f$
-    with  \f$ p_i = pds[i] = (D,E,E,E,E) \f$ and dad(x|y|z) if \f$ | detJ | < \epsilon \f$ jacobian
-    is considered degenerated unit tests : Tet_constructor; Tet_inner_tables
+    /** constructor. It computes the geometry of the tetrahedron: the gradients of the hat functions
+    da = dadu * inverse(Jacobian), and \f$ |J| \f$, and appends it to the geometry table _geom. If
+    \f$ | detJ | < \epsilon \f$ jacobian is considered degenerated unit tests : Tet_constructor;
+    Tet_inner_tables
     */
-    inline Tet(const std::vector<Nodes::Node> &_p_node /**< vector of nodes */,
+    inline Tet(const Nodes::Store &_p_node /**< nodes storage */,
+               std::vector<geometry> &_geom /**< [in|out] geometry table */,
                const int _idx /**< [in] region index in region vector */,
                std::initializer_list<int> _i /**< [in] node index */)
-        : element<N,NPI>(_p_node,_idx,_i), idx(0)
+        : element<N,NPI>(_p_node,_idx,_i), idx(0), refGeom(_geom), idxGeom(_geom.size())
         {
         zeroBasing();
-        da.setZero();
+        geometry g;
+        g.da.setZero();
+        g.detJ = 0;
 
         if (existNodes())
             {
@@ -141,9 +175,9 @@ public:
 
             Eigen::Matrix3d J;
             // we have to rebuild the jacobian in case of ill oriented tetrahedron
-            double detJ = Jacobian(J);
+            g.detJ = Jacobian(J);
 
-            if (fabs(detJ) < Tetra::epsilon)
+            if (fabs(g.detJ) < Tetra::epsilon)
                 {
                 std::cerr << "Singular jacobian in tetrahedron" << std::endl;
                 element::infos();
@@ -151,112 +185,133 @@ public:
                 }
             Eigen::Matrix<double,N,Nodes::DIM> dadu;
             dadu << -1., -1., -1., 1., 0., 0., 0., 1., 0., 0., 0., 1.;
-            da = dadu * J.inverse();
-
-            for (int j = 0; j < NPI; j++)
-                {
-                for (int i = 0; i < N; i++)
-                    {
-                    dadx(i,j) = da(i,0);
-                    dady(i,j) = da(i,1);
-                    dadz(i,j) = da(i,2);
-                    }
-                weight[j] = detJ * Tetra::pds[j];
-                }
+            g.da = dadu * J.inverse();
             }
-        // do nothing lambda's (usefull for spin transfer torque)
-        extraField = [] ( Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,Tetra::NPI>> ) {};
-        extraCoeffs_BE = [](double, Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>>,
-                            Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>>,
-                            Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>>,
-                            Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>>,
-                            Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,N>>) {};
+        _geom.push_back(g);
         }
 
-    /** variations of hat function along x directions */
-    Eigen::Matrix<double,N,NPI> dadx;
+    /** constructor of a tetrahedron whose geometry is already in the table _geom at index
+    _idxGeom, as read from the mesh cache. The node indices are zero based and oriented. */
+    inline Tet(const Nodes::Store &_p_node /**< nodes storage */,
+               std::vector<geometry> const &_geom /**< [in] geometry table */,
+               const int _idx /**< [in] region index in region vector */,
+               std::initializer_list<int> _i /**< [in] zero based node index */,
+               const int _idxGeom /**< [in] index of the geometry in _geom */)
+        : element<N,NPI>(_p_node,_idx,_i), idx(0), refGeom(_geom), idxGeom(_idxGeom)
+        {}
+
+    /** gradients of the hat functions, row i for node ind[i], constant over the tetrahedron */
+    inline const Eigen::Matrix<double,N,Nodes::DIM> &da(void) const { return refGeom[idxGeom].da; }
+
+    /** determinant of the jacobian */
+    inline double detJ(void) const { return refGeom[idxGeom].detJ; }
+
+    /** variation of hat function i along x direction, the same for all Gauss points npi */
+    inline double dadx(const int i, [[maybe_unused]] const int npi) const { return da()(i,Nodes::IDX_X); }
+
+    /** variation of hat function i along y direction, the same for all Gauss points npi */
+    inline double dady(const int i, [[maybe_unused]] const int npi) const { return da()(i,Nodes::IDX_Y); }
+
+    /** variation of hat function i along z direction, the same for all Gauss points npi */
+    inline double dadz(const int i, [[maybe_unused]] const int npi) const { return da()(i,Nodes::IDX_Z); }
+
+    /** weight of the Gauss point npi \f$ w_{npi} = |J| p_{npi} \f$ with \f$ p = pds = (D,E,E,E,E) \f$ */
+    inline double weight(const int npi) const { return detJ() * Tetra::pds[npi]; }
+
+    /** weights of the Gauss points */
+    inline Eigen::Matrix<double,NPI,1> weights(void) const
+        { return detJ() * Eigen::Map<const Eigen::Matrix<double,NPI,1>>(Tetra::pds); }
+
+    /** interpolation for the scalar field F of the nodes, the field is selected at compile time */
+    template<Nodes::scalarField F>
+    inline void interpolation(Eigen::Ref<Eigen::Matrix<double,NPI,1>> result) const
+        {
+        result = gather<F>().transpose() * eigen_a;
+        }
+
+    /** interpolation for the 3D vector field F of the nodes and its gradient tensor */
+    template<Nodes::vectorField F>
+    inline void interpolation(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> result,
+                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tx,
+                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Ty,
+                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tz) const
+        {
+        const Eigen::Matrix<double,Nodes::DIM,N> vec_nod = gather<F>();
+        result = vec_nod * eigen_a;
+        gradTensor(vec_nod, Tx, Ty, Tz);
+        }
+
+    /** interpolation for the gradient tensor of the 3D vector field F of the nodes */
+    template<Nodes::vectorField F>
+    inline void interpolation(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tx,
+                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Ty,
+                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tz) const
+        {
+        gradTensor(gather<F>(), Tx, Ty, Tz);
+        }
 
-    /** variations of hat function along y directions */
-    Eigen::Matrix<double,N,NPI> dady;
+    /** interpolation for the field \f$ -\nabla F \f$ of the scalar field F of the nodes */
+    template<Nodes::scalarField F>
+    inline void interpolation_field(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> X) const
+        {
+        gradField(gather<F>(), X);
+        }
 
-    /** variations of hat function along z directions */
-    Eigen::Matrix<double,N,NPI> dadz;
+    /** interpolation for the component idx of the 3D vector field F of the nodes */
+    template<Nodes::vectorField F>
+    inline void interpolation(Nodes::index idx,
+                              Eigen::Ref<Eigen::Matrix<double,Tetra::NPI,1>> result) const
+        {
+        result = gather<F>().row(idx) * eigen_a;
+        }
 
     /** interpolation for scalar field : the getter function is given as a parameter in order to
-     * know what part of the node you want to interpolate */
-    inline void interpolation(std::function<double(Nodes::Node)> getter,
+     * know what part of the node you want to interpolate. Prefer interpolation<F>() in hot loops */
+    inline void interpolation(std::function<double(Nodes::Node const &)> getter,
                               Eigen::Ref<Eigen::Matrix<double,NPI,1>> result) const
         {
-        Eigen::Matrix<double,N,1> scalar_nod;
-        for (int i = 0; i < N; i++) scalar_nod(i) = getter(getNode(i));
-        result = scalar_nod.transpose() * eigen_a;
+        result = gather(getter).transpose() * eigen_a;
         }
 
     /** interpolation for 3D vector field and a tensor : getter function is given as a parameter to
-     * know what part of the node you want to interpolate */
-
-    inline void interpolation(std::function<Eigen::Vector3d(Nodes::Node)> getter,
+     * know what part of the node you want to interpolate. Prefer interpolation<F>() in hot loops */
+    inline void interpolation(std::function<Eigen::Vector3d(Nodes::Node const &)> getter,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> result,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tx,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Ty,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tz) const
         {
-        Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
-        for (int i = 0; i < N; i++) vec_nod.col(i) = getter(getNode(i));
-        
+        const Eigen::Matrix<double,Nodes::DIM,N> vec_nod = gather(getter);
         result = vec_nod * eigen_a;
-        Tx = vec_nod * dadx;
-        Ty = vec_nod * dady;
-        Tz = vec_nod * dadz;
+        gradTensor(vec_nod, Tx, Ty, Tz);
         }
 
     /** interpolation for a tensor : getter function is given as a parameter to
-     * know what part of the node you want to interpolate */
-
-    inline void interpolation(std::function<Eigen::Vector3d(Nodes::Node)> getter,
+     * know what part of the node you want to interpolate. Prefer interpolation<F>() in hot loops */
+    inline void interpolation(std::function<Eigen::Vector3d(Nodes::Node const &)> getter,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tx,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Ty,
                               Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tz) const
         {
-        Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
-        for (int i = 0; i < N; i++) vec_nod.col(i) = getter(getNode(i));
-
-        Tx = vec_nod * dadx;
-        Ty = vec_nod * dady;
-        Tz = vec_nod * dadz;
+        gradTensor(gather(getter), Tx, Ty, Tz);
         }
 
     /** interpolation for components of a field : the getter function is given as a parameter in
-     * order to know what part of the node you want to interpolate */
-    inline void interpolation_field(std::function<double(Nodes::Node)> getter,
+     * order to know what part of the node you want to interpolate. Prefer interpolation_field<F>()
+     * in hot loops */
+    inline void interpolation_field(std::function<double(Nodes::Node const &)> getter,
                                     Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> X) const
         {
-        Eigen::Matrix<double,N,1> scalar_nod;
-        for (int i = 0; i < N; i++) scalar_nod(i) = getter(getNode(i));
-        
-        X.setZero();
-        for (int j = 0; j < NPI; j++)
-            {
-            for (int i = 0; i < N; i++)
-                {
-                X.col(j) -= (scalar_nod[i] * Eigen::Vector3d(dadx(i,j), dady(i,j), dadz(i,j)));
-                }
-            }
+        gradField(gather(getter), X);
         }
 
     /** interpolation for the component idx of a field : the getter function is given as a parameter in order to
-     * know what part of the node you want to interpolate */
-
-    inline void interpolation(std::function<double(Nodes::Node, Nodes::index)> getter, Nodes::index idx,
+     * know what part of the node you want to interpolate. Prefer interpolation<F>(idx, result) in hot loops */
+    inline void interpolation(std::function<double(Nodes::Node const &, Nodes::index)> getter, Nodes::index idx,
                               Eigen::Ref<Eigen::Matrix<double,Tetra::NPI,1>> result) const
         {
-        Eigen::Matrix<double,N,1> scalar_nod;
-
-        for (int i = 0; i < N; i++)
-            {
-            scalar_nod[i] = getter(getNode(i),idx);
-            }
-        result = scalar_nod.transpose() * eigen_a;
+        result = gather([&getter, idx](Nodes::Node const &n) { return getter(n, idx); }).transpose()
+                 * eigen_a;
         }
 
     /** AE matrix filling */
@@ -289,10 +344,22 @@ public:
                                                Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> V,
                                                Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> H_aniso) const;
 
-    /** computes the integral contribution of the tetrahedron to the evolution of the magnetization
+    /** add the spin transfer torque contribution to vectors BE */
+    void add_stt_BE(sttTerms const &stt, const double Js,
+                    Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> U,
+                    Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dUdx,
+                    Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dUdy,
+                    Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dUdz,
+                    Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,N>> BE) const;
+
+    /** computes the integral contribution of the tetrahedron to the evolution of the magnetization.
+    If E is not null, it is set to the energies of the tetrahedron for magnetization u0 and potential
+    phi0, computed from the same interpolations. If stt is not null, the spin transfer torque
+    contributions of the tetrahedron idx are added
      */
     void integrales( Tetra::prm const &param, timing const &prm_t,
-                    Eigen::Vector3d const &Hext, Nodes::index idx_dir, double Vdrift);
+                    Eigen::Vector3d const &Hext, Nodes::index idx_dir, double Vdrift,
+                    Energies *E = nullptr, sttTerms const *stt = nullptr);
 
     /** exchange energy of the tetrahedron */
     double exchangeEnergy(Tetra::prm const &param,
@@ -303,8 +370,17 @@ public:
     /** anisotropy energy of the tetrahedron */
     double anisotropyEnergy(Tetra::prm const &param, Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> u) const;
 
-    /** return volume charges  */
-    Eigen::Matrix<double,NPI,1> charges(std::function<Eigen::Vector3d(Nodes::Node)> getter) const;
+    /** return volume charges of the vector field F */
+    template<Nodes::vectorField F>
+    Eigen::Matrix<double,NPI,1> charges(void) const
+        {
+        Eigen::Matrix<double,Nodes::DIM,NPI> dudx,dudy,dudz;
+        interpolation<F>(dudx,dudy,dudz);
+        return volumeCharges(dudx,dudy,dudz);
+        }
+
+    /** return volume charges, the vector field is given by a getter at runtime */
+    Eigen::Matrix<double,NPI,1> charges(std::function<Eigen::Vector3d(Nodes::Node const &)> getter) const;
 
     /** demagnetizing energy of the tetrahedron */
     double demagEnergy(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dudx,
@@ -313,7 +389,7 @@ public:
                        Eigen::Ref<Eigen::Matrix<double,NPI,1>> phi) const;
 
     /** zeeman energy of the tetrahedron */
-    double zeemanEnergy(Tetra::prm const &param, Eigen::Ref<Eigen::Vector3d> const Hext,
+    double zeemanEnergy(Tetra::prm const &param, Eigen::Ref<const Eigen::Vector3d> Hext,
                         Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> const u) const;
 
     /** \return \f$ |J| \f$ build Jacobian \f$ J \f$ */
@@ -325,30 +401,54 @@ public:
     /** idx is the index of the tetrahedron in the vector of tetrahedron */
     int idx;
 
-    /** for extra contribution to the effective field, such as spin transfert torque Hm */
-    std::function<void( Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> H)> extraField;
-
-    /** for extra contribution to the matrix BE, such as spin transfer torque contribs */
-    std::function<void(double Js, Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> U,
-                       Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dUdx,
-                       Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dUdy,
-                       Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dUdz,
-                       Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,N>> BE)> extraCoeffs_BE;
-
     /** returns gauss points in result = vec_nod*Tetra::a  */
     void getPtGauss(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> result) const
         {
         Eigen::Matrix<double,Nodes::DIM,N> vec_nod;
         for (int i = 0; i < N; i++)
             {
-            vec_nod.col(i) << getNode(i).p;
+            vec_nod.col(i) << getNode<Nodes::VEC_P>(i);
             }
         result = vec_nod * eigen_a;
         }
 
 private:
-    /** local hat functions matrix, initialized by constructor: da = dadu * inverse(Jacobian) */
-    Eigen::Matrix<double,N,Nodes::DIM> da;
+    /** geometry table of the tetrahedrons */
+    const std::vector<geometry> &refGeom;
+
+    /** index of the geometry of the tetrahedron in refGeom */
+    int idxGeom;
+
+    /** gradient tensor of the 3D vector field given by its values at the nodes, the same for all
+     * Gauss points */
+    inline void gradTensor(Eigen::Matrix<double,Nodes::DIM,N> const &vec_nod,
+                           Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tx,
+                           Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Ty,
+                           Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> Tz) const
+        {
+        const Eigen::Matrix3d grad = vec_nod * da();
+        Tx.colwise() = grad.col(Nodes::IDX_X);
+        Ty.colwise() = grad.col(Nodes::IDX_Y);
+        Tz.colwise() = grad.col(Nodes::IDX_Z);
+        }
+
+    /** X = - gradient of the scalar field given by its values at the nodes */
+    inline void gradField(Eigen::Matrix<double,N,1> const &scalar_nod,
+                          Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> X) const
+        {
+        X.colwise() = -da().transpose() * scalar_nod;
+        }
+
+    /** volume charges from the gradient tensor of the magnetization */
+    Eigen::Matrix<double,NPI,1> volumeCharges(Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dudx,
+                                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dudy,
+                                              Eigen::Ref<Eigen::Matrix<double,Nodes::DIM,NPI>> dudz) const
+        {
+        Eigen::Matrix<double,NPI,1> result;
+        for (int j = 0; j < NPI; j++)
+            { result(j) = dudx(0,j) + dudy(1,j) + dudz(2,j); }
+        return -Ms*weights().cwiseProduct(result);
+        }
 
     void orientate(void)
         {
@@ -0,0 +1,385 @@
+#ifndef tetra_batch_h
+#define tetra_batch_h
+
+/** \file tetra_batch.h
+\brief batched version of Tet::integrales
+<br> The tetrahedrons are processed by batches of L elements sharing the same material parameters. The nodal data of
+the elements are gathered in a struct of arrays: each quantity is an Eigen array of L lanes, one lane per element, so
+that the arithmetic of the integrales is vectorized across the elements. The gradients of the hat functions being
+constant on a tetrahedron, the gradients of the interpolated fields are computed once per element instead of once per
+Gauss point.
+*/
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+
+#include "config.h"
+#include "tetra.h"
+
+namespace Tetra
+    {
+/** \struct batch
+indices of L tetrahedrons sharing the same material parameters, the unused lanes of the last batch of a region
+repeat its last tetrahedron */
+template<int L>
+struct batch
+    {
+    int idxPrm;            /**< index of the material parameters of the tetrahedrons */
+    int nb;                /**< number of valid lanes */
+    std::array<int, L> idx; /**< indices of the tetrahedrons in the mesh */
+    };
+
+/** builds the batches of L tetrahedrons, the tetrahedrons are grouped by region, in increasing order */
+template<int L>
+std::vector<batch<L>> makeBatches(std::vector<Tet> const &tet)
+    {
+    std::map<int, std::vector<int>> regions;
+    for (int k = 0; k < (int)tet.size(); k++)
+        { regions[tet[k].idxPrm].push_back(k); }
+
+    std::vector<batch<L>> result;
+    for (auto const &[idxPrm, list] : regions)
+        {
+        for (size_t first = 0; first < list.size(); first += L)
+            {
+            batch<L> b;
+            b.idxPrm = idxPrm;
+            b.nb = std::min<int>(L, list.size() - first);
+            for (int l = 0; l < L; l++)
+                { b.idx[l] = list[first + std::min(l, b.nb - 1)]; }
+            result.push_back(b);
+            }
+        }
+    return result;
+    }
+
+/** computes the same Kp, Lp (and energies if tetE is not null, spin transfer torque contributions if stt is not
+null) as Tet::integrales for the tetrahedrons of the batch b, tetE should hold as many elements as tet */
+template<int L>
+void integrales(batch<L> const &b /**< [in] */, std::vector<Tet> &tet /**< [in|out] */,
+                prm const &param /**< [in] */, timing const &prm_t /**< [in] */,
+                Eigen::Vector3d const &Hext /**< [in] */, Nodes::index idx_dir /**< [in] */,
+                double Vdrift /**< [in] */, Energies *tetE = nullptr /**< [out] */,
+                sttTerms const *stt = nullptr /**< [in] */)
+    {
+    typedef Eigen::Array<double, L, 1> lanes;
+    const int DIM = Nodes::DIM;
+
+    const double alpha = param.alpha_LLG;
+    const double Js = param.J;
+    const double Abis = 2.0 * param.A / Js;
+    const double dt = prm_t.get_dt();
+    const double s_dt = THETA * dt * gamma0;  // theta from theta scheme in config.h.in
+
+    /*-------------------- GATHER --------------------*/
+    lanes u0[DIM][N], v0[DIM][N], ep[DIM][N], eq[DIM][N], phi0[N], phiv0[N], da[N][DIM], w[NPI], Ms;
+    for (int l = 0; l < L; l++)
+        {
+        Tet const &te = tet[b.idx[l]];
+        const Eigen::Matrix<double, Nodes::DIM, N> U0 = te.gather<Nodes::VEC_U0>();
+        const Eigen::Matrix<double, Nodes::DIM, N> V0 = te.gather<Nodes::VEC_V0>();
+        const Eigen::Matrix<double, Nodes::DIM, N> EP = te.gather<Nodes::VEC_EP>();
+        const Eigen::Matrix<double, Nodes::DIM, N> EQ = te.gather<Nodes::VEC_EQ>();
+        const Eigen::Matrix<double, N, 1> PHI0 = te.gather<Nodes::SCAL_PHI0>();
+        const Eigen::Matrix<double, N, 1> PHIV0 = te.gather<Nodes::SCAL_PHIV0>();
+        for (int i = 0; i < N; i++)
+            {
+            for (int k = 0; k < DIM; k++)
+                {
+                u0[k][i](l) = U0(k, i);
+                v0[k][i](l) = V0(k, i);
+                ep[k][i](l) = EP(k, i);
+                eq[k][i](l) = EQ(k, i);
+                }
+            phi0[i](l) = PHI0(i);
+            phiv0[i](l) = PHIV0(i);
+            for (int d = 0; d < DIM; d++)
+                { da[i][d](l) = te.da()(i, d); }
+            }
+        for (int npi = 0; npi < NPI; npi++)
+            { w[npi](l) = te.weight(npi); }
+        Ms(l) = te.Ms;
+        }
+
+    lanes gV[DIM], Hm[DIM][NPI];
+    if (stt != nullptr)
+        {
+        for (int l = 0; l < L; l++)
+            {
+            const int idx = tet[b.idx[l]].idx;
+            for (int k = 0; k < DIM; k++)
+                {
+                gV[k](l) = stt->gradV[idx](k);
+                for (int npi = 0; npi < NPI; npi++)
+                    { Hm[k][npi](l) = stt->Hm[idx](k, npi); }
+                }
+            }
+        }
+
+    lanes vol = lanes::Zero();
+    for (int npi = 0; npi < NPI; npi++)
+        { vol += w[npi]; }
+
+    /*-------------------- INTERPOLATION --------------------*/
+    // dU[d][k] is the derivative of the component k along the direction d, Hd and Hv are minus the gradients of
+    // the potentials
+    lanes U[DIM][NPI], V[DIM][NPI], dU[DIM][DIM], dV[DIM][DIM], Hd[DIM], Hv[DIM];
+    for (int k = 0; k < DIM; k++)
+        {
+        for (int npi = 0; npi < NPI; npi++)
+            {
+            U[k][npi] = a[0][npi] * u0[k][0];
+            V[k][npi] = a[0][npi] * v0[k][0];
+            for (int i = 1; i < N; i++)
+                {
+                U[k][npi] += a[i][npi] * u0[k][i];
+                V[k][npi] += a[i][npi] * v0[k][i];
+                }
+            }
+        for (int d = 0; d < DIM; d++)
+            {
+            dU[d][k] = da[0][d] * u0[k][0];
+            dV[d][k] = da[0][d] * v0[k][0];
+            for (int i = 1; i < N; i++)
+                {
+                dU[d][k] += da[i][d] * u0[k][i];
+                dV[d][k] += da[i][d] * v0[k][i];
+                }
+            }
+        Hd[k] = -da[0][k] * phi0[0];
+        Hv[k] = -da[0][k] * phiv0[0];
+        for (int i = 1; i < N; i++)
+            {
+            Hd[k] -= da[i][k] * phi0[i];
+            Hv[k] -= da[i][k] * phiv0[i];
+            }
+        }
+
+    lanes gradSq = lanes::Zero();
+    for (int d = 0; d < DIM; d++)
+        for (int k = 0; k < DIM; k++)
+            { gradSq += dU[d][k].square(); }
+
+    /*-------------------- EFFECTIVE FIELD --------------------*/
+    lanes H_aniso[DIM][NPI], uHeff[NPI];
+    for (int npi = 0; npi < NPI; npi++)
+        {
+        uHeff[npi] = U[0][npi] * Hext(0) + U[1][npi] * Hext(1) + U[2][npi] * Hext(2);
+        for (int k = 0; k < DIM; k++)
+            { H_aniso[k][npi].setZero(); }
+        }
+
+    if (param.K != 0)
+        {
+        const double Kbis = 2.0 * param.K / Js;
+        Eigen::Vector3d const &uk = param.uk;
+        for (int npi = 0; npi < NPI; npi++)
+            {
+            const lanes uk_u = uk(0) * U[0][npi] + uk(1) * U[1][npi] + uk(2) * U[2][npi];
+            const lanes uk_v = uk(0) * V[0][npi] + uk(1) * V[1][npi] + uk(2) * V[2][npi];
+            for (int k = 0; k < DIM; k++)
+                { H_aniso[k][npi] += (Kbis * uk(k)) * (uk_u + s_dt * uk_v); }
+            uHeff[npi] += Kbis * uk_u.square();
+            }
+        }
+
+    if (param.K3 != 0)
+        {  // same formulas as Tet::calc_aniso_cub
+        const double K3bis = 2.0 * param.K3 / Js;
+        const Eigen::Vector3d *axis[DIM] = {&param.ex, &param.ey, &param.ez};
+        for (int npi = 0; npi < NPI; npi++)
+            {
+            lanes uk_u[DIM], uk_v[DIM], uk_uuu[DIM];
+            for (int c = 0; c < DIM; c++)
+                {
+                Eigen::Vector3d const &e = *axis[c];
+                uk_u[c] = e(0) * U[0][npi] + e(1) * U[1][npi] + e(2) * U[2][npi];
+                uk_v[c] = e(0) * V[0][npi] + e(1) * V[1][npi] + e(2) * V[2][npi];
+                uk_uuu[c] = uk_u[c] * (1.0 - uk_u[c].square());
+                }
+            for (int k = 0; k < DIM; k++)
+                {
+                H_aniso[k][npi] -= K3bis * (uk_uuu[0] * param.ex(k) + uk_uuu[1] * param.ey(k)
+                                            + uk_uuu[2] * param.ez(k)
+                                            + (s_dt * param.ex(k)) * uk_v[k] * (1.0 - 3.0 * uk_u[k].square()));
+                }
+            uHeff[npi] -= K3bis * (uk_u[0] * uk_uuu[0] + uk_u[1] * uk_uuu[1] + uk_u[2] * uk_uuu[2]);
+            }
+        }
+
+    const double reduced_dt = gamma0 * dt;
+    const double M = 2. * alpha * 0.1 / reduced_dt;  // same piecewise formula as calc_alpha_eff
+    lanes a_eff[NPI];
+    for (int npi = 0; npi < NPI; npi++)
+        {
+        uHeff[npi] -= Abis * gradSq;
+        uHeff[npi] += U[0][npi] * Hd[0] + U[1][npi] * Hd[1] + U[2][npi] * Hd[2];
+        if (stt != nullptr)
+            { uHeff[npi] += U[0][npi] * Hm[0][npi] + U[1][npi] * Hm[1][npi] + U[2][npi] * Hm[2][npi]; }
+
+        const lanes h = uHeff[npi].min(M).max(-M);
+        a_eff[npi] = (h > 0.).select(alpha + reduced_dt / 2. * h, alpha / (1. - reduced_dt / (2. * alpha) * h));
+        }
+
+    /*-------------------- ENERGIES --------------------*/
+    lanes E_exch, E_demag, E_aniso, E_zeeman;
+    if (tetE != nullptr)
+        {
+        lanes phi_w = lanes::Zero();
+        E_aniso.setZero();
+        E_zeeman.setZero();
+        for (int npi = 0; npi < NPI; npi++)
+            {
+            lanes phi = a[0][npi] * phi0[0];
+            for (int i = 1; i < N; i++)
+                { phi += a[i][npi] * phi0[i]; }
+            phi_w += w[npi] * phi;
+
+            E_zeeman += w[npi] * (U[0][npi] * Hext(0) + U[1][npi] * Hext(1) + U[2][npi] * Hext(2));
+            if ((param.K != 0.0) || (param.K3 != 0.0))
+                {
+                const lanes uk_u = param.uk(0) * U[0][npi] + param.uk(1) * U[1][npi] + param.uk(2) * U[2][npi];
+                const lanes al0 = param.ex(0) * U[0][npi] + param.ex(1) * U[1][npi] + param.ex(2) * U[2][npi];
+                const lanes al1 = param.ey(0) * U[0][npi] + param.ey(1) * U[1][npi] + param.ey(2) * U[2][npi];
+                const lanes al2 = param.ez(0) * U[0][npi] + param.ez(1) * U[1][npi] + param.ez(2) * U[2][npi];
+                E_aniso += w[npi] * (-param.K * uk_u.square()
+                                     + param.K3 * ((al0 * al1).square() + (al1 * al2).square()
+                                                   + (al2 * al0).square()));
+                }
+            }
+        E_exch = param.A * vol * gradSq;
+        E_demag = -0.5 * mu0 * Ms * (dU[0][0] + dU[1][1] + dU[2][2]) * phi_w;
+        E_zeeman *= -param.J;
+        }
+
+    /*-------------------- LUMPING AND PROJECTION: AE->Kp --------------------*/
+    // AE is made of 3x3 blocks, the block (i,j) is S_ij Id, plus D_i Id + [c_i]x if i == j
+    const double prefactor = prm_t.prefactor * s_dt * Abis;
+    lanes S[N][N], D[N], c[DIM][N];
+    for (int i = 0; i < N; i++)
+        {
+        for (int j = i; j < N; j++)
+            {
+            S[i][j] = prefactor * vol * (da[i][0] * da[j][0] + da[i][1] * da[j][1] + da[i][2] * da[j][2]);
+            S[j][i] = S[i][j];
+            }
+        lanes wa = w[0] * a[i][0];
+        D[i] = a_eff[0] * wa;
+        for (int npi = 1; npi < NPI; npi++)
+            {
+            wa += w[npi] * a[i][npi];
+            D[i] += a_eff[npi] * w[npi] * a[i][npi];
+            }
+        D[i] += S[i][i];
+        for (int k = 0; k < DIM; k++)
+            { c[k][i] = wa * u0[k][i]; }
+        }
+
+    // the basis vector of row (or column) r of Kp is ep of node r if r < N, eq of node r-N otherwise
+    auto basis = [&ep, &eq](const int r) -> lanes const (&)[DIM][N] { return (r < N) ? ep : eq; };
+
+    lanes kp[2 * N][2 * N];
+    for (int r = 0; r < 2 * N; r++)
+        {
+        const int i = r % N;
+        lanes const(&Er)[DIM][N] = basis(r);
+        for (int s = 0; s < 2 * N; s++)
+            {
+            const int j = s % N;
+            lanes const(&Es)[DIM][N] = basis(s);
+            const lanes dot = Er[0][i] * Es[0][j] + Er[1][i] * Es[1][j] + Er[2][i] * Es[2][j];
+            if (i != j)
+                { kp[r][s] = S[i][j] * dot; }
+            else
+                {  // Er.(c x Es)
+                kp[r][s] = D[i] * dot
+                           + Er[0][i] * (c[1][i] * Es[2][i] - c[2][i] * Es[1][i])
+                           + Er[1][i] * (c[2][i] * Es[0][i] - c[0][i] * Es[2][i])
+                           + Er[2][i] * (c[0][i] * Es[1][i] - c[1][i] * Es[0][i]);
+                }
+            }
+        }
+
+    /*-------------------- BE AND PROJECTION: BE->Lp --------------------*/
+    lanes BE[DIM][N];
+    for (int k = 0; k < DIM; k++)
+        {
+        lanes H[NPI];
+        for (int npi = 0; npi < NPI; npi++)
+            { H[npi] = Hext(k) + H_aniso[k][npi] + Hd[k] + (s_dt / gamma0) * Hv[k]; }
+
+        for (int i = 0; i < N; i++)
+            {
+            BE[k][i] = -Abis * vol * (da[i][0] * dU[0][k] + da[i][1] * dU[1][k] + da[i][2] * dU[2][k]);
+            for (int npi = 0; npi < NPI; npi++)
+                { BE[k][i] += w[npi] * a[i][npi] * H[npi]; }
+            }
+        }
+
+    if (stt != nullptr)
+        {  // see Tet::add_stt_BE
+        const double prefactor = stt->D0 / Nodes::sq(stt->lJ) / (gamma0 * nu0 * Js);
+        lanes j_grad_u[DIM];
+        for (int k = 0; k < DIM; k++)
+            { j_grad_u[k] = -stt->sigma * (gV[0] * dU[0][k] + gV[1] * dU[1][k] + gV[2] * dU[2][k]); }
+        for (int k = 0; k < DIM; k++)
+            {
+            const int k1 = (k + 1) % DIM;
+            const int k2 = (k + 2) % DIM;
+            for (int npi = 0; npi < NPI; npi++)
+                {
+                const lanes m = stt->pf * (stt->ksi * j_grad_u[k] + U[k1][npi] * j_grad_u[k2]
+                                           - U[k2][npi] * j_grad_u[k1]);
+                const lanes h = w[npi] * (Hm[k][npi] + prefactor * m);
+                for (int i = 0; i < N; i++)
+                    { BE[k][i] += a[i][npi] * h; }
+                }
+            }
+        }
+
+    if (idx_dir != Nodes::IDX_UNDEF)
+        {  // the artificial drift from eventual recentering is along x,y or z, see Tet::add_drift_BE
+        lanes const(&dUd)[DIM] = dU[idx_dir];
+        lanes const(&dVd)[DIM] = dV[idx_dir];
+        for (int k = 0; k < DIM; k++)
+            {
+            const int k1 = (k + 1) % DIM;
+            const int k2 = (k + 2) % DIM;
+            for (int npi = 0; npi < NPI; npi++)
+                {
+                const lanes g = alpha * dUd[k] + U[k1][npi] * dUd[k2] - U[k2][npi] * dUd[k1]
+                                + s_dt * (alpha * dVd[k] + U[k1][npi] * dVd[k2] - U[k2][npi] * dVd[k1]
+                                          + V[k1][npi] * dUd[k2] - V[k2][npi] * dUd[k1]);
+                for (int i = 0; i < N; i++)
+                    { BE[k][i] += (Vdrift * a[i][npi]) * w[npi] * g; }
+                }
+            }
+        }
+
+    lanes lp[2 * N];
+    for (int r = 0; r < 2 * N; r++)
+        {
+        const int i = r % N;
+        lanes const(&Er)[DIM][N] = basis(r);
+        lp[r] = Er[0][i] * BE[0][i] + Er[1][i] * BE[1][i] + Er[2][i] * BE[2][i];
+        }
+
+    /*-------------------- SCATTER --------------------*/
+    for (int l = 0; l < b.nb; l++)
+        {
+        Tet &te = tet[b.idx[l]];
+        for (int r = 0; r < 2 * N; r++)
+            {
+            for (int s = 0; s < 2 * N; s++)
+                { te.Kp(r, s) = kp[r][s](l); }
+            te.Lp(r) = lp[r](l);
+            }
+        if (tetE != nullptr)
+            { tetE[b.idx[l]] = Energies{E_exch(l), E_aniso(l), E_demag(l), E_zeeman(l)}; }
+        }
+    }
+    }  // namespace Tetra
+
+#endif
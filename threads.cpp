@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <linux/mempolicy.h>  // for MPOL_MF_MOVE
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <tbb/task_arena.h>
+
+#include <eigen3/Eigen/Core>
+
+#include "threads.h"
+
+using namespace Threads;
+
+/** pins the calling thread on processor cpu */
+static void pinOn(const int cpu)
+    {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+std::vector<int> Threads::parseCpuList(std::string const &s)
+    {
+    std::vector<int> cpus;
+    std::istringstream in(s);
+    std::string range;
+    while (std::getline(in, range, ','))
+        {
+        const size_t dash = range.find('-');
+        try
+            {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++)
+                { cpus.push_back(cpu); }
+            }
+        catch (std::logic_error const &)
+            {}  // blank or malformed range
+        }
+    return cpus;
+    }
+
+std::string Threads::cpuList(std::vector<int> const &cpus)
+    {
+    std::ostringstream ss;
+    for (size_t i = 0; i < cpus.size();)
+        {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            { j++; }
+        if (i > 0) ss << ',';
+        ss << cpus[i];
+        if (j > i) ss << '-' << cpus[j];
+        i = j + 1;
+        }
+    return ss.str();
+    }
+
+topology topology::detect(void)
+    {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    std::vector<int> allowed;
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+        {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &mask)) allowed.push_back(cpu);
+        }
+    if (allowed.empty())
+        {
+        const int nb = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int cpu = 0; cpu < nb; cpu++)
+            { allowed.push_back(cpu); }
+        }
+
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    std::error_code ec;
+    for (auto const &entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec))
+        {
+        const std::string dir = entry.path().filename().string();
+        if (dir.rfind("node", 0) != 0 || dir.find_first_not_of("0123456789", 4) != std::string::npos
+            || dir.size() == 4)
+            continue;
+        std::ifstream f(entry.path() / "cpulist");
+        std::string line;
+        std::getline(f, line);
+        std::vector<int> cpus;
+        for (const int cpu : parseCpuList(line))
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) cpus.push_back(cpu);
+        if (!cpus.empty()) nodes.emplace_back(std::stoi(dir.substr(4)), cpus);
+        }
+    std::sort(nodes.begin(), nodes.end());
+
+    topology t;
+    for (auto const &n : nodes)
+        {
+        t.nodeIds.push_back(n.first);
+        t.cpusOfNode.push_back(n.second);
+        }
+    if (t.nbCpus() != (int)allowed.size())
+        {  // no NUMA information, or processors missing from it
+        t.nodeIds = {0};
+        t.cpusOfNode = {allowed};
+        }
+    return t;
+    }
+
+int topology::nbCpus(void) const
+    {
+    int nb = 0;
+    for (auto const &cpus : cpusOfNode)
+        { nb += cpus.size(); }
+    return nb;
+    }
+
+int topology::nodeOf(const int cpu) const
+    {
+    for (size_t n = 0; n < cpusOfNode.size(); n++)
+        if (std::find(cpusOfNode[n].begin(), cpusOfNode[n].end(), cpu) != cpusOfNode[n].end())
+            return n;
+    return 0;
+    }
+
+std::vector<int> topology::cpuOrder(const pinning p) const
+    {
+    std::vector<int> order;
+    if (p == SPREAD)
+        {
+        for (size_t i = 0; (int)order.size() < nbCpus(); i++)
+            for (auto const &cpus : cpusOfNode)
+                if (i < cpus.size()) order.push_back(cpus[i]);
+        }
+    else
+        {
+        for (auto const &cpus : cpusOfNode)
+            { order.insert(order.end(), cpus.begin(), cpus.end()); }
+        }
+    return order;
+    }
+
+int config::nbDemag(const int nbCpus) const
+    {
+    const int nb = nbThreads(nbCpus);
+    return (demag > 0) ? std::min(demag, nb) : nb;
+    }
+
+int config::nbSolver(const int nbCpus) const
+    {
+    const int nb = nbThreads(nbCpus);
+    return (solver > 0) ? std::min(solver, nb) : nb;
+    }
+
+void pool::pinner::on_scheduler_entry(bool)
+    {
+    const int idx = tbb::this_task_arena::current_thread_index();
+    if (idx == 0 || (idx > 0 && cpus.size() == 1))
+        pinOn(cpus[0]);
+    else if (idx > 0)
+        pinOn(cpus[1 + (idx - 1) % (cpus.size() - 1)]);
+    }
+
+pool::pool(config const &c) : cfg(c), topo(topology::detect())
+    {
+    const int nbCpus = topo.nbCpus();
+    nbThreads = cfg.nbThreads(nbCpus);
+    int nbTbb = nbThreads;
+    if (cfg.pin != NO_PINNING)
+        {
+        cpus = topo.cpuOrder(cfg.pin);
+        const int nbDemag = cfg.nbDemag(nbCpus);
+        const int nbSolver = cfg.nbSolver(nbCpus);
+
+        // the OpenMP threads of the demag field are on the first nbDemag processors, the TBB
+        // workers on the next nbSolver ones if there are enough processors, so that the
+        // computations of the demag field and those of TBB do not compete when they overlap. The
+        // threads of Eigen are OpenMP threads too, the linear solver runs on the first nbSolver
+        // processors, as the demag field, which it never overlaps.
+        shared = !cfg.disjoint(nbCpus);
+        tbbCpus = cpus;
+        if (!shared)
+            {
+            tbbCpus.assign(cpus.begin() + nbDemag, cpus.begin() + nbDemag + nbSolver);
+            tbbCpus.insert(tbbCpus.begin(), cpus[0]);
+            nbTbb = nbSolver + 1;  // one worker per processor of the solver, and the master thread
+            }
+        tbbPinner = std::make_unique<pinner>(tbbCpus);
+
+        // OpenMP keeps its threads, pinned once for all, the master thread is pinned as thread 0 of
+        // both OpenMP and TBB
+        const int nbOmp = std::max(nbDemag, nbSolver);
+#pragma omp parallel num_threads(nbOmp)
+        pinOn(cpus[omp_get_thread_num() % cpus.size()]);
+        }
+    tbbLimit = std::make_unique<tbb::global_control>(tbb::global_control::max_allowed_parallelism, nbTbb);
+    omp_set_num_threads(cfg.nbDemag(nbCpus));
+    Eigen::setNbThreads(cfg.nbSolver(nbCpus));
+    }
+
+void pool::report(void) const
+    {
+    const int nbCpus = topo.nbCpus();
+    std::cout << "threads:           " << nbThreads << " (demag " << cfg.nbDemag(nbCpus) << ", solver "
+              << cfg.nbSolver(nbCpus) << "), pinning " << name(cfg.pin) << ", first touch "
+              << (cfg.firstTouch ? "on" : "off") << '\n';
+    for (size_t n = 0; n < topo.nodeIds.size(); n++)
+        {
+        std::cout << "  NUMA node " << topo.nodeIds[n] << ":      cpus " << cpuList(topo.cpusOfNode[n])
+                  << '\n';
+        }
+    std::cout << "  runtimes:        TBB "
+              << tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism)
+              << ", OpenMP " << omp_get_max_threads() << ", Eigen " << Eigen::nbThreads() << '\n';
+    if (nbThreads > nbCpus)
+        std::cout << "  warning:         more threads than the " << nbCpus << " processors\n";
+    if (!cpus.empty())
+        {
+        std::cout << "  placement:       thread i on cpu";
+        for (int i = 0; i < std::min(nbThreads, 16); i++)
+            { std::cout << ' ' << cpus[i % cpus.size()]; }
+        if (nbThreads > 16) std::cout << " ...";
+        std::cout << '\n';
+        if (shared)
+            std::cout << "  warning:         demag and solver threads on the same cpus, no demag pipeline\n";
+        else
+            {
+            std::vector<int> workers(tbbCpus.begin() + 1, tbbCpus.end());
+            std::sort(workers.begin(), workers.end());
+            std::vector<int> omp(cpus.begin(), cpus.begin() + std::max(cfg.nbDemag(nbCpus), cfg.nbSolver(nbCpus)));
+            std::sort(omp.begin(), omp.end());
+            std::cout << "  TBB workers:     cpus " << cpuList(workers) << '\n';
+            std::cout << "  OpenMP, Eigen:   cpus " << cpuList(omp) << '\n';
+            }
+        }
+    }
+
+void pool::place(void *data, const size_t bytes) const
+    {
+    if (!cfg.firstTouch || topo.nodeIds.size() < 2 || bytes == 0) return;
+
+    const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+    const uintptr_t end = begin + bytes;
+    const std::vector<int> order = cpus.empty() ? topo.cpuOrder(COMPACT) : cpus;
+
+    std::vector<void *> pages;
+    std::vector<int> nodes;
+    for (uintptr_t page = begin - begin % pageSize; page < end; page += pageSize)
+        {
+        // thread of the part holding the middle of the page
+        const uintptr_t mid = std::clamp(page + pageSize / 2, begin, end - 1);
+        const int thread = ((mid - begin) * nbThreads) / bytes;
+        pages.push_back(reinterpret_cast<void *>(page));
+        nodes.push_back(topo.nodeIds[topo.nodeOf(order[thread % order.size()])]);
+        }
+    std::vector<int> status(pages.size());
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nodes.data(), status.data(), MPOL_MF_MOVE)
+        < 0)
+        {
+        std::cerr << "warning: the pages could not be moved to the NUMA nodes\n";
+        }
+    }
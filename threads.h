@@ -0,0 +1,170 @@
+#ifndef threads_h
+#define threads_h
+
+/** \file threads.h
+\brief threading configuration shared by the three runtimes of feeLLGood: TBB for
+std::execution::par, OpenMP for scalfmm and Eigen for the solver. The total number of threads is
+split into the threads of the demag field and those of the finite element solver, the threads may
+be pinned on the processors, and the pages of the arrays of the mesh may be placed on the NUMA nodes
+of the threads processing them.
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tbb/global_control.h>
+#include <tbb/task_scheduler_observer.h>
+
+namespace Threads
+    {
+/** \enum pinning
+placement of the threads on the processors
+*/
+enum pinning
+    {
+    NO_PINNING = 0, /**< the threads are placed by the operating system */
+    COMPACT = 1,    /**< thread i on the i-th processor, the NUMA nodes are filled one after the other */
+    SPREAD = 2      /**< consecutive threads on different NUMA nodes, in turn */
+    };
+
+/** returns the name of the pinning policy, as written in the settings */
+inline std::string name(const pinning p)
+    {
+    switch (p)
+        {
+        case NO_PINNING: return "none";
+        case COMPACT: return "compact";
+        case SPREAD: return "spread";
+        }
+    return "unknown";
+    }
+
+/** returns the pinning policy from its name, returns false if the name is unknown */
+inline bool fromName(std::string const &s /**< [in] */, pinning &p /**< [out] */)
+    {
+    for (pinning x : {NO_PINNING, COMPACT, SPREAD})
+        {
+        if (s == name(x))
+            {
+            p = x;
+            return true;
+            }
+        }
+    return false;
+    }
+
+/** \struct topology
+processors available to the process, grouped by NUMA node
+*/
+struct topology
+    {
+    std::vector<int> nodeIds;                 /**< numbers of the NUMA nodes */
+    std::vector<std::vector<int>> cpusOfNode; /**< processors of each NUMA node */
+
+    /** reads the NUMA nodes from /sys, keeps the processors of the affinity mask of the process.
+     * Without NUMA information all the processors are on a single node. */
+    static topology detect(void);
+
+    /** number of processors */
+    int nbCpus(void) const;
+
+    /** index in nodeIds of the NUMA node of processor cpu, 0 if unknown */
+    int nodeOf(const int cpu) const;
+
+    /** processors in the order the threads are pinned on them */
+    std::vector<int> cpuOrder(const pinning p) const;
+    };
+
+/** parses a list of processors such as "0-3,8,10-11", as in /sys/devices/system/node */
+std::vector<int> parseCpuList(std::string const &s /**< [in] */);
+
+/** writes a sorted list of processors in the format of parseCpuList */
+std::string cpuList(std::vector<int> const &cpus /**< [in] */);
+
+/** \struct config
+threading settings as written by the user, a number of threads of zero stands for the default
+*/
+struct config
+    {
+    int total = 0;              /**< total number of threads, 0 for the number of processors */
+    int demag = 0;              /**< threads of the demag field, 0 for the total */
+    int solver = 0;             /**< threads of the finite element solver, 0 for the total */
+    pinning pin = NO_PINNING;   /**< placement of the threads on the processors */
+    bool firstTouch = false;    /**< if true the arrays of the mesh are placed on the NUMA nodes */
+
+    /** effective total number of threads, with nbCpus processors */
+    int nbThreads(const int nbCpus) const { return (total > 0) ? total : nbCpus; }
+
+    /** effective number of threads of the demag field, at most the total */
+    int nbDemag(const int nbCpus) const;
+
+    /** effective number of threads of the finite element solver, at most the total */
+    int nbSolver(const int nbCpus) const;
+
+    /** true if the threads of the demag field and of the solver may be pinned on distinct
+     * processors */
+    bool disjoint(const int nbCpus) const { return nbDemag(nbCpus) + nbSolver(nbCpus) <= nbCpus; }
+    };
+
+/** \class pool
+applies a config to TBB, OpenMP and Eigen, for the lifetime of the object. There must be a single
+pool, built before any parallel computation.
+*/
+class pool
+    {
+public:
+    /** constructor, limits the number of threads of the runtimes and pins their threads */
+    explicit pool(config const &c /**< [in] */);
+
+    /** prints the topology, the number of threads of each runtime and the placement of the
+     * threads */
+    void report(void) const;
+
+    /** true unless the threads of the demag field and the TBB workers are pinned on disjoint
+     * processors, then the computations of the demag field should not overlap the others */
+    bool sharedCpus(void) const { return shared; }
+
+    /** moves the pages of [data, data + bytes) to the NUMA nodes of the threads processing them,
+     * split in as many contiguous parts as threads, as the first touch by these threads would do.
+     * Does nothing unless firstTouch is set and there are several NUMA nodes. */
+    void place(void *data /**< [in] */, const size_t bytes /**< [in] */) const;
+
+    /** moves the pages of the elements of v, see place(void *, size_t) */
+    template<class T>
+    void place(std::vector<T> &v /**< [in] */) const
+        { place(v.data(), v.size() * sizeof(T)); }
+
+private:
+    /** \class pinner
+    pins each TBB thread on entering the scheduler, from its index in the arena: the master thread
+    on the first processor, the workers in turn on the others */
+    class pinner : public tbb::task_scheduler_observer
+        {
+    public:
+        /** constructor, starts observing */
+        explicit pinner(std::vector<int> const &c) : cpus(c) { observe(true); }
+
+        /** destructor, stops observing before the destruction of cpus */
+        ~pinner() { observe(false); }
+
+        /** pins the calling thread */
+        void on_scheduler_entry(bool) override;
+
+    private:
+        std::vector<int> const &cpus; /**< processors in pinning order */
+        };
+
+    config cfg;             /**< settings */
+    topology topo;          /**< processors available */
+    int nbThreads;          /**< effective total number of threads */
+    std::vector<int> cpus;  /**< processors in pinning order, empty if the threads are not pinned */
+    std::vector<int> tbbCpus; /**< processors of the TBB threads, the first one is the master's */
+    bool shared = true;     /**< false if the OpenMP and TBB threads are pinned on disjoint processors */
+
+    std::unique_ptr<tbb::global_control> tbbLimit; /**< maximum number of TBB threads */
+    std::unique_ptr<pinner> tbbPinner;             /**< pinning of the TBB threads */
+    };
+
+    }  // namespace Threads
+#endif
@@ -110,10 +110,9 @@ static void exit_if_signal_received(const Fem &fem, const Settings &settings, co
     if (settings.save_period > 0)
         {
         std::cout << ": saving the magnetization configuration...\n";
-        std::string fileName =
-                settings.r_path_output_dir + '/' + settings.getSimName() + "_at_exit.sol";
-        std::string metadata = settings.solMetadata(t_prm.get_t(), "idx\tmx\tmy\tmz\tphi");
-        fem.msh.savesol(settings.getPrecision(), fileName, metadata);
+        std::string fileName = fem.saveConfig(
+                settings, settings.r_path_output_dir + '/' + settings.getSimName() + "_at_exit",
+                t_prm.get_t(), false);
         std::cout << "Magnetization configuration saved to " << fileName << "\n";
         }
     else
@@ -121,6 +120,7 @@ static void exit_if_signal_received(const Fem &fem, const Settings &settings, co
         std::cout << ": magnetization configuration not saved.\n";
         }
     std::cout << "Terminating.\n";
+    fem.snapshots.wait();  // exit() does not destroy fem
 
     print_stats(stats);
     exit(1);
@@ -130,10 +130,22 @@ static void exit_if_signal_received(const Fem &fem, const Settings &settings, co
 inline void compute_all(Fem &fem, Settings &settings, scal_fmm::fmm &myFMM, const double t)
     {
     chronometer fmm_counter(2);
-    myFMM.calc_demag(fem.msh);
+    if (settings.fusedEnergy)
+        {
+        myFMM.calc_demag(fem.msh);
+        fem.energyUpToDate = false;  // computed by the next LinAlgebra::prepareElements
+        }
+    else
+        { myFMM.calc_demag(fem.msh, [&fem, &settings, t]() { fem.energy(t, settings); }); }
     if (settings.verbose)
-            { std::cout << "magnetostatics done in " << fmm_counter.millis() << std::endl; }
-    fem.energy(t, settings);
+            {
+            Demag::durations const &d = myFMM.getDurations();
+            std::cout << "magnetostatics" << (settings.fusedEnergy ? "" : " and energies") << " done in "
+                      << fmm_counter.millis() << " (charges "
+                      << 1e3 * d.charges << " ms, gather " << 1e3 * d.gather << " ms, fmm "
+                      << 1e3 * d.execute << " ms, scatter " << 1e3 * d.scatter << " ms, "
+                      << myFMM.getNbIncremental() << "/2 incremental)" << std::endl;
+            }
     fem.evolution();
     }
 
@@ -194,7 +206,13 @@ int time_integration(Fem &fem, Settings &settings /**< [in] */, LinAlgebra &linA
 
             Eigen::Vector3d Hext = settings.getField(t_prm.get_t());
 
-            linAlg.prepareElements(Hext, t_prm);
+            if (settings.fusedEnergy)
+                {
+                linAlg.prepareElements(Hext, t_prm, fem.tetEnergies.data());
+                fem.fusedEnergy(settings);
+                }
+            else
+                { linAlg.prepareElements(Hext, t_prm); }
             int err = linAlg.solver(t_prm);
             fem.vmax = linAlg.get_v_max();
 
@@ -234,6 +252,7 @@ int time_integration(Fem &fem, Settings &settings /**< [in] */, LinAlgebra &linA
             if (settings.recenter) fem.recenter(settings.threshold, settings.recentering_direction);
             if (!settings.verbose) show_progress(t_prm.get_t() / t_prm.tf);
             }  // endwhile
+        if (!fem.energyUpToDate) fem.energy(t_prm.get_t(), settings);
         fem.saver(settings, t_prm, fout, nt_output++);
         }                                       // end for
     if (!settings.verbose) show_progress(1.0);  // show we are done
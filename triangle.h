@@ -19,7 +19,7 @@ class Triangle
     {
 public:
     /** constructor used by readMesh */
-    inline Triangle(const std::vector<Nodes::Node> &_p_node /**< [in] vector of nodes */,
+    inline Triangle(const Nodes::Store &_p_node /**< [in] nodes storage */,
                     const int i0 /**< [in] node index */, const int i1 /**< [in] node index */,
                     const int i2 /**< [in] node index */)
         : refNode(_p_node)
@@ -65,7 +65,7 @@ public:
 
 private:
     /** direct access to the Nodes */
-    const std::vector<Nodes::Node> &refNode;
+    const Nodes::Store &refNode;
     };
 
     }  // namespace Mesh
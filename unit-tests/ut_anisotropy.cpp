@@ -76,7 +76,9 @@ BOOST_AUTO_TEST_CASE(anisotropy_uniax, *boost::unit_test::tolerance(10.0 * UT_TO
         node[i].v0 = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
         }
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
 
     double dt = distrib(gen);
 
@@ -216,7 +218,9 @@ BOOST_AUTO_TEST_CASE(anisotropy_cubic, *boost::unit_test::tolerance(10.0 * UT_TO
         node[i].v0 = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
         }
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
 
     double dt = distrib(gen);
 
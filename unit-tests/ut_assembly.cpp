@@ -0,0 +1,156 @@
+#define BOOST_TEST_MODULE assemblyTest
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "matrix_assembly.h"
+#include "matrix_free.h"
+#include "ut_tools.h"
+#include "ut_config.h"
+
+BOOST_AUTO_TEST_SUITE(ut_assembly)
+
+/** random inner matrices and vectors, with a dominant diagonal for the matrices */
+void random_fill(std::vector<Tetra::Tet> &tet, std::mt19937 &gen)
+    {
+    std::uniform_real_distribution<> distrib(-1.0, 1.0);
+    for (Tetra::Tet &te : tet)
+        {
+        te.Kp = Eigen::Matrix<double, 2 * Tetra::N, 2 * Tetra::N>::NullaryExpr(
+                [&distrib, &gen]() { return distrib(gen); });
+        te.Lp = Eigen::Matrix<double, 2 * Tetra::N, 1>::NullaryExpr(
+                [&distrib, &gen]() { return distrib(gen); });
+        // the rows of Kp are permuted (ep,eq) -> (eq,ep) in K, see element::assemblage_mat
+        for (int i = 0; i < Tetra::N; i++)
+            {
+            te.Kp(i, Tetra::N + i) += 32.0;
+            te.Kp(Tetra::N + i, i) += 32.0;
+            }
+        }
+    }
+
+BOOST_AUTO_TEST_CASE(coloring)
+    {
+    Nodes::Store node;
+    std::vector<Tetra::geometry> geom;
+    std::vector<Tetra::Tet> tet;
+    build_cube(3, 1.0, node, geom, tet);
+
+    std::vector<std::vector<int>> colors = colorElements(tet, node.size());
+    std::vector<int> count(tet.size(), 0);
+    for (auto const &color : colors)
+        {
+        std::vector<bool> used(node.size(), false);
+        for (int k : color)
+            {
+            count[k]++;
+            for (int i : tet[k].ind)
+                {
+                BOOST_CHECK(!used[i]);
+                used[i] = true;
+                }
+            }
+        }
+    BOOST_CHECK(std::all_of(count.begin(), count.end(), [](int c) { return c == 1; }));
+    std::cout << tet.size() << " tetrahedrons, " << colors.size() << " colors\n";
+    }
+
+BOOST_AUTO_TEST_CASE(assemble_vs_triplets, *boost::unit_test::tolerance(UT_TOL))
+    {
+    Nodes::Store node;
+    std::vector<Tetra::geometry> geom;
+    std::vector<Tetra::Tet> tet;
+    build_cube(3, 1.0, node, geom, tet);
+    const int NOD = node.size();
+
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    random_fill(tet, gen);
+
+    std::vector<Eigen::Triplet<double>> w_K;
+    Eigen::VectorXd L_ref = Eigen::VectorXd::Zero(2 * NOD);
+    for (Tetra::Tet const &te : tet)
+        {
+        te.assemblage_mat(NOD, w_K);
+        te.assemblage_vect(NOD, L_ref);
+        }
+    Eigen::SparseMatrix<double, Eigen::RowMajor> K_ref(2 * NOD, 2 * NOD);
+    K_ref.setFromTriplets(w_K.begin(), w_K.end());
+
+    MatrixAssembler assembler(NOD, tet);
+    Eigen::SparseMatrix<double, Eigen::RowMajor> K;
+    assembler.buildPattern(tet, K);
+    BOOST_CHECK(K.isCompressed());
+    BOOST_CHECK(K.nonZeros() == assembler.getNbNonZeros());
+    // assemble twice to check values are reset
+    assembler.assemble(tet, K);
+    assembler.assemble(tet, K);
+    Eigen::VectorXd L = Eigen::VectorXd::Zero(2 * NOD);
+    assembler.assemble(tet, L);
+
+    // summation order differs from setFromTriplets, distances are relative
+    double result = (Eigen::MatrixXd(K) - Eigen::MatrixXd(K_ref)).norm() / K_ref.norm();
+    std::cout << "matrix distance = " << result << std::endl;
+    BOOST_TEST(result == 0.0);
+    result = (L - L_ref).norm() / L_ref.norm();
+    std::cout << "vector distance = " << result << std::endl;
+    BOOST_TEST(result == 0.0);
+    }
+
+BOOST_AUTO_TEST_CASE(matrix_free_vs_assembled, *boost::unit_test::tolerance(UT_TOL))
+    {
+    Nodes::Store node;
+    std::vector<Tetra::geometry> geom;
+    std::vector<Tetra::Tet> tet;
+    build_cube(3, 1.0, node, geom, tet);
+    const int NOD = node.size();
+
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    random_fill(tet, gen);
+
+    MatrixAssembler assembler(NOD, tet);
+    Eigen::SparseMatrix<double, Eigen::RowMajor> K;
+    assembler.buildPattern(tet, K);
+    assembler.assemble(tet, K);
+    MatrixFreeOperator op(NOD, tet, assembler.getColors());
+
+    Eigen::VectorXd x = Eigen::VectorXd::Random(2 * NOD);
+    Eigen::VectorXd y_ref = K * x;
+    Eigen::VectorXd y = op * x;
+    double result = (y - y_ref).norm() / y_ref.norm();
+    std::cout << "product distance = " << result << std::endl;
+    BOOST_TEST(result == 0.0);
+
+    Precond::nodeBlocks B = op.getNodeBlocks();
+    result = 0;
+    for (int i = 0; i < NOD; i++)
+        {
+        Eigen::Matrix2d b;
+        b << K.coeff(i, i), K.coeff(i, NOD + i), K.coeff(NOD + i, i), K.coeff(NOD + i, NOD + i);
+        result += (B[i] - b).squaredNorm() / b.squaredNorm();
+        }
+    std::cout << "node blocks distance = " << sqrt(result) << std::endl;
+    BOOST_TEST(sqrt(result) == 0.0);
+
+    // both paths of the solver give the same solution
+    const double tol = 1e-10;
+    Eigen::VectorXd b = Eigen::VectorXd::Random(2 * NOD);
+    Eigen::BiCGSTAB<Eigen::SparseMatrix<double, Eigen::RowMajor>, Precond::wrapper> solver;
+    solver.setTolerance(tol);
+    solver.preconditioner().select(Precond::BLOCK_JACOBI);
+    solver.compute(K);
+    Eigen::VectorXd sol_ref = solver.solve(b);
+    Eigen::BiCGSTAB<MatrixFreeOperator, Precond::wrapper> mfSolver;
+    mfSolver.setTolerance(tol);
+    mfSolver.preconditioner().select(Precond::BLOCK_JACOBI);
+    mfSolver.compute(op);
+    Eigen::VectorXd sol = mfSolver.solve(b);
+    std::cout << "assembled: " << solver.iterations() << " iterations, matrix free: "
+              << mfSolver.iterations() << " iterations\n";
+    BOOST_CHECK(mfSolver.info() == Eigen::Success);
+    BOOST_CHECK((sol - sol_ref).norm() < 1e2 * tol * sol_ref.norm());
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,173 @@
+#define BOOST_TEST_MODULE demagTest
+
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "demag.h"
+#include "demag_hmatrix.h"
+#include "ut_config.h"
+
+BOOST_AUTO_TEST_SUITE(ut_demag)
+
+BOOST_AUTO_TEST_CASE(names)
+    {
+    for (Demag::method m : {Demag::FMM, Demag::DIRECT, Demag::HMATRIX})
+        {
+        Demag::method result;
+        BOOST_CHECK(Demag::fromName(Demag::name(m), result));
+        BOOST_CHECK(result == m);
+        }
+    Demag::method result;
+    BOOST_CHECK(!Demag::fromName("fast", result));
+
+    for (Demag::fmmPrecision p : {Demag::DOUBLE_PRECISION, Demag::SINGLE_PRECISION, Demag::MIXED_PRECISION})
+        {
+        Demag::fmmPrecision precision;
+        BOOST_CHECK(Demag::fromName(Demag::name(p), precision));
+        BOOST_CHECK(precision == p);
+        }
+    Demag::fmmPrecision precision;
+    BOOST_CHECK(!Demag::fromName("half", precision));
+    }
+
+/** random targets and sources in a cube of side 1, and random source densities */
+void random_particles(const int NOD, const int M, std::vector<Eigen::Vector3d> &targets,
+                      std::vector<Eigen::Vector3d> &sources, std::vector<double> &srcDen, std::mt19937 &gen)
+    {
+    std::uniform_real_distribution<> distrib(-0.5, 0.5);
+    targets.resize(NOD);
+    sources.resize(M);
+    srcDen.resize(M);
+    for (Eigen::Vector3d &p : targets)
+        { p = Eigen::Vector3d(distrib(gen), distrib(gen), distrib(gen)); }
+    for (int j = 0; j < M; j++)
+        {
+        sources[j] = Eigen::Vector3d(distrib(gen), distrib(gen), distrib(gen));
+        srcDen[j] = distrib(gen);
+        }
+    }
+
+BOOST_AUTO_TEST_CASE(direct_sum, *boost::unit_test::tolerance(1e-12))
+    {
+    // more targets and sources than a chunk and a block, with incomplete last ones
+    const int NOD = 150;
+    const int M = 2500;
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::vector<Eigen::Vector3d> targets, sources;
+    std::vector<double> srcDen;
+    random_particles(NOD, M, targets, sources, srcDen, gen);
+
+    Demag::directSum direct(targets, sources);
+    std::vector<double> pot(NOD);
+    Demag::durations t;
+    direct.potential(srcDen, pot, t);
+
+    for (int i = 0; i < NOD; i++)
+        {
+        double ref = 0;
+        for (int j = 0; j < M; j++)
+            { ref += srcDen[j] / (targets[i] - sources[j]).norm(); }
+        BOOST_TEST(pot[i] == ref);
+        }
+    BOOST_CHECK(t.execute > 0);
+    }
+
+BOOST_AUTO_TEST_CASE(hmatrix)
+    {
+    const int NOD = 2000;
+    const int M = 6000;
+    const double tol = 1e-5;
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::vector<Eigen::Vector3d> targets, sources;
+    std::vector<double> srcDen;
+    random_particles(NOD, M, targets, sources, srcDen, gen);
+
+    Demag::durations t;
+    std::vector<double> ref(NOD), pot(NOD);
+    Demag::directSum(targets, sources).potential(srcDen, ref, t);
+
+    const std::filesystem::path cacheDir =
+            std::filesystem::temp_directory_path() / ("ut_demag_" + std::to_string(sd));
+    std::filesystem::create_directory(cacheDir);
+    Demag::hMatrix hmat(targets, sources, tol, cacheDir);
+    BOOST_CHECK(hmat.compression() < 1);
+    BOOST_CHECK(!hmat.isFromCache());
+    hmat.potential(srcDen, pot, t);
+    Eigen::Map<Eigen::VectorXd> r(ref.data(), NOD), p(pot.data(), NOD);
+    BOOST_TEST((p - r).norm() <= 10 * tol * r.norm());
+
+    // the second one is read from the cache, and gives the same potentials
+    Demag::hMatrix cached(targets, sources, tol, cacheDir);
+    BOOST_CHECK(cached.isFromCache());
+    BOOST_CHECK(cached.getNbBlocks() == hmat.getNbBlocks());
+    std::vector<double> pot2(NOD);
+    cached.potential(srcDen, pot2, t);
+    BOOST_CHECK(pot2 == pot);
+
+    // another tolerance does not match the cache
+    Demag::hMatrix other(targets, sources, 2 * tol, cacheDir);
+    BOOST_CHECK(!other.isFromCache());
+
+    // a block of a corrupted cache does not match the cluster trees, the matrix is assembled again
+    for (auto const &entry : std::filesystem::directory_iterator(cacheDir))
+        {
+        std::fstream f(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(sizeof(uint64_t) + 4 * sizeof(int) + (NOD + M) * sizeof(int) + sizeof(int));
+        const int tgtNb = 1 << 30;
+        f.write(reinterpret_cast<const char *>(&tgtNb), sizeof(int));
+        }
+    Demag::hMatrix corrupted(targets, sources, tol, cacheDir);
+    BOOST_CHECK(!corrupted.isFromCache());
+    std::vector<double> pot3(NOD);
+    corrupted.potential(srcDen, pot3, t);
+    BOOST_CHECK(pot3 == pot);
+    std::filesystem::remove_all(cacheDir);
+    }
+
+BOOST_AUTO_TEST_CASE(incremental)
+    {
+    const int NOD = 1000;
+    const int M = 3000;
+    const int maxSteps = 3;
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::vector<Eigen::Vector3d> targets, sources;
+    std::vector<double> srcDen;
+    random_particles(NOD, M, targets, sources, srcDen, gen);
+
+    // the hierarchical matrix is a linear operator with a separate near field
+    Demag::hMatrix hmat(targets, sources, 1e-4, "");
+    Demag::incremental inc;
+    inc.configure(maxSteps);
+    Demag::durations t;
+    std::vector<double> pot(NOD), ref(NOD);
+    BOOST_CHECK(inc.solve(hmat, srcDen, pot, t) == Demag::incremental::FULL);
+
+    // the incremental potential is the one of a full computation
+    std::normal_distribution<> change(0, 1e-2);
+    for (int step = 0; step < maxSteps; step++)
+        {
+        for (double &q : srcDen)
+            { q += change(gen); }
+        BOOST_CHECK(inc.solve(hmat, srcDen, pot, t) == Demag::incremental::CHANGE);
+        hmat.potential(srcDen, ref, t);
+        Eigen::Map<Eigen::VectorXd> r(ref.data(), NOD), p(pot.data(), NOD);
+        BOOST_TEST((p - r).norm() <= 1e-12 * r.norm());
+        }
+    BOOST_CHECK(inc.solve(hmat, srcDen, pot, t) == Demag::incremental::FULL);
+
+    // the far field is skipped only for a change below the threshold
+    inc.configure(maxSteps, true, 1e-3);
+    BOOST_CHECK(inc.solve(hmat, srcDen, pot, t) == Demag::incremental::FULL);
+    srcDen[0] += 1e-6;
+    BOOST_CHECK(inc.solve(hmat, srcDen, pot, t) == Demag::incremental::NEAR);
+    srcDen[0] += 1;
+    BOOST_CHECK(inc.solve(hmat, srcDen, pot, t) == Demag::incremental::CHANGE);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,7 +17,7 @@ const int idxPrmToTest = 42;
 
 BOOST_AUTO_TEST_CASE(Fac_full_constructor)
     {
-    std::vector<Nodes::Node> node;
+    Nodes::Store node;
     std::cout << "4 param constructor" << std::endl;
     
     Facette::Fac f(node, 0, idxPrmToTest, {0, 0, 0});
@@ -42,9 +42,10 @@ BOOST_AUTO_TEST_CASE(Fac_full_constructor)
 BOOST_AUTO_TEST_CASE(Tet_constructor)
     {
     std::cout << "constructor test with empty node vector\n";
-    std::vector<Nodes::Node> node(0);
+    Nodes::Store node;
 
-    Tetra::Tet tet(node, idxPrmToTest, {0, 0, 0, 0});
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet tet(node, geom, idxPrmToTest, {0, 0, 0, 0});
     std::cout << "infos:\t";
     tet.infos();
     /*
@@ -65,9 +66,10 @@ BOOST_AUTO_TEST_CASE(Tet_constructor)
 BOOST_AUTO_TEST_CASE(Tet_constructor_with_wrong_init_list)
     {
     std::cout << "constructor test with empty node vector\n";
-    std::vector<Nodes::Node> node(0);
+    Nodes::Store node;
     const int extra(0);
-    Tetra::Tet tet(node, idxPrmToTest, {0, 0, 0, 0, extra});
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet tet(node, geom, idxPrmToTest, {0, 0, 0, 0, extra});
     BOOST_CHECK(tet.ind.empty());
     }
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include "tetra.h"
 #include "facette.h"
 #include "tiny.h"
+#include "time_integration.h"
 #include "ut_tools.h"
 #include "ut_config.h"
 
@@ -44,7 +45,9 @@ BOOST_AUTO_TEST_CASE(demagEnergy, *boost::unit_test::tolerance(UT_TOL))
         }
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
     t.Ms = 1.0;
     //Tetra::prm p_vol;
     //p_vol.J = 1.0;
@@ -84,7 +87,7 @@ BOOST_AUTO_TEST_CASE(demagEnergy, *boost::unit_test::tolerance(UT_TOL))
         dens[npi] = -0.5*Js* (u[0][npi]*Hdx[npi] + u[1][npi]*Hdy[npi] + u[2][npi]*Hdz[npi]);
         }
     double Edemag(0);
-    for (int npi=0; npi<Tetra::NPI; npi++) { Edemag += dens[npi]*t.weight[npi]; }
+    for (int npi=0; npi<Tetra::NPI; npi++) { Edemag += dens[npi]*t.weight(npi); }
     // end ref code
     
     //code to test
@@ -101,10 +104,10 @@ BOOST_AUTO_TEST_CASE(demagEnergy, *boost::unit_test::tolerance(UT_TOL))
     const int id = t.ind[3] + 1;
     
     std::vector<Facette::Fac> fa;
-    fa.push_back( Facette::Fac(node, nbNod, 0, {ia, ic, ib} ));
-    fa.push_back( Facette::Fac(node, nbNod, 0, {ib, ic, id} ));
-    fa.push_back( Facette::Fac(node, nbNod, 0, {ia, id, ic} ));
-    fa.push_back( Facette::Fac(node, nbNod, 0, {ia, ib, id} ));
+    fa.push_back( Facette::Fac(store, nbNod, 0, {ia, ic, ib} ));
+    fa.push_back( Facette::Fac(store, nbNod, 0, {ib, ic, id} ));
+    fa.push_back( Facette::Fac(store, nbNod, 0, {ia, id, ic} ));
+    fa.push_back( Facette::Fac(store, nbNod, 0, {ia, ib, id} ));
     std::for_each(fa.begin(),fa.end(),[&t](Facette::Fac &f){ f.Ms = t.Ms;});
     
     std::for_each(fa.begin(),fa.end(), [&result_to_test](Facette::Fac &f)
@@ -121,4 +124,56 @@ BOOST_AUTO_TEST_CASE(demagEnergy, *boost::unit_test::tolerance(UT_TOL))
     BOOST_TEST( Nodes::sq(result_to_test - Edemag) == 0.0 );
     }
 
+/*---------------------------------------*/
+/* test: energies computed by Tet::integrales from u0,phi0 are the energies computed from u,phi when u=u0 and phi=phi0 */
+/*---------------------------------------*/
+
+BOOST_AUTO_TEST_CASE(fusedEnergy, *boost::unit_test::tolerance(UT_TOL))
+    {
+    int nbNod = 4;
+    std::vector<Nodes::Node> node(nbNod);
+
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::uniform_real_distribution<> distrib(0.0, 1.0);
+
+    Eigen::Vector3d p[4] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    for (int i = 0; i < nbNod; i++)
+        {
+        node[i].p = p[i];
+        node[i].u0 = node[i].u = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
+        node[i].v0.setZero();
+        node[i].phi0 = node[i].phi = distrib(gen);
+        node[i].phiv0 = 0;
+        }
+    std::for_each(node.begin(), node.end(), [](Nodes::Node &n) { n.setBasis(0.0); });
+
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
+    t.Ms = 1.0;
+    t.buildMatP();
+    Tetra::prm param;
+    param.alpha_LLG = 0.5;
+    param.A = 1e-11;
+    param.J = 1.0;
+    param.K = 1e5;
+    param.uk = Eigen::Vector3d(0, 0, 1);
+    param.K3 = 0;
+    Eigen::Vector3d Hext(1e4, -2e4, 3e4);
+    timing t_prm(1e-9, 1e-16, 1e-12);
+
+    Energies E;
+    t.integrales(param, t_prm, Hext, Nodes::IDX_UNDEF, 0.0, &E);
+
+    Eigen::Matrix<double,Nodes::DIM,Tetra::NPI> u,dudx,dudy,dudz;
+    Eigen::Matrix<double,Tetra::NPI,1> phi;
+    t.interpolation(Nodes::get_u, u, dudx, dudy, dudz);
+    t.interpolation(Nodes::get_phi, phi);
+    BOOST_TEST(E.exch == t.exchangeEnergy(param, dudx, dudy, dudz));
+    BOOST_TEST(E.demag == t.demagEnergy(dudx, dudy, dudz, phi));
+    BOOST_TEST(E.aniso == t.anisotropyEnergy(param, u));
+    BOOST_TEST(E.zeeman == t.zeemanEnergy(param, Hext, u));
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -31,7 +31,7 @@ BOOST_AUTO_TEST_CASE(Fac_operator_infto)
             sd);  // random number generator: standard Mersenne twister initialized with seed
     std::uniform_int_distribution<int> distrib;
 
-    std::vector<Nodes::Node> node;
+    Nodes::Store node;
     Facette::Fac f(node, 0, 0, {0,0,0});
     bool test_result = !(f < f);  // whatever is f, f<f must return false
     std::cout<<" !(facette < facette): " << test_result << std::endl;
@@ -89,7 +89,8 @@ BOOST_AUTO_TEST_CASE(Fac_calc_surf, *boost::unit_test::tolerance(UT_TOL))
     node[1] = n2;
     node[2] = n3;
 
-    Facette::Fac f(node, nbNod, 0, {1, 2, 3});  // carefull with the index shift
+    const Nodes::Store store(node);
+    Facette::Fac f(store, nbNod, 0, {1, 2, 3});  // carefull with the index shift
 
     std::cout << "indices:" << f.ind[0] << ";" << f.ind[1] << ";" << f.ind[2] << std::endl;
 
@@ -124,7 +125,8 @@ BOOST_AUTO_TEST_CASE(Fac_interpolation_pt3D, *boost::unit_test::tolerance(UT_TOL
     node[1].u0 = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
     node[2].u0 = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
 
-    Facette::Fac f(node, nbNod, 0, {1, 2, 3});  // carefull with the index shift
+    const Nodes::Store store(node);
+    Facette::Fac f(store, nbNod, 0, {1, 2, 3});  // carefull with the index shift
 
     Eigen::Matrix<double,Pt::DIM,Facette::N> _vec_nod;
     for (int i = 0; i < Facette::N; i++) _vec_nod.col(i) = Nodes::get_u0(node[f.ind[i]]);
@@ -179,7 +181,8 @@ BOOST_AUTO_TEST_CASE(Fac_interpolation_double, *boost::unit_test::tolerance(UT_T
     node[1].phi0 = distrib(gen);
     node[2].phi0 = distrib(gen);
 
-    Facette::Fac f(node, nbNod, 0, {1, 2, 3});  // carefull with the index shift
+    const Nodes::Store store(node);
+    Facette::Fac f(store, nbNod, 0, {1, 2, 3});  // carefull with the index shift
 
     Eigen::Matrix<double,Facette::NPI,1> _p;
     f.interpolation(Nodes::get_phi0, _p);
@@ -235,7 +238,8 @@ BOOST_AUTO_TEST_CASE(Fac_potential_u, *boost::unit_test::tolerance(UT_TOL))
     node[1] = n2;
     node[2] = n3;
 
-    Facette::Fac f(node, nbNod, 0, {1, 2, 3});  // carefull with the index shift
+    const Nodes::Store store(node);
+    Facette::Fac f(store, nbNod, 0, {1, 2, 3});  // carefull with the index shift
     f.Ms = distrib(gen);
 
     int i = 0;
@@ -362,7 +366,8 @@ BOOST_AUTO_TEST_CASE(Fac_potential_v, *boost::unit_test::tolerance(10.0*UT_TOL))
     node[1] = n2;
     node[2] = n3;
 
-    Facette::Fac f(node, nbNod, 0, {1, 2, 3});  // carefull with the index shift
+    const Nodes::Store store(node);
+    Facette::Fac f(store, nbNod, 0, {1, 2, 3});  // carefull with the index shift
     f.Ms = distrib(gen);
 
     int i = 0;
@@ -457,6 +462,46 @@ BOOST_AUTO_TEST_CASE(Fac_potential_v, *boost::unit_test::tolerance(10.0*UT_TOL))
                "possible rounding error in potential on v corrections");
     }
 
+BOOST_AUTO_TEST_CASE(Fac_charges_corr, *boost::unit_test::tolerance(UT_TOL))
+    {
+    // the corrections returned facette by facette, then summed on the nodes, are the corrections
+    // accumulated directly on the nodes
+    std::cout << "fac charges and corrections test" << std::endl;
+    int nbNod = 4;
+    std::vector<Nodes::Node> node(nbNod);
+
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::uniform_real_distribution<> distrib(0.0, 1.0);
+
+    Eigen::Vector3d p[4] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0.5}};
+    for (int i = 0; i < nbNod; i++)
+        {
+        node[i].p = p[i] + 0.05 * Eigen::Vector3d(distrib(gen), distrib(gen), distrib(gen));
+        node[i].u = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
+        }
+    const Nodes::Store store(node);
+    std::vector<Facette::Fac> fac;
+    fac.push_back(Facette::Fac(store, nbNod, 0, {1, 2, 3}));
+    fac.push_back(Facette::Fac(store, nbNod, 0, {2, 4, 3}));
+
+    std::vector<double> corr(nbNod, 0.0);
+    std::vector<double> corr_to_test(nbNod, 0.0);
+    for (Facette::Fac &f : fac)
+        {
+        f.Ms = distrib(gen);
+        Eigen::Matrix<double, Facette::NPI, 1> q = f.charges<Nodes::VEC_U>(corr);
+        Eigen::Matrix<double, Facette::N, 1> nodCorr;
+        Eigen::Matrix<double, Facette::NPI, 1> q_to_test = f.charges<Nodes::VEC_U>(nodCorr);
+        for (int i = 0; i < Facette::N; i++)
+            { corr_to_test[f.ind[i]] += nodCorr(i); }
+        for (int j = 0; j < Facette::NPI; j++)
+            { BOOST_TEST(q_to_test(j) == q(j)); }
+        }
+    for (int i = 0; i < nbNod; i++)
+        { BOOST_TEST(corr_to_test[i] == corr[i]); }
+    }
+
 BOOST_AUTO_TEST_CASE(Fac_Pcoeff)
     {
     std::cout << "fac test on Nodes::Pcoeff template" << std::endl;
@@ -483,7 +528,8 @@ BOOST_AUTO_TEST_CASE(Fac_Pcoeff)
         node[i].setBasis(2 * M_PI * distrib(gen));
         }
 
-    Facette::Fac f(node, nbNod, 0, {1, 2, 3});  // carefull with the index shift
+    const Nodes::Store store(node);
+    Facette::Fac f(store, nbNod, 0, {1, 2, 3});  // carefull with the index shift
     f.buildMatP();
 
     /* ref code */
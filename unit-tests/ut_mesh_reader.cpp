@@ -0,0 +1,258 @@
+#define BOOST_TEST_MODULE meshReaderTest
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "mesh_reader.h"
+#include "ut_config.h"
+
+BOOST_AUTO_TEST_SUITE(ut_mesh_reader)
+
+/** two tetrahedrons sharing a facette, a triangle and a line, in gmsh format 2.2 */
+const std::string mesh22 = R"($MeshFormat
+2.2 0 8
+$EndMeshFormat
+$PhysicalNames
+2
+2 200 "surface"
+3 300 "volume"
+$EndPhysicalNames
+$Nodes
+5
+1 0 0 0
+2 1 0 0
+3 0 1 0
+4 0 0 1
+5 1 1 1
+$EndNodes
+$Elements
+4
+1 1 2 0 1 1 2
+2 2 2 200 1 1 2 3
+3 4 2 300 1 1 2 3 4
+4 4 2 300 1 2 3 4 5
+$EndElements
+)";
+
+/** the same mesh in gmsh format 4.1, with other node tags */
+const std::string mesh41 = R"($MeshFormat
+4.1 0 8
+$EndMeshFormat
+$PhysicalNames
+2
+2 200 "surface"
+3 300 "volume"
+$EndPhysicalNames
+$Entities
+0 1 1 1
+1 0 0 0 1 0 0 0 2 1 2
+1 0 0 0 1 1 0 1 200 0
+1 0 0 0 1 1 1 1 300 0
+$EndEntities
+$Nodes
+2 5 10 50
+2 1 0 3
+10
+20
+30
+0 0 0
+1 0 0
+0 1 0
+3 1 0 2
+40
+50
+0 0 1
+1 1 1
+$EndNodes
+$Elements
+3 4 1 4
+1 1 1 1
+1 10 20
+2 1 2 1
+2 10 20 30
+3 1 4 2
+3 10 20 30 40
+4 20 30 40 50
+$EndElements
+)";
+
+/** appends the bytes of x to s */
+template<class T>
+void put(std::string &s, const T x)
+    {
+    s.append(reinterpret_cast<const char *>(&x), sizeof(T));
+    }
+
+/** the same mesh in gmsh format 4.1 binary */
+std::string mesh41binary(void)
+    {
+    std::string s = "$MeshFormat\n4.1 1 8\n";
+    put<int>(s, 1);
+    s += "\n$EndMeshFormat\n$PhysicalNames\n2\n2 200 \"surface\"\n3 300 \"volume\"\n$EndPhysicalNames\n";
+    s += "$Entities\n";
+    for (size_t n : {0, 1, 1, 1})
+        { put<size_t>(s, n); }
+    for (int dim = 1; dim <= 3; dim++)
+        {
+        put<int>(s, 1);
+        for (int i = 0; i < 6; i++)
+            { put<double>(s, (i < 3) ? 0 : 1); }
+        put<size_t>(s, (dim == 1) ? 0 : 1);
+        if (dim > 1) put<int>(s, 100 * dim);
+        put<size_t>(s, (dim == 1) ? 2 : 0);
+        if (dim == 1)
+            {
+            put<int>(s, 1);
+            put<int>(s, 2);
+            }
+        }
+    s += "\n$EndEntities\n$Nodes\n";
+    for (size_t n : {1, 5, 10, 50})
+        { put<size_t>(s, n); }
+    put<int>(s, 3);
+    put<int>(s, 1);
+    put<int>(s, 0);
+    put<size_t>(s, 5);
+    for (size_t tag : {10, 20, 30, 40, 50})
+        { put<size_t>(s, tag); }
+    for (double x : {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1})
+        { put<double>(s, x); }
+    s += "\n$EndNodes\n$Elements\n";
+    for (size_t n : {3, 4, 1, 4})
+        { put<size_t>(s, n); }
+    const int blocks[3][3] = {{1, 1, 1}, {2, 1, 2}, {3, 1, 4}};
+    const std::vector<std::vector<size_t>> elems[3] = {{{1, 10, 20}}, {{2, 10, 20, 30}},
+                                                       {{3, 10, 20, 30, 40}, {4, 20, 30, 40, 50}}};
+    for (int b = 0; b < 3; b++)
+        {
+        for (int x : blocks[b])
+            { put<int>(s, x); }
+        put<size_t>(s, elems[b].size());
+        for (auto const &e : elems[b])
+            for (size_t x : e)
+                { put<size_t>(s, x); }
+        }
+    s += "\n$EndElements\n";
+    return s;
+    }
+
+/** checks the contents of the two tetrahedrons mesh */
+void check(Mesh::Gmsh::contents const &c)
+    {
+    BOOST_CHECK(c.withPhysicalNames);
+    BOOST_CHECK(c.surfRegNames.at(200) == "surface");
+    BOOST_CHECK(c.volRegNames.at(300) == "volume");
+    BOOST_REQUIRE(c.nodes.size() == 5);
+    BOOST_CHECK(c.nodes[1] == Eigen::Vector3d(1, 0, 0));
+    BOOST_CHECK(c.nodes[4] == Eigen::Vector3d(1, 1, 1));
+    BOOST_CHECK(c.nbElements == 4);
+    BOOST_CHECK(c.nbUnknown == 1);
+    BOOST_REQUIRE(c.triangles.size() == 1);
+    BOOST_CHECK(c.triangles[0].reg == 200);
+    BOOST_CHECK(c.triangles[0].ind[0] == 1 && c.triangles[0].ind[1] == 2 && c.triangles[0].ind[2] == 3);
+    BOOST_REQUIRE(c.tetrahedrons.size() == 2);
+    BOOST_CHECK(c.tetrahedrons[1].reg == 300);
+    BOOST_CHECK(c.tetrahedrons[1].ind[0] == 2 && c.tetrahedrons[1].ind[3] == 5);
+    }
+
+BOOST_AUTO_TEST_CASE(format22)
+    {
+    Mesh::Gmsh::contents c = Mesh::Gmsh::parse(mesh22.data(), mesh22.data() + mesh22.size());
+    BOOST_CHECK(c.version == "2.2");
+    BOOST_CHECK(!c.binary);
+    check(c);
+    }
+
+BOOST_AUTO_TEST_CASE(format41)
+    {
+    Mesh::Gmsh::contents c = Mesh::Gmsh::parse(mesh41.data(), mesh41.data() + mesh41.size());
+    BOOST_CHECK(c.version == "4.1");
+    BOOST_CHECK(!c.binary);
+    check(c);
+    }
+
+BOOST_AUTO_TEST_CASE(format41_binary)
+    {
+    const std::string s = mesh41binary();
+    Mesh::Gmsh::contents c = Mesh::Gmsh::parse(s.data(), s.data() + s.size());
+    BOOST_CHECK(c.binary);
+    check(c);
+    }
+
+/** node tags close to the number of nodes, and much larger */
+BOOST_AUTO_TEST_CASE(node_tags)
+    {
+    for (long first : {2L, 400000000L})
+        {
+        // the tags 10 to 50 of the nodes and of the elements become first to 5 first
+        const size_t nodes = mesh41.find("$Nodes");
+        std::string s = mesh41.substr(0, nodes);
+        std::string token;
+        for (char ch : mesh41.substr(nodes))
+            {
+            if (ch == ' ' || ch == '\n')
+                {
+                const bool isTag = (token.size() == 2 && token[1] == '0' && token[0] >= '1' && token[0] <= '5');
+                s += isTag ? std::to_string(first * (token[0] - '0')) : token;
+                s += ch;
+                token.clear();
+                }
+            else
+                { token += ch; }
+            }
+        check(Mesh::Gmsh::parse(s.data(), s.data() + s.size()));
+        }
+    }
+
+BOOST_AUTO_TEST_CASE(file)
+    {
+    const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "ut_mesh_reader.msh";
+        {
+        std::ofstream f(fileName);
+        f << mesh22;
+        }
+    check(Mesh::Gmsh::read(fileName.string()));
+    std::filesystem::remove(fileName);
+    }
+
+/** a file of several megabytes, parsed by several chunks, must be read exactly */
+BOOST_AUTO_TEST_CASE(chunks)
+    {
+    std::mt19937 gen(my_seed());
+    std::uniform_real_distribution<> distrib(-1e3, 1e3);
+    const int nbNod = 100000;
+    std::vector<Eigen::Vector3d> nodes(nbNod);
+    std::ostringstream ss;
+    ss.precision(17);
+    ss << "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n$Nodes\n" << nbNod << '\n';
+    for (int i = 0; i < nbNod; i++)
+        {
+        nodes[i] = Eigen::Vector3d(distrib(gen), distrib(gen), distrib(gen));
+        ss << i + 1 << '\t' << nodes[i].x() << '\t' << nodes[i].y() << '\t' << nodes[i].z() << '\n';
+        }
+    const int nbTet = nbNod - 3;
+    ss << "$EndNodes\n$Elements\n" << nbTet << '\n';
+    for (int k = 0; k < nbTet; k++)
+        { ss << k + 1 << " 4 2 " << 300 + k % 2 << " 1 " << k + 1 << ' ' << k + 2 << ' ' << k + 3 << ' ' << k + 4 << '\n'; }
+    ss << "$EndElements\n";
+    const std::string s = ss.str();
+    BOOST_TEST_REQUIRE(s.size() > 4u << 20);
+
+    Mesh::Gmsh::contents c = Mesh::Gmsh::parse(s.data(), s.data() + s.size());
+    BOOST_CHECK(!c.withPhysicalNames);
+    BOOST_REQUIRE(c.nodes == nodes);
+    BOOST_REQUIRE(c.tetrahedrons.size() == (size_t)nbTet);
+    bool ordered = true;
+    for (int k = 0; k < nbTet; k++)
+        {
+        Mesh::Gmsh::element const &e = c.tetrahedrons[k];
+        ordered &= (e.reg == 300 + k % 2 && e.ind[0] == k + 1 && e.ind[3] == k + 4);
+        }
+    BOOST_CHECK(ordered);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -112,4 +112,55 @@ BOOST_AUTO_TEST_CASE(node_evol, *boost::unit_test::tolerance(1e3 * UT_TOL))
     BOOST_TEST( (n.v - v).norm() == 0.0);
     }
 
+BOOST_AUTO_TEST_CASE(node_store, *boost::unit_test::tolerance(UT_TOL))
+    {
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::uniform_real_distribution<> distrib(-1.0, 1.0);
+
+    const int nbNod = 16;
+    std::vector<Nodes::Node> node(nbNod);
+    for (Nodes::Node &n : node)
+        {
+        n.p = Eigen::Vector3d(distrib(gen), distrib(gen), distrib(gen));
+        n.u0 = unit_vector(M_PI * distrib(gen), distrib(gen));
+        n.u = unit_vector(M_PI * distrib(gen), distrib(gen));
+        n.v0 = n.v = Eigen::Vector3d::Zero();
+        n.phi0 = n.phi = distrib(gen);
+        n.phiv0 = n.phiv = distrib(gen);
+        }
+
+    Nodes::Store store(node);
+    BOOST_CHECK(store.size() == nbNod);
+
+    // the struct of arrays must behave as the vector of nodes
+    const double r = M_PI * distrib(gen);
+    const double vp = distrib(gen), vq = distrib(gen), dt = distrib(gen) + 1.0;
+    store.setBasis(r);
+    for (int i = 0; i < nbNod; i++)
+        {
+        node[i].setBasis(r);
+        node[i].make_evol(vp, vq, dt);
+        node[i].evolution();
+        store.make_evol(i, vp, vq, dt);
+        }
+    store.evolution();
+
+    double result(0);
+    for (int i = 0; i < nbNod; i++)
+        {
+        Nodes::Node n = store.getNode(i);
+        result += (n.p - node[i].p).norm() + (n.u0 - node[i].u0).norm()
+                  + (n.v0 - node[i].v0).norm() + (n.u - node[i].u).norm()
+                  + (n.v - node[i].v).norm() + (n.ep - node[i].ep).norm()
+                  + (n.eq - node[i].eq).norm() + fabs(n.phi0 - node[i].phi0)
+                  + fabs(n.phiv0 - node[i].phiv0);
+        result += (store.get<Nodes::VEC_U>(i) - Nodes::get<Nodes::VEC_U>(node[i])).norm()
+                  + fabs(store.get<Nodes::SCAL_PHI>(i) - Nodes::get<Nodes::SCAL_PHI>(node[i]));
+        }
+
+    if (!DET_UT) std::cout << "seed =" << sd << std::endl;
+    BOOST_TEST(result == 0.0);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
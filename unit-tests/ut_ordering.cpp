@@ -0,0 +1,147 @@
+#define BOOST_TEST_MODULE orderingTest
+
+#include <algorithm>
+#include <numeric>
+
+#include <boost/test/unit_test.hpp>
+
+#include "ordering.h"
+
+/** returns the inverse of the permutation perm */
+std::vector<int> inverse(std::vector<int> const &perm)
+    {
+    std::vector<int> inv(perm.size());
+    for (size_t i = 0; i < perm.size(); i++)
+        { inv[perm[i]] = i; }
+    return inv;
+    }
+
+/** returns true if perm is a permutation of 0 .. n-1 */
+bool isPermutation(std::vector<int> perm, const size_t n)
+    {
+    std::sort(perm.begin(), perm.end());
+    std::vector<int> identity(n);
+    std::iota(identity.begin(), identity.end(), 0);
+    return perm == identity;
+    }
+
+/** nodes of a regular grid of n^3 points of unit spacing */
+std::vector<Eigen::Vector3d> grid(const int n)
+    {
+    std::vector<Eigen::Vector3d> p;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            for (int k = 0; k < n; k++)
+                { p.push_back(Eigen::Vector3d(k, j, i)); }
+    return p;
+    }
+
+BOOST_AUTO_TEST_SUITE(ut_ordering)
+
+BOOST_AUTO_TEST_CASE(names)
+    {
+    for (Ordering::type t : {Ordering::LONGEST_AXIS, Ordering::RCM, Ordering::HILBERT, Ordering::MORTON})
+        {
+        Ordering::type u = Ordering::LONGEST_AXIS;
+        BOOST_CHECK(Ordering::fromName(Ordering::name(t), u));
+        BOOST_CHECK(t == u);
+        }
+    Ordering::type u = Ordering::RCM;
+    BOOST_CHECK(!Ordering::fromName("amd", u));
+    BOOST_CHECK(u == Ordering::RCM);
+    }
+
+BOOST_AUTO_TEST_CASE(graph)
+    {
+    // two tetrahedrons sharing the face 1 2 3
+    Ordering::graph g = Ordering::buildGraph(5, {0, 1, 2, 3, 1, 2, 3, 4}, 4);
+    BOOST_CHECK(g[0] == std::vector<int>({1, 2, 3}));
+    BOOST_CHECK(g[1] == std::vector<int>({0, 2, 3, 4}));
+    BOOST_CHECK(g[4] == std::vector<int>({1, 2, 3}));
+
+    std::vector<int> identity(5);
+    std::iota(identity.begin(), identity.end(), 0);
+    Ordering::profile prf = Ordering::measure(g, identity);
+    BOOST_CHECK(prf.bandwidth == 3);
+    BOOST_CHECK(prf.envelope == 0 + 1 + 2 + 3 + 3);
+    }
+
+BOOST_AUTO_TEST_CASE(rcm_path)
+    {
+    // path through the nodes in a scrambled numbering, plus an isolated node and a second path
+    const std::vector<int> path = {7, 2, 9, 0, 5, 3, 8, 1};
+    std::vector<int> segments;
+    for (size_t i = 0; i + 1 < path.size(); i++)
+        segments.insert(segments.end(), {path[i], path[i + 1]});
+    segments.insert(segments.end(), {10, 6, 6, 11});
+    Ordering::graph g = Ordering::buildGraph(13, segments, 2);
+
+    std::vector<int> perm = Ordering::rcm(g);
+    BOOST_CHECK(isPermutation(perm, g.size()));
+    Ordering::profile prf = Ordering::measure(g, inverse(perm));
+    BOOST_CHECK(prf.bandwidth == 1);
+    BOOST_CHECK(prf.envelope == 7 + 2);
+    }
+
+BOOST_AUTO_TEST_CASE(rcm_grid)
+    {
+    // 2D grid of 10x10 nodes numbered column by column with a stride, linked by segments
+    const int n = 10;
+    auto id = [n](const int i, const int j) { return (7 * (i * n + j)) % (n * n); };
+    std::vector<int> segments;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            {
+            if (i + 1 < n) segments.insert(segments.end(), {id(i, j), id(i + 1, j)});
+            if (j + 1 < n) segments.insert(segments.end(), {id(i, j), id(i, j + 1)});
+            }
+    Ordering::graph g = Ordering::buildGraph(n * n, segments, 2);
+    std::vector<int> identity(n * n);
+    std::iota(identity.begin(), identity.end(), 0);
+
+    std::vector<int> perm = Ordering::rcm(g);
+    BOOST_CHECK(isPermutation(perm, g.size()));
+    Ordering::profile before = Ordering::measure(g, identity);
+    Ordering::profile after = Ordering::measure(g, inverse(perm));
+    BOOST_TEST_MESSAGE("bandwidth " << before.bandwidth << " -> " << after.bandwidth);
+    BOOST_CHECK(after.bandwidth <= n + 1);
+    BOOST_CHECK(after.envelope < before.envelope);
+    }
+
+BOOST_AUTO_TEST_CASE(hilbert)
+    {
+    // consecutive nodes of a Hilbert curve through a regular grid are neighbours
+    const std::vector<Eigen::Vector3d> p = grid(8);
+    std::vector<int> perm = Ordering::hilbert(p);
+    BOOST_CHECK(isPermutation(perm, p.size()));
+    for (size_t i = 0; i + 1 < perm.size(); i++)
+        { BOOST_CHECK_CLOSE((p[perm[i + 1]] - p[perm[i]]).norm(), 1.0, 1e-12); }
+    }
+
+BOOST_AUTO_TEST_CASE(morton)
+    {
+    // the Morton curve visits the octants one after the other
+    const std::vector<Eigen::Vector3d> p = grid(4);
+    std::vector<int> perm = Ordering::morton(p);
+    BOOST_CHECK(isPermutation(perm, p.size()));
+    for (size_t i = 0; i < perm.size(); i += 8)
+        {
+        Eigen::Vector3d pmin = p[perm[i]], pmax = p[perm[i]];
+        for (size_t j = i; j < i + 8; j++)
+            {
+            pmin = pmin.cwiseMin(p[perm[j]]);
+            pmax = pmax.cwiseMax(p[perm[j]]);
+            }
+        BOOST_CHECK((pmax - pmin).isApprox(Eigen::Vector3d(1, 1, 1)));
+        }
+    BOOST_CHECK(p[perm[0]].isZero());
+    }
+
+BOOST_AUTO_TEST_CASE(along_axis)
+    {
+    const std::vector<Eigen::Vector3d> p = {{0, 3, 1}, {1, 1, 2}, {2, 2, 0}};
+    BOOST_CHECK(Ordering::alongAxis(p, 1) == std::vector<int>({1, 2, 0}));
+    BOOST_CHECK(Ordering::alongAxis(p, 2) == std::vector<int>({2, 0, 1}));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
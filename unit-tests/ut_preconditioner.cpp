@@ -0,0 +1,132 @@
+#define BOOST_TEST_MODULE preconditionerTest
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "preconditioner.h"
+#include "ut_config.h"
+
+BOOST_AUTO_TEST_SUITE(ut_preconditioner)
+
+/** random sparse matrix of size 2*NOD with a 2x2 block per node, coupled to its neighbours along a
+ * ring of nodes, diagonally dominant if dominant is true */
+Precond::spMat build_matrix(const int NOD, const int nb_neighbours, bool dominant, std::mt19937 &gen)
+    {
+    std::uniform_real_distribution<> distrib(-1.0, 1.0);
+    std::vector<Eigen::Triplet<double>> w;
+    for (int i = 0; i < NOD; i++)
+        {
+        for (int k = -nb_neighbours; k <= nb_neighbours; k++)
+            {
+            const int j = (i + k + NOD) % NOD;
+            for (int a = 0; a < 2; a++)
+                for (int b = 0; b < 2; b++)
+                    {
+                    double val = distrib(gen);
+                    if (k == 0 && a == b && dominant)
+                        { val += 8.0 * (2 * nb_neighbours + 1); }
+                    w.emplace_back(a * NOD + i, b * NOD + j, val);
+                    }
+            }
+        }
+    Precond::spMat A(2 * NOD, 2 * NOD);
+    A.setFromTriplets(w.begin(), w.end());
+    return A;
+    }
+
+BOOST_AUTO_TEST_CASE(names)
+    {
+    for (Precond::type t : {Precond::NONE, Precond::JACOBI, Precond::BLOCK_JACOBI, Precond::ILU0,
+                            Precond::ILUT})
+        {
+        Precond::type result;
+        BOOST_CHECK(Precond::fromName(Precond::name(t), result));
+        BOOST_CHECK(result == t);
+        }
+    Precond::type result;
+    BOOST_CHECK(!Precond::fromName("ilu", result));
+    }
+
+BOOST_AUTO_TEST_CASE(block_jacobi_exact, *boost::unit_test::tolerance(1e-12))
+    {
+    // with no coupling between nodes, the block jacobi preconditioner is the inverse
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    const int NOD = 50;
+    Precond::spMat A = build_matrix(NOD, 0, true, gen);
+    Eigen::VectorXd x_ref = Eigen::VectorXd::Random(2 * NOD);
+    Eigen::VectorXd b = A * x_ref;
+
+    Precond::wrapper M;
+    M.select(Precond::BLOCK_JACOBI);
+    M.compute(A);
+    BOOST_CHECK(M.info() == Eigen::Success);
+    double result = (M.solve(b) - x_ref).norm();
+    std::cout << "block jacobi: distance = " << result << std::endl;
+    BOOST_TEST(result == 0.0);
+    }
+
+BOOST_AUTO_TEST_CASE(ilu0_exact, *boost::unit_test::tolerance(1e-12))
+    {
+    // a tridiagonal matrix has no fill-in: ilu0 is the exact LU factorization
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::uniform_real_distribution<> distrib(-1.0, 1.0);
+    const int n = 100;
+    std::vector<Eigen::Triplet<double>> w;
+    for (int i = 0; i < n; i++)
+        {
+        w.emplace_back(i, i, 4.0 + distrib(gen));
+        if (i > 0) w.emplace_back(i, i - 1, distrib(gen));
+        if (i < n - 1) w.emplace_back(i, i + 1, distrib(gen));
+        }
+    Precond::spMat A(n, n);
+    A.setFromTriplets(w.begin(), w.end());
+    Eigen::VectorXd x_ref = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd b = A * x_ref;
+
+    Precond::wrapper M;
+    M.select(Precond::ILU0);
+    M.compute(A);
+    BOOST_CHECK(M.info() == Eigen::Success);
+    double result = (M.solve(b) - x_ref).norm();
+    std::cout << "ilu0: distance = " << result << std::endl;
+    BOOST_TEST(result == 0.0);
+    }
+
+BOOST_AUTO_TEST_CASE(bicgstab_convergence)
+    {
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    const int NOD = 400;
+    const double tol = 1e-8;
+    Precond::spMat A = build_matrix(NOD, 3, true, gen);
+    Eigen::VectorXd x_ref = Eigen::VectorXd::Random(2 * NOD);
+    Eigen::VectorXd b = A * x_ref;
+
+    for (Precond::type t : {Precond::NONE, Precond::JACOBI, Precond::BLOCK_JACOBI, Precond::ILU0,
+                            Precond::ILUT})
+        {
+        Eigen::BiCGSTAB<Precond::spMat, Precond::wrapper> solver;
+        solver.setTolerance(tol);
+        solver.setMaxIterations(500);
+        solver.preconditioner().select(t);
+        solver.analyzePattern(A);
+        // values may change without a new pattern analysis
+        for (int k = 0; k < 2; k++)
+            {
+            A.coeffs() *= 2.0;
+            b *= 2.0;
+            solver.factorize(A);
+            BOOST_CHECK(solver.info() == Eigen::Success);
+            Eigen::VectorXd x = solver.solve(b);
+            std::cout << Precond::name(t) << ": " << solver.iterations() << " iterations, error "
+                      << solver.error() << std::endl;
+            BOOST_CHECK(solver.info() == Eigen::Success);
+            BOOST_CHECK((x - x_ref).norm() < 1e3 * tol * x_ref.norm());
+            }
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
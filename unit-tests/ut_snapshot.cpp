@@ -0,0 +1,88 @@
+#define BOOST_TEST_MODULE snapshotTest
+
+#include <filesystem>
+#include <fstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "snapshot.h"
+
+/** returns a snapshot of n nodes */
+Snapshot::data makeSnapshot(const int n, const bool singlePrecision)
+    {
+    Snapshot::data d;
+    d.t = 1.25e-9;
+    d.metadata = "## time: 1.25e-9\n## columns: idx\tmx\tmy\tmz\tphi\n";
+    d.singlePrecision = singlePrecision;
+    for (int i = 0; i < n; i++)
+        {
+        d.u.insert(d.u.end(), {0.6, -0.8 + 1e-10 * i, 0.0});
+        d.phi.push_back(1.0 / (i + 3));
+        }
+    return d;
+    }
+
+BOOST_AUTO_TEST_SUITE(ut_snapshot)
+
+BOOST_AUTO_TEST_CASE(double_precision)
+    {
+    const std::string fileName = (std::filesystem::temp_directory_path() / "ut_snapshot_d.solb").string();
+    const Snapshot::data d = makeSnapshot(100000, false);
+    BOOST_CHECK(Snapshot::write(fileName, d));
+    BOOST_CHECK(Snapshot::isSnapshot(fileName));
+
+    const Snapshot::data r = Snapshot::read(fileName);
+    BOOST_CHECK(r.t == d.t);
+    BOOST_CHECK(r.metadata == d.metadata);
+    BOOST_CHECK(!r.singlePrecision);
+    BOOST_CHECK(r.nbNodes() == d.nbNodes());
+    BOOST_CHECK(r.u == d.u);
+    BOOST_CHECK(r.phi == d.phi);
+    std::filesystem::remove(fileName);
+    }
+
+BOOST_AUTO_TEST_CASE(single_precision)
+    {
+    const std::string fileName = (std::filesystem::temp_directory_path() / "ut_snapshot_f.solb").string();
+    const Snapshot::data d = makeSnapshot(70000, true);
+    BOOST_CHECK(Snapshot::write(fileName, d));
+    BOOST_CHECK(std::filesystem::file_size(fileName) < 4 * sizeof(float) * 70000 + 200);
+
+    const Snapshot::data r = Snapshot::read(fileName);
+    BOOST_CHECK(r.singlePrecision);
+    BOOST_CHECK(r.nbNodes() == d.nbNodes());
+    for (size_t i = 0; i < d.u.size(); i++)
+        { BOOST_CHECK(r.u[i] == float(d.u[i])); }
+    for (size_t i = 0; i < d.phi.size(); i++)
+        { BOOST_CHECK(r.phi[i] == float(d.phi[i])); }
+    std::filesystem::remove(fileName);
+    }
+
+BOOST_AUTO_TEST_CASE(text_file)
+    {
+    const std::string fileName = (std::filesystem::temp_directory_path() / "ut_snapshot.sol").string();
+    std::ofstream(fileName) << "## time: 0\n0\t1\t0\t0\t0\n";
+    BOOST_CHECK(!Snapshot::isSnapshot(fileName));
+    BOOST_CHECK(!Snapshot::isSnapshot(fileName + ".missing"));
+    std::filesystem::remove(fileName);
+    }
+
+BOOST_AUTO_TEST_CASE(writer)
+    {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    Snapshot::writer w;
+    for (int k = 0; k < 3; k++)
+        {
+        Snapshot::data d = makeSnapshot(1000 * (k + 1), false);
+        w.push((dir / ("ut_snapshot_" + std::to_string(k) + ".solb")).string(), std::move(d));
+        }
+    w.wait();
+    for (int k = 0; k < 3; k++)
+        {
+        const std::string fileName = (dir / ("ut_snapshot_" + std::to_string(k) + ".solb")).string();
+        BOOST_CHECK(Snapshot::read(fileName).nbNodes() == 1000 * (k + 1));
+        std::filesystem::remove(fileName);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
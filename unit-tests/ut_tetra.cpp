@@ -55,7 +55,9 @@ BOOST_AUTO_TEST_CASE(Tet_inner_tables, *boost::unit_test::tolerance(UT_TOL))
         { node[i].u0 = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen)); }
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
     t.infos();
 
     // ref code (with minimal adaptations of dad(x|y|z) in file Mesh_hat.cc of
@@ -95,7 +97,9 @@ BOOST_AUTO_TEST_CASE(Tet_inner_tables, *boost::unit_test::tolerance(UT_TOL))
 
     // end ref code
 
-    // the Tet constructor is computing dad(x|y|z)
+    // the Tet constructor is computing dad(x|y|z) and storing them in the geometry table
+    BOOST_CHECK(geom.size() == 1);
+    BOOST_TEST(t.detJ() == detJ);
 
     double result_dadx(0.0), result_dady(0.0), result_dadz(0.0), result_w(0.0);
     for (int npi = 0; npi < Tetra::NPI; npi++)
@@ -106,7 +110,7 @@ BOOST_AUTO_TEST_CASE(Tet_inner_tables, *boost::unit_test::tolerance(UT_TOL))
             result_dady += Pt::sq(_dady[ie][npi] - t.dady(ie,npi));
             result_dadz += Pt::sq(_dadz[ie][npi] - t.dadz(ie,npi));
             }
-        result_w += Pt::sq(weight[npi] - t.weight[npi]);
+        result_w += Pt::sq(weight[npi] - t.weight(npi));
         }
 
     std::cout << "sq_frob norm diff dadx,dady,dadz= " << result_dadx << " ; " << result_dady
@@ -141,7 +145,9 @@ BOOST_AUTO_TEST_CASE(Tet_calc_vol, *boost::unit_test::tolerance(UT_TOL))
     node[3] = n3;
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
 
     double result = 1 / 6.0;
     double vol = t.calc_vol();
@@ -208,7 +214,9 @@ BOOST_AUTO_TEST_CASE(Tet_nod_interpolation, *boost::unit_test::tolerance(UT_TOL)
         }
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
 
     double t_dadx[Tetra::N][Tetra::NPI],t_dady[Tetra::N][Tetra::NPI],t_dadz[Tetra::N][Tetra::NPI];
     
@@ -372,7 +380,9 @@ BOOST_AUTO_TEST_CASE(Tet_nod_interpolation2, *boost::unit_test::tolerance(UT_TOL
         }
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
 
     double t_dadx[Tetra::N][Tetra::NPI],t_dady[Tetra::N][Tetra::NPI],t_dadz[Tetra::N][Tetra::NPI];
     
@@ -449,6 +459,60 @@ BOOST_AUTO_TEST_CASE(Tet_nod_interpolation2, *boost::unit_test::tolerance(UT_TOL
     BOOST_TEST(n_Hv_ref == n_Hv);
     }
 
+BOOST_AUTO_TEST_CASE(Tet_accessors, *boost::unit_test::tolerance(UT_TOL))
+    {
+    int nbNod = 4;
+    std::vector<Nodes::Node> node(nbNod);
+
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    std::uniform_real_distribution<> distrib(0.0, 1.0);
+
+    node[0].p = Eigen::Vector3d(0, 0, 0);
+    node[1].p = Eigen::Vector3d(1, 0, 0);
+    node[2].p = Eigen::Vector3d(0, 1, 0);
+    node[3].p = Eigen::Vector3d(0, 0, 1);
+    for (int i = 0; i < nbNod; i++)
+        {
+        node[i].u = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
+        node[i].v0 = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
+        node[i].phi0 = distrib(gen);
+        }
+
+    // carefull with indices (starting from 1)
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
+
+    // compile time accessors must give the same results as the getters given at runtime
+    Eigen::Matrix<double,Pt::DIM,Tetra::NPI> U,dUdx,dUdy,dUdz, U_ref,dUdx_ref,dUdy_ref,dUdz_ref;
+    t.interpolation<Nodes::VEC_U>(U, dUdx, dUdy, dUdz);
+    t.interpolation(Nodes::get_u, U_ref, dUdx_ref, dUdy_ref, dUdz_ref);
+    BOOST_TEST((U - U_ref).norm() == 0.0);
+    BOOST_TEST((dUdx - dUdx_ref).norm() == 0.0);
+    BOOST_TEST((dUdy - dUdy_ref).norm() == 0.0);
+    BOOST_TEST((dUdz - dUdz_ref).norm() == 0.0);
+
+    Eigen::Matrix<double,Pt::DIM,Tetra::NPI> Hd, Hd_ref;
+    t.interpolation_field<Nodes::SCAL_PHI0>(Hd);
+    t.interpolation_field(Nodes::get_phi0, Hd_ref);
+    BOOST_TEST((Hd - Hd_ref).norm() == 0.0);
+
+    Eigen::Matrix<double,Tetra::NPI,1> phi, phi_ref, vy, vy_ref, q, q_ref;
+    t.interpolation<Nodes::SCAL_PHI0>(phi);
+    t.interpolation(Nodes::get_phi0, phi_ref);
+    BOOST_TEST((phi - phi_ref).norm() == 0.0);
+
+    t.interpolation<Nodes::VEC_V0>(Nodes::IDX_Y, vy);
+    t.interpolation(Nodes::get_v0_comp, Nodes::IDX_Y, vy_ref);
+    BOOST_TEST((vy - vy_ref).norm() == 0.0);
+
+    q = t.charges<Nodes::VEC_U>();
+    q_ref = t.charges(Nodes::get_u);
+    BOOST_TEST((q - q_ref).norm() == 0.0);
+    if (!DET_UT) std::cout << "seed =" << sd << std::endl;
+    }
+
 BOOST_AUTO_TEST_CASE(Tet_lumping, *boost::unit_test::tolerance(UT_TOL))
     {
     Eigen::Matrix<double, 3*Tetra::N, 3*Tetra::N> AE_to_check;
@@ -483,7 +547,9 @@ BOOST_AUTO_TEST_CASE(Tet_lumping, *boost::unit_test::tolerance(UT_TOL))
         }
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
     
     double a = distrib(gen);
     double b = distrib(gen);
@@ -521,7 +587,7 @@ BOOST_AUTO_TEST_CASE(Tet_lumping, *boost::unit_test::tolerance(UT_TOL))
 
         double R = dt / TAUR * abs(log(dt / TAUR));
 
-        w = t.weight[npi];
+        w = t.weight(npi);
         for (int ie = 0; ie < Tetra::N; ie++)
             {
             ai = Tetra::a[ie][npi];
@@ -597,7 +663,9 @@ BOOST_AUTO_TEST_CASE(Tet_Pcoeff)
         }
 
     // carefull with indices (starting from 1)
-    Tetra::Tet t(node, 0, {1, 2, 3, 4});
+    const Nodes::Store store(node);
+    std::vector<Tetra::geometry> geom;
+    Tetra::Tet t(store, geom, 0, {1, 2, 3, 4});
     t.buildMatP();
 
     /* ref code */
@@ -0,0 +1,150 @@
+#define BOOST_TEST_MODULE tetraBatchTest
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "tetra_batch.h"
+#include "ut_tools.h"
+#include "ut_config.h"
+
+BOOST_AUTO_TEST_SUITE(ut_tetra_batch)
+
+/** builds a cube of n^3 cells of size h, see build_cube in ut_tools.h, with random magnetization and
+ * potentials. The tetrahedrons are spread over two regions. */
+void build_random_cube(const int n, const double h, Nodes::Store &node, std::vector<Tetra::geometry> &geom,
+                       std::vector<Tetra::Tet> &tet, std::mt19937 &gen)
+    {
+    build_cube(n, h, node, geom, tet);
+    std::uniform_real_distribution<> distrib(0.0, 1.0);
+    for (int m = 0; m < node.size(); m++)
+        {
+        node.u0[m] = rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
+        node.v0[m] = 1e9 * distrib(gen) * rand_vec3d(M_PI * distrib(gen), 2 * M_PI * distrib(gen));
+        node.phi0[m] = 1e4 * (distrib(gen) - 0.5);
+        node.phiv0[m] = 1e4 * (distrib(gen) - 0.5);
+        }
+    node.setBasis(M_2_PI * distrib(gen));
+
+    for (int k = 0; k < (int)tet.size(); k++)
+        {
+        tet[k].idxPrm = (k % 3 == 0) ? 1 : 0;
+        tet[k].idx = k;
+        tet[k].Ms = 1.0 / mu0;
+        tet[k].buildMatP();
+        }
+    }
+
+/** two sets of material parameters, with both kinds of anisotropy */
+std::vector<Tetra::prm> params(void)
+    {
+    std::vector<Tetra::prm> param(2);
+    param[0].alpha_LLG = 0.5;
+    param[0].A = 1e-11;
+    param[0].J = 1.0;
+    param[0].K = 1e5;
+    param[0].uk = Eigen::Vector3d(1, 2, 3).normalized();
+    param[0].K3 = 5e4;
+    param[0].ex = Eigen::Vector3d(1, 1, 0).normalized();
+    param[0].ey = Eigen::Vector3d(-1, 1, 0).normalized();
+    param[0].ez = Eigen::Vector3d(0, 0, 1);
+    param[1] = param[0];
+    param[1].alpha_LLG = 0.02;
+    param[1].A = 2e-11;
+    param[1].J = 1.5;
+    param[1].K = 0;
+    param[1].K3 = 0;
+    return param;
+    }
+
+/** random spin transfer torque contributions for nbTet tetrahedrons */
+Tetra::sttTerms random_stt(const int nbTet, std::mt19937 &gen)
+    {
+    std::uniform_real_distribution<> distrib(-1.0, 1.0);
+    Tetra::sttTerms stt;
+    stt.sigma = 5.8e7;
+    stt.ksi = 0.01;
+    stt.pf = 1e-20;
+    stt.D0 = 1e-3;
+    stt.lJ = 1e-9;
+    for (int k = 0; k < nbTet; k++)
+        {
+        stt.gradV.push_back(1e7 * Eigen::Vector3d(distrib(gen), distrib(gen), distrib(gen)));
+        stt.Hm.push_back(Eigen::Matrix<double, Nodes::DIM, Tetra::NPI>::NullaryExpr(
+                [&distrib, &gen]() { return 1e4 * distrib(gen); }));
+        }
+    return stt;
+    }
+
+/** checks the batches of L tetrahedrons against Tet::integrales, with a recentering drift along idx_dir, and
+ * with spin transfer torque contributions if withSTT is true */
+template<int L>
+void check_batches(Nodes::index idx_dir, const bool withSTT)
+    {
+    unsigned sd = my_seed();
+    std::mt19937 gen(sd);
+    Nodes::Store node;
+    std::vector<Tetra::geometry> geom;
+    std::vector<Tetra::Tet> tet;
+    build_random_cube(3, 5e-9, node, geom, tet, gen);
+    const std::vector<Tetra::prm> param = params();
+
+    const Eigen::Vector3d Hext(1e4, -2e4, 3e4);
+    timing t_prm(1e-9, 1e-16, 1e-12);
+    const double Vdrift = 10.0;
+    const Tetra::sttTerms stt_terms = random_stt(tet.size(), gen);
+    const Tetra::sttTerms *stt = withSTT ? &stt_terms : nullptr;
+
+    std::vector<Energies> E_ref(tet.size());
+    std::vector<Eigen::Matrix<double, 2 * Tetra::N, 2 * Tetra::N>> Kp_ref;
+    std::vector<Eigen::Matrix<double, 2 * Tetra::N, 1>> Lp_ref;
+    for (unsigned k = 0; k < tet.size(); k++)
+        {
+        tet[k].integrales(param[tet[k].idxPrm], t_prm, Hext, idx_dir, Vdrift, &E_ref[k], stt);
+        Kp_ref.push_back(tet[k].Kp);
+        Lp_ref.push_back(tet[k].Lp);
+        tet[k].Kp.setZero();
+        tet[k].Lp.setZero();
+        }
+
+    const std::vector<Tetra::batch<L>> batches = Tetra::makeBatches<L>(tet);
+    std::vector<int> count(tet.size(), 0);
+    for (Tetra::batch<L> const &b : batches)
+        for (int l = 0; l < b.nb; l++)
+            {
+            BOOST_CHECK(tet[b.idx[l]].idxPrm == b.idxPrm);
+            count[b.idx[l]]++;
+            }
+    BOOST_CHECK(std::all_of(count.begin(), count.end(), [](int c) { return c == 1; }));
+
+    std::vector<Energies> E(tet.size());
+    for (Tetra::batch<L> const &b : batches)
+        { Tetra::integrales<L>(b, tet, param[b.idxPrm], t_prm, Hext, idx_dir, Vdrift, E.data(), stt); }
+
+    const double eps = 1e-12;
+    for (unsigned k = 0; k < tet.size(); k++)
+        {
+        BOOST_TEST((tet[k].Kp - Kp_ref[k]).norm() <= eps * Kp_ref[k].norm());
+        BOOST_TEST((tet[k].Lp - Lp_ref[k]).norm() <= eps * Lp_ref[k].norm());
+        BOOST_TEST(fabs(E[k].exch - E_ref[k].exch) <= eps * fabs(E_ref[k].exch));
+        BOOST_TEST(fabs(E[k].demag - E_ref[k].demag) <= eps * fabs(E_ref[k].demag));
+        BOOST_TEST(fabs(E[k].aniso - E_ref[k].aniso) <= eps * fabs(E_ref[k].aniso));
+        BOOST_TEST(fabs(E[k].zeeman - E_ref[k].zeeman) <= eps * fabs(E_ref[k].zeeman));
+        }
+    }
+
+BOOST_AUTO_TEST_CASE(batch4_vs_scalar)
+    {
+    check_batches<4>(Nodes::IDX_UNDEF, false);
+    check_batches<4>(Nodes::IDX_Z, false);
+    check_batches<4>(Nodes::IDX_UNDEF, true);
+    }
+
+BOOST_AUTO_TEST_CASE(batch8_vs_scalar)
+    {
+    check_batches<8>(Nodes::IDX_UNDEF, false);
+    check_batches<8>(Nodes::IDX_X, false);
+    check_batches<8>(Nodes::IDX_Y, true);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
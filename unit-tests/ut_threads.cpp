@@ -0,0 +1,87 @@
+#define BOOST_TEST_MODULE threadsTest
+
+#include <boost/test/unit_test.hpp>
+
+#include "threads.h"
+
+BOOST_AUTO_TEST_SUITE(ut_threads)
+
+BOOST_AUTO_TEST_CASE(names)
+    {
+    for (Threads::pinning p : {Threads::NO_PINNING, Threads::COMPACT, Threads::SPREAD})
+        {
+        Threads::pinning q = Threads::NO_PINNING;
+        BOOST_CHECK(Threads::fromName(Threads::name(p), q));
+        BOOST_CHECK(p == q);
+        }
+    Threads::pinning q = Threads::COMPACT;
+    BOOST_CHECK(!Threads::fromName("scatter", q));
+    BOOST_CHECK(q == Threads::COMPACT);
+    }
+
+BOOST_AUTO_TEST_CASE(cpu_lists)
+    {
+    const std::vector<int> cpus = Threads::parseCpuList("0-3,8,10-11\n");
+    BOOST_CHECK(cpus == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    BOOST_CHECK(Threads::cpuList(cpus) == "0-3,8,10-11");
+    BOOST_CHECK(Threads::parseCpuList("").empty());
+    BOOST_CHECK(Threads::cpuList({}).empty());
+    }
+
+BOOST_AUTO_TEST_CASE(cpu_order)
+    {
+    Threads::topology t;
+    t.nodeIds = {0, 2};
+    t.cpusOfNode = {{0, 1, 2}, {4, 5}};
+    BOOST_CHECK(t.nbCpus() == 5);
+    BOOST_CHECK(t.nodeOf(5) == 1);
+    BOOST_CHECK(t.nodeOf(1) == 0);
+    BOOST_CHECK(t.cpuOrder(Threads::COMPACT) == std::vector<int>({0, 1, 2, 4, 5}));
+    BOOST_CHECK(t.cpuOrder(Threads::SPREAD) == std::vector<int>({0, 4, 1, 5, 2}));
+
+    const Threads::topology detected = Threads::topology::detect();
+    BOOST_CHECK(detected.nbCpus() > 0);
+    BOOST_CHECK(detected.nodeIds.size() == detected.cpusOfNode.size());
+    }
+
+BOOST_AUTO_TEST_CASE(split)
+    {
+    Threads::config c;
+    BOOST_CHECK(c.nbThreads(8) == 8);
+    BOOST_CHECK(c.nbDemag(8) == 8);
+    c.total = 4;
+    c.demag = 6;
+    c.solver = 2;
+    BOOST_CHECK(c.nbThreads(8) == 4);
+    BOOST_CHECK(c.nbDemag(8) == 4);
+    BOOST_CHECK(c.nbSolver(8) == 2);
+    BOOST_CHECK(c.disjoint(8));
+    BOOST_CHECK(!c.disjoint(5));
+    }
+
+BOOST_AUTO_TEST_CASE(tbb_limit)
+    {
+    Threads::config c;
+    c.total = 4;
+    c.demag = 1;
+    c.solver = 1;
+    c.pin = Threads::COMPACT;
+    const int nbCpus = Threads::topology::detect().nbCpus();
+    Threads::pool p(c);
+    // with disjoint processors, TBB runs the master thread and a worker per processor of the solver
+    const size_t expected = c.disjoint(nbCpus) ? c.nbSolver(nbCpus) + 1 : c.nbThreads(nbCpus);
+    BOOST_CHECK(tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism) == expected);
+    BOOST_CHECK(p.sharedCpus() == !c.disjoint(nbCpus));
+    }
+
+/** without pinning, the threads of the demag field and of TBB may share all the processors */
+BOOST_AUTO_TEST_CASE(unpinned)
+    {
+    Threads::config c;
+    c.demag = 1;
+    c.solver = 1;
+    Threads::pool p(c);
+    BOOST_CHECK(p.sharedCpus());
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,5 +1,6 @@
 #include <eigen3/Eigen/Dense>
 #include "pt3D.h"
+#include "tetra.h"
 
 /** returns a unit vector pointing to (theta,phi) in spherical coordinates */
 Eigen::Vector3d rand_vec3d(double theta, double phi)
@@ -33,3 +34,34 @@ double sq_frobenius_norm(Eigen::Ref<Eigen::Matrix<double,Pt::DIM,nbVect>> const
     return val;
     }
 
+/** builds a cube of n^3 cells of size h, each cell split in 6 tetrahedrons (Kuhn triangulation),
+ * all in region 0 */
+inline void build_cube(const int n, const double h, Nodes::Store &node, std::vector<Tetra::geometry> &geom,
+                       std::vector<Tetra::Tet> &tet)
+    {
+    const int nn = n + 1;
+    auto idx = [nn](int i, int j, int k) { return i + nn * (j + nn * k); };
+    node.resize(nn * nn * nn);
+    for (int k = 0; k < nn; k++)
+        for (int j = 0; j < nn; j++)
+            for (int i = 0; i < nn; i++)
+                { node.p[idx(i, j, k)] = h * Eigen::Vector3d(i, j, k); }
+
+    const int perm[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+    for (int k = 0; k < n; k++)
+        for (int j = 0; j < n; j++)
+            for (int i = 0; i < n; i++)
+                for (int q = 0; q < 6; q++)
+                    {
+                    int c[3] = {i, j, k};
+                    int v[4];
+                    v[0] = idx(c[0], c[1], c[2]);
+                    for (int s = 0; s < 3; s++)
+                        {
+                        c[perm[q][s]]++;
+                        v[s + 1] = idx(c[0], c[1], c[2]);
+                        }
+                    // Tet constructor expects one based indices
+                    tet.push_back(Tetra::Tet(node, geom, 0, {v[0] + 1, v[1] + 1, v[2] + 1, v[3] + 1}));
+                    }
+    }